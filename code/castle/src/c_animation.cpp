@@ -1,5 +1,6 @@
 #include "c_animation.h"
 
+#include <castle_common/cc_debugging.h>
 #include "c_game.h"
 
 AnimationType *g_coreAnimTypes;
@@ -18,28 +19,38 @@ cc::Rect player_ent_anim_src_rect_builder(const int frameIndex)
     }
 }
 
-void init_core_anim_types(cc::MemArena &permMemArena)
+bool init_core_anim_types(cc::MemArena &permMemArena, const AssetGroupManager &assetGroupManager)
 {
     g_coreAnimTypes = cc::push_to_mem_arena<AnimationType>(permMemArena, CORE_ANIM_TYPE_CNT);
 
     g_coreAnimTypes[PLAYER_ENT_IDLE_CORE_ANIM] = {
         .srcRectBuilder = player_ent_anim_src_rect_builder,
         .srcRectCnt = 2,
-        .texID = make_core_asset_id(cc::PLAYER_ENT_TEX)
+        .texID = make_core_asset_id(cc::PLAYER_ENT_TEX),
+        .spriteAnimIndex = -1 // Set once the frames are uploaded below.
     };
-}
 
-void anim_inst_tick(AnimationInst &animInst)
-{
-    if (animInst.frameTime < animInst.frameInterval)
-    {
-        ++animInst.frameTime;
-    }
-    else
+    // Upload the frames of every type.
+    for (int i = 0; i < CORE_ANIM_TYPE_CNT; ++i)
     {
-        ++animInst.frameIndex;
-        animInst.frameIndex %= g_coreAnimTypes[animInst.typeIndex].srcRectCnt;
+        AnimationType &type = g_coreAnimTypes[i];
 
-        animInst.frameTime = 0;
+        cc::Rect srcRects[gk_spriteAnimFrameLimit];
+        assert(type.srcRectCnt <= gk_spriteAnimFrameLimit);
+
+        for (int j = 0; j < type.srcRectCnt; ++j)
+        {
+            srcRects[j] = type.srcRectBuilder(j);
+        }
+
+        type.spriteAnimIndex = add_sprite_anim(type.texID, srcRects, type.srcRectCnt, assetGroupManager);
+
+        if (type.spriteAnimIndex == -1)
+        {
+            cc::log_error("Failed to add the frames of core animation type %d, as the sprite animation limits have been reached!", i);
+            return false;
+        }
     }
+
+    return true;
 }
@@ -1,5 +1,6 @@
 // An animation is effectively a collection of source rectangles (i.e. image subsets) associated with a single texture ID.
 // Modders will need to be able to create their own animation types.
+// The frames of every type are uploaded to the GPU, where the vertex shader picks the frame of an instance from the animation time of the renderer, so instances never need to be ticked or rewritten just to animate.
 
 #pragma once
 
@@ -21,6 +22,7 @@ struct AnimationType
     AnimationSrcRectBuilder srcRectBuilder;
     int srcRectCnt;
     AssetID texID;
+    int spriteAnimIndex; // The index of the frames on the GPU.
 };
 
 extern AnimationType *g_coreAnimTypes; // TEMP: Not sure how we're going to store these yet considering the modding system.
@@ -29,17 +31,20 @@ extern AnimationType *g_coreAnimTypes; // TEMP: Not sure how we're going to stor
 // It will be common to change the animation type in this (e.g. when switching from an idle animation to a walking animation).
 struct AnimationInst
 {
-    int frameIndex;
-    int frameTime; // The number of ticks since the last frame change.
-    int frameInterval; // The number of ticks before moving to the next frame.
+    int startTime; // The animation time of the renderer the first frame starts at.
+    int frameInterval; // The number of ticks each frame is shown for.
 
     int typeIndex;
 };
 
-void init_core_anim_types(cc::MemArena &permMemArena);
-void anim_inst_tick(AnimationInst &animInst);
+bool init_core_anim_types(cc::MemArena &permMemArena, const AssetGroupManager &assetGroupManager); // Must follow the initialisation of the rendering internals.
 
-inline cc::Rect get_anim_src_rect(const AnimationInst &animInst)
+inline cc::Vec2DInt get_anim_frame_size(const AnimationInst &animInst) // Every frame of an animation is the same size.
 {
-    return g_coreAnimTypes[animInst.typeIndex].srcRectBuilder(animInst.frameIndex);
+    return g_coreAnimTypes[animInst.typeIndex].srcRectBuilder(0).size;
+}
+
+inline float get_anim_rate(const AnimationInst &animInst) // In frames per tick.
+{
+    return 1.0f / animInst.frameInterval;
 }
@@ -6,57 +6,136 @@
 #include <castle_common/cc_debugging.h>
 #include "c_game.h"
 
-static const char *const ik_spriteQuadVertShaderSrc = R"(#version 430 core
+// The sprite quad shaders leave out the version directive, as the definitions of the enabled sprite features are inserted after it. Only the components of enabled features are read.
+static const char *const ik_spriteQuadShaderVersionDirective = "#version 430 core\n";
 
-layout (location = 0) in vec2 a_vert;
+static const char *const ik_spriteQuadShaderFeatureDefines[gk_spriteFeatureCnt] = { // In the order of the feature bits.
+    "#define ROT\n",
+    "#define ALPHA\n",
+    "#define ANIM\n"
+};
+
+static const char *const ik_spriteQuadVertShaderSrc = R"(
+layout (location = 0) in vec2 a_offs;
 layout (location = 1) in vec2 a_pos;
-layout (location = 2) in vec2 a_size;
+layout (location = 2) in vec2 a_texCoord;
+#ifdef ROT
 layout (location = 3) in float a_rot;
-layout (location = 4) in float a_texIndex;
-layout (location = 5) in vec2 a_texCoord;
-layout (location = 6) in float a_alpha;
+#endif
+#ifdef ALPHA
+layout (location = 4) in float a_alpha;
+#endif
+layout (location = 5) in uvec3 a_texUnitPaletteAndAnim; // The palette and animation are each one above their index, or zero for none.
 
 out flat int v_texIndex;
+out flat int v_palette;
 out vec2 v_texCoord;
+#ifdef ALPHA
 out float v_alpha;
+#endif
 
 uniform mat4 u_view;
 uniform mat4 u_proj;
+uniform float u_depth;
+
+#ifdef ANIM
+layout (std140, binding = 0) uniform SpriteAnims
+{
+    ivec4 u_anims[64]; // The index of the first frame of each animation followed by its frame count.
+    vec4 u_animFrames[512]; // The texture coordinates of each frame, as left, top, right and bottom.
+};
+
+uniform float u_animTime;
+#endif
 
 void main()
 {
+#ifdef ROT
     float rotCos = cos(a_rot);
     float rotSin = -sin(a_rot);
 
-    mat4 model = mat4(
-        vec4(a_size.x * rotCos, a_size.x * rotSin, 0.0f, 0.0f),
-        vec4(a_size.y * -rotSin, a_size.y * rotCos, 0.0f, 0.0f),
-        vec4(0.0f, 0.0f, 1.0f, 0.0f),
-        vec4(a_pos.x, a_pos.y, 0.0f, 1.0f)
-    );
+    mat2 rotMat = mat2(rotCos, rotSin, -rotSin, rotCos);
 
-    gl_Position = u_proj * u_view * model * vec4(a_vert, 0.0f, 1.0f);
+    gl_Position = u_proj * u_view * vec4(a_pos + (rotMat * a_offs), 0.0f, 1.0f);
+#else
+    gl_Position = u_proj * u_view * vec4(a_pos + a_offs, 0.0f, 1.0f);
+#endif
+    gl_Position.z = u_depth;
 
-    v_texIndex = int(a_texIndex);
+    v_texIndex = int(a_texUnitPaletteAndAnim.x);
+    v_palette = int(a_texUnitPaletteAndAnim.y) - 1;
+#ifdef ANIM
+    // Animated sprites have the rate in frames per tick and the phase the animation started at, as a fraction of its frame count, in place of texture coordinates.
+    if (a_texUnitPaletteAndAnim.z != 0u)
+    {
+        ivec4 animInfo = u_anims[a_texUnitPaletteAndAnim.z - 1u];
+        float frameCnt = float(animInfo.y);
+        int frame = min(int(mod((u_animTime * a_texCoord.x) - (a_texCoord.y * frameCnt), frameCnt)), animInfo.y - 1);
+        vec4 frameTexCoords = u_animFrames[animInfo.x + frame];
+
+        // Corners are written top left, top right, bottom right then bottom left.
+        int corner = gl_VertexID % 4;
+        v_texCoord = vec2(corner == 0 || corner == 3 ? frameTexCoords.x : frameTexCoords.z, corner < 2 ? frameTexCoords.y : frameTexCoords.w);
+    }
+    else
+    {
+        v_texCoord = a_texCoord;
+    }
+#else
     v_texCoord = a_texCoord;
+#endif
+#ifdef ALPHA
     v_alpha = a_alpha;
+#endif
 }
 )";
 
-static const char *const ik_spriteQuadFragShaderSrc = R"(#version 430 core
-
+static const char *const ik_spriteQuadFragShaderSrc = R"(
 in flat int v_texIndex;
+in flat int v_palette;
 in vec2 v_texCoord;
+#ifdef ALPHA
 in float v_alpha;
+#endif
 
 out vec4 o_fragColor;
 
 uniform sampler2D u_textures[32];
+uniform int u_texPalettes[32]; // The palette of the texture in each unit, or -1 if it holds its colours directly.
+uniform bool u_alphaTest;
+
+layout (std430, binding = 3) readonly buffer SpritePalettes
+{
+    uint u_paletteColors[]; // Every palette in turn, each with 256 colours packed as RGBA.
+};
 
 void main()
 {
-    vec4 texColor = texture(u_textures[v_texIndex], v_texCoord);
-    o_fragColor = texColor * vec4(1.0f, 1.0f, 1.0f, v_alpha);
+    // A palette swap only applies to indexed textures, as the red channel of any other is not an index.
+    int palette = u_texPalettes[v_texIndex];
+
+    if (palette >= 0 && v_palette >= 0)
+    {
+        palette = v_palette;
+    }
+
+    if (palette >= 0)
+    {
+        uint colorIndex = uint((texture(u_textures[v_texIndex], v_texCoord).r * 255.0f) + 0.5f);
+        o_fragColor = unpackUnorm4x8(u_paletteColors[(palette * 256) + int(colorIndex)]);
+    }
+    else
+    {
+        o_fragColor = texture(u_textures[v_texIndex], v_texCoord);
+    }
+#ifdef ALPHA
+    o_fragColor.a *= v_alpha;
+#endif
+
+    if (u_alphaTest && o_fragColor.a < 0.5f)
+    {
+        discard;
+    }
 }
 )";
 
@@ -72,6 +151,7 @@ uniform float u_rot;
 
 uniform mat4 u_proj;
 uniform mat4 u_view;
+uniform float u_depth;
 
 void main()
 {
@@ -86,6 +166,7 @@ void main()
     );
 
     gl_Position = u_proj * u_view * model * vec4(a_vert, 0.0f, 1.0f);
+    gl_Position.z = u_depth;
 
     v_texCoord = a_texCoord;
 }
@@ -98,23 +179,199 @@ in vec2 v_texCoord;
 out vec4 o_fragColor;
 
 uniform vec4 u_blend;
-uniform sampler2D u_tex;
+uniform sampler2D u_tex; // The glyph atlas, which only holds coverage.
 
 void main()
 {
-    vec4 texColor = texture(u_tex, v_texCoord);
-    o_fragColor = texColor * u_blend;
+    float coverage = texture(u_tex, v_texCoord).r;
+    o_fragColor = vec4(1.0, 1.0, 1.0, coverage) * u_blend;
 }
 )";
 
-static GLID create_shader_prog_from_srcs(const char *const vertShaderSrc, const char *const fragShaderSrc)
+static const char *const ik_streamedVertShaderSrc = R"(#version 430 core
+
+layout (location = 0) in vec2 a_pos;
+layout (location = 1) in vec2 a_texCoord;
+layout (location = 2) in vec4 a_color;
+
+out vec2 v_texCoord;
+out vec4 v_color;
+
+uniform mat4 u_proj;
+uniform mat4 u_view;
+
+void main()
+{
+    gl_Position = u_proj * u_view * vec4(a_pos, 0.0, 1.0);
+    v_texCoord = a_texCoord;
+    v_color = a_color;
+}
+)";
+
+static const char *const ik_streamedFragShaderSrc = R"(#version 430 core
+
+in vec2 v_texCoord;
+in vec4 v_color;
+
+out vec4 o_fragColor;
+
+uniform sampler2D u_tex; // The glyph atlas, only sampled for text. Untextured vertices have negative texture coordinates.
+
+void main()
+{
+    float coverage = v_texCoord.x < 0.0 ? 1.0 : texture(u_tex, v_texCoord).r;
+    o_fragColor = vec4(v_color.rgb, v_color.a * coverage);
+}
+)";
+
+static const char *const ik_layerCacheVertShaderSrc = R"(#version 430 core
+
+out vec2 v_texCoord;
+
+uniform mat4 u_proj;
+uniform vec4 u_rect; // The position and size the cache covers.
+uniform float u_depth;
+
+void main()
+{
+    // The corners come from the vertex IDs of a triangle strip, so there is no vertex data.
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+    gl_Position = u_proj * vec4(u_rect.xy + (corner * u_rect.zw), 0.0f, 1.0f);
+    gl_Position.z = u_depth;
+
+    // The top of the view is the top of the framebuffer the cache was drawn in, which is the last row of the texture.
+    v_texCoord = vec2(corner.x, 1.0f - corner.y);
+}
+)";
+
+static const char *const ik_layerCacheFragShaderSrc = R"(#version 430 core
+
+in vec2 v_texCoord;
+
+out vec4 o_fragColor;
+
+uniform sampler2D u_tex; // Holds colours already multiplied by their alpha.
+
+void main()
+{
+    o_fragColor = texture(u_tex, v_texCoord);
+}
+)";
+
+// Culls the sprite quads of a batch against the view, writing the indices of those that remain into the element buffer range of the batch and counting them in its indirect draw command.
+static const char *const ik_spriteCullCompShaderSrc = R"(#version 430 core
+
+layout (local_size_x = 64) in;
+
+struct DrawCmd
+{
+    uint cnt;
+    uint instanceCnt;
+    uint firstIndex;
+    int baseVert;
+    uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Verts
+{
+    uint verts[]; // Each vertex is laid out as SpriteQuadVert, read a word at a time.
+};
+
+layout (std430, binding = 1) writeonly buffer Indices
+{
+    uint indices[];
+};
+
+layout (std430, binding = 2) buffer Cmds
+{
+    DrawCmd cmds[];
+};
+
+uniform mat4 u_view;
+uniform mat4 u_proj;
+uniform int u_quadOffs;
+uniform int u_quadCnt;
+uniform int u_cmdIndex;
+
+const int k_vertWordCnt = 6;
+
+void main()
+{
+    int quadIndex = int(gl_GlobalInvocationID.x);
+
+    if (quadIndex >= u_quadCnt)
+    {
+        return;
+    }
+
+    int quad = u_quadOffs + quadIndex;
+    int quadVertsBegin = quad * 4 * k_vertWordCnt;
+
+    // The fifth word holds the rotation as a half float in its low half, followed by the alpha byte.
+    uint rotAndAlpha = verts[quadVertsBegin + 4];
+
+    // Cleared slots and fully transparent sprites are never visible.
+    if (((rotAndAlpha >> 16) & 0xFFu) == 0u)
+    {
+        return;
+    }
+
+    vec2 pos = vec2(uintBitsToFloat(verts[quadVertsBegin + 0]), uintBitsToFloat(verts[quadVertsBegin + 1]));
+    float rot = unpackHalf2x16(rotAndAlpha).x;
+
+    float rotCos = cos(rot);
+    float rotSin = -sin(rot);
+
+    mat4 model = mat4(
+        vec4(rotCos, rotSin, 0.0f, 0.0f),
+        vec4(-rotSin, rotCos, 0.0f, 0.0f),
+        vec4(0.0f, 0.0f, 1.0f, 0.0f),
+        vec4(pos.x, pos.y, 0.0f, 1.0f)
+    );
+
+    mat4 mvp = u_proj * u_view * model;
+
+    // Find the clip space bounds of the quad corners exactly as the vertex shader places them.
+    vec2 clipMin = vec2(1.0e30f);
+    vec2 clipMax = vec2(-1.0e30f);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        vec2 offs = unpackHalf2x16(verts[quadVertsBegin + (i * k_vertWordCnt) + 2]);
+        vec2 clipPos = (mvp * vec4(offs, 0.0f, 1.0f)).xy;
+
+        clipMin = min(clipMin, clipPos);
+        clipMax = max(clipMax, clipPos);
+    }
+
+    if (clipMax.x < -1.0f || clipMin.x > 1.0f || clipMax.y < -1.0f || clipMin.y > 1.0f)
+    {
+        return;
+    }
+
+    // Append the indices of the quad.
+    uint indicesBegin = cmds[u_cmdIndex].firstIndex + atomicAdd(cmds[u_cmdIndex].cnt, 6u);
+    uint vertIndex = uint(quad * 4);
+
+    indices[indicesBegin + 0] = vertIndex + 0;
+    indices[indicesBegin + 1] = vertIndex + 1;
+    indices[indicesBegin + 2] = vertIndex + 2;
+    indices[indicesBegin + 3] = vertIndex + 2;
+    indices[indicesBegin + 4] = vertIndex + 3;
+    indices[indicesBegin + 5] = vertIndex + 0;
+}
+)";
+
+// Each shader is compiled from its parts joined in order.
+static GLID create_shader_prog_from_src_parts(const char *const *const vertShaderSrcParts, const char *const *const fragShaderSrcParts, const int partCnt)
 {
     const GLID vertShaderGLID = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertShaderGLID, 1, &vertShaderSrc, nullptr);
+    glShaderSource(vertShaderGLID, partCnt, vertShaderSrcParts, nullptr);
     glCompileShader(vertShaderGLID);
 
     const GLID fragShaderGLID = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragShaderGLID, 1, &fragShaderSrc, nullptr);
+    glShaderSource(fragShaderGLID, partCnt, fragShaderSrcParts, nullptr);
     glCompileShader(fragShaderGLID);
 
     // TODO: Check for shader compilation errors, and return 0 if there are any.
@@ -130,7 +387,80 @@ static GLID create_shader_prog_from_srcs(const char *const vertShaderSrc, const
     return progGLID;
 }
 
-static void init_textures_with_fs(Textures &textures, FILE *const fs, cc::MemArena &tempMemArena, const int texCnt)
+static GLID create_shader_prog_from_srcs(const char *const vertShaderSrc, const char *const fragShaderSrc)
+{
+    return create_shader_prog_from_src_parts(&vertShaderSrc, &fragShaderSrc, 1);
+}
+
+// Returns the number of parts.
+static int get_sprite_quad_shader_src_parts(const SpriteFeatures features, const char **const vertShaderSrcParts, const char **const fragShaderSrcParts)
+{
+    constexpr int partCnt = 2 + gk_spriteFeatureCnt;
+    static_assert(partCnt <= gk_shaderSrcPartLimit);
+
+    vertShaderSrcParts[0] = ik_spriteQuadShaderVersionDirective;
+    fragShaderSrcParts[0] = ik_spriteQuadShaderVersionDirective;
+
+    for (int i = 0; i < gk_spriteFeatureCnt; ++i)
+    {
+        const char *const define = (features & (1 << i)) ? ik_spriteQuadShaderFeatureDefines[i] : "";
+        vertShaderSrcParts[1 + i] = define;
+        fragShaderSrcParts[1 + i] = define;
+    }
+
+    vertShaderSrcParts[partCnt - 1] = ik_spriteQuadVertShaderSrc;
+    fragShaderSrcParts[partCnt - 1] = ik_spriteQuadFragShaderSrc;
+
+    return partCnt;
+}
+
+static GLID create_sprite_quad_shader_prog_variant(const SpriteFeatures features)
+{
+    const char *vertShaderSrcParts[gk_shaderSrcPartLimit];
+    const char *fragShaderSrcParts[gk_shaderSrcPartLimit];
+    const int partCnt = get_sprite_quad_shader_src_parts(features, vertShaderSrcParts, fragShaderSrcParts);
+
+    return create_shader_prog_from_src_parts(vertShaderSrcParts, fragShaderSrcParts, partCnt);
+}
+
+static GLID create_compute_shader_prog_from_src(const char *const src)
+{
+    const GLID shaderGLID = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(shaderGLID, 1, &src, nullptr);
+    glCompileShader(shaderGLID);
+
+    const GLID progGLID = glCreateProgram();
+    glAttachShader(progGLID, shaderGLID);
+    glLinkProgram(progGLID);
+
+    glDeleteShader(shaderGLID);
+
+    return progGLID;
+}
+
+static int add_tex_palette_with_colors(TexPalettes &palettes, const unsigned int *const colors, const int colorCnt)
+{
+    assert(colorCnt > 0 && colorCnt <= cc::gk_texPaletteColorLimit);
+
+    if (palettes.cnt == gk_texPaletteLimit)
+    {
+        return -1;
+    }
+
+    const int index = palettes.cnt;
+    ++palettes.cnt;
+
+    unsigned int *const paletteColors = palettes.colors[index];
+    memcpy(paletteColors, colors, sizeof(*colors) * colorCnt);
+    memset(paletteColors + colorCnt, 0, sizeof(*colors) * (cc::gk_texPaletteColorLimit - colorCnt));
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, palettes.bufGLID);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(palettes.colors[0]) * index, sizeof(palettes.colors[0]), paletteColors);
+
+    return index;
+}
+
+static void init_textures_with_fs(Textures &textures, TexPalettes &palettes, FILE *const fs, cc::MemArena &tempMemArena, const int texCnt)
 {
     assert(texCnt >= 0);
 
@@ -150,42 +480,97 @@ static void init_textures_with_fs(Textures &textures, FILE *const fs, cc::MemAre
     {
         textures.sizes[i] = cc::read_from_fs<cc::Vec2DInt>(fs);
 
-        fread(pxDataBuf, 1, cc::gk_texChannelCnt * textures.sizes[i].x * textures.sizes[i].y, fs);
+        const int pxCnt = textures.sizes[i].x * textures.sizes[i].y;
+        const int paletteColorCnt = cc::read_from_fs<int>(fs);
+        assert(paletteColorCnt >= 0 && paletteColorCnt <= cc::gk_texPaletteColorLimit);
 
         glBindTexture(GL_TEXTURE_2D, textures.glIDs[i]);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textures.sizes[i].x, textures.sizes[i].y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pxDataBuf);
+
+        if (!paletteColorCnt)
+        {
+            textures.paletteIndexes[i] = -1;
+
+            fread(pxDataBuf, 1, cc::gk_texChannelCnt * pxCnt, fs);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textures.sizes[i].x, textures.sizes[i].y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pxDataBuf);
+
+            continue;
+        }
+
+        unsigned int paletteColors[cc::gk_texPaletteColorLimit];
+        fread(paletteColors, sizeof(paletteColors[0]), paletteColorCnt, fs);
+        fread(pxDataBuf, 1, pxCnt, fs);
+
+        textures.paletteIndexes[i] = add_tex_palette_with_colors(palettes, paletteColors, paletteColorCnt);
+
+        if (textures.paletteIndexes[i] == -1)
+        {
+            // There is no room for the palette, so look the colours up here instead. Going backwards lets the colours overwrite the indexes in place.
+            cc::log_warning("The texture palette limit of %d has been reached! A texture will be stored as RGBA instead, and palette swaps on it ignored.", gk_texPaletteLimit);
+
+            for (int j = pxCnt - 1; j >= 0; --j)
+            {
+                memcpy(pxDataBuf + (j * cc::gk_texChannelCnt), &paletteColors[pxDataBuf[j]], sizeof(paletteColors[0]));
+            }
+
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textures.sizes[i].x, textures.sizes[i].y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pxDataBuf);
+
+            continue;
+        }
+
+        // Rows of single-byte indexes are not padded to four bytes.
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, textures.sizes[i].x, textures.sizes[i].y, 0, GL_RED, GL_UNSIGNED_BYTE, pxDataBuf);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
     }
 }
 
-static void init_fonts_with_fs(Fonts &fonts, FILE *const fs, cc::MemArena &tempMemArena, const int fontCnt)
+static bool init_fonts_with_fs(Fonts &fonts, FILE *const fs, cc::MemArena &permMemArena, cc::MemArena &tempMemArena, const int fontCnt, const FT_Library ftLib)
 {
     assert(fontCnt >= 0);
 
-    if (!fontCnt)
+    for (int i = 0; i < fontCnt; ++i)
     {
-        return;
-    }
+        const auto info = cc::read_from_fs<cc::FontInfo>(fs);
+        assert(info.fileSize > 0 && info.fileSize <= cc::gk_fontFileSizeLimit);
 
-    // Generate textures and store their IDs.
-    glGenTextures(fontCnt, fonts.texGLIDs);
+        // Read the file data, sharing that of an earlier font if it is identical (as it is for different sizes of the same font).
+        const auto fileData = cc::push_to_mem_arena<cc::Byte>(tempMemArena, info.fileSize);
+        fread(fileData, 1, info.fileSize, fs);
 
-    // Read the sizes and pixel data of textures and finish setting them up.
-    const int pxDataBufSize = cc::gk_texChannelCnt * cc::gk_texSizeLimit.x * cc::gk_texSizeLimit.y;
-    const auto pxDataBuf = cc::push_to_mem_arena<unsigned char>(tempMemArena, pxDataBufSize); // Working space for temporarily storing the pixel data of each font texture.
+        fonts.fileData[i] = nullptr;
+        fonts.fileSizes[i] = info.fileSize;
 
-    for (int i = 0; i < fontCnt; ++i)
-    {
-        fread(&fonts.displayInfos[i], sizeof(fonts.displayInfos[i]), 1, fs);
+        for (int j = 0; j < i; ++j)
+        {
+            if (fonts.fileSizes[j] == info.fileSize && !memcmp(fonts.fileData[j], fileData, info.fileSize))
+            {
+                fonts.fileData[i] = fonts.fileData[j];
+                break;
+            }
+        }
 
-        fread(pxDataBuf, 1, pxDataBufSize, fs);
+        if (!fonts.fileData[i])
+        {
+            const auto permFileData = cc::push_to_mem_arena<cc::Byte>(permMemArena, info.fileSize);
+            memcpy(permFileData, fileData, info.fileSize);
+            fonts.fileData[i] = permFileData;
+        }
 
-        glBindTexture(GL_TEXTURE_2D, fonts.texGLIDs[i]);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, fonts.displayInfos[i].texSize.x, fonts.displayInfos[i].texSize.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pxDataBuf);
+        // Create the face.
+        if (FT_New_Memory_Face(ftLib, fonts.fileData[i], info.fileSize, 0, &fonts.faces[i]))
+        {
+            cc::log_error("Failed to create a FreeType face object for font %d!", i);
+            return false;
+        }
+
+        FT_Set_Char_Size(fonts.faces[i], info.ptSize << 6, 0, 96, 0);
+
+        fonts.lineHeights[i] = fonts.faces[i]->size->metrics.height >> 6;
     }
+
+    return true;
 }
 
 static void init_sounds_with_fs(Sounds &sounds, FILE *const fs, cc::MemArena &tempMemArena, const int soundCnt)
@@ -236,25 +621,33 @@ static void init_music_with_fs(Music &music, FILE *const fs, const int musicCnt)
 
 bool load_shader_progs(ShaderProgs &progs)
 {
-    // Load the sprite quad shader program.
-    progs.spriteQuadGLID = create_shader_prog_from_srcs(ik_spriteQuadVertShaderSrc, ik_spriteQuadFragShaderSrc);
-
-    if (!progs.spriteQuadGLID)
+    // Load a variant of the sprite quad shader program for every combination of sprite features.
+    for (int i = 0; i < gk_spriteFeatureComboCnt; ++i)
     {
-        return false;
-    }
+        SpriteQuadShaderProg &prog = progs.spriteQuads[i];
+        prog.glID = create_sprite_quad_shader_prog_variant(i);
+
+        if (!prog.glID)
+        {
+            clean_shader_progs(progs);
+            return false;
+        }
 
-    progs.spriteQuadProjUniLoc = glGetUniformLocation(progs.spriteQuadGLID, "u_proj");
-    progs.spriteQuadViewUniLoc = glGetUniformLocation(progs.spriteQuadGLID, "u_view");
-    progs.spriteQuadTexturesUniLoc = glGetUniformLocation(progs.spriteQuadGLID, "u_textures");
+        prog.projUniLoc = glGetUniformLocation(prog.glID, "u_proj");
+        prog.viewUniLoc = glGetUniformLocation(prog.glID, "u_view");
+        prog.texturesUniLoc = glGetUniformLocation(prog.glID, "u_textures");
+        prog.depthUniLoc = glGetUniformLocation(prog.glID, "u_depth");
+        prog.alphaTestUniLoc = glGetUniformLocation(prog.glID, "u_alphaTest");
+        prog.animTimeUniLoc = glGetUniformLocation(prog.glID, "u_animTime");
+        prog.texPalettesUniLoc = glGetUniformLocation(prog.glID, "u_texPalettes");
+    }
 
     // Load the character quad shader program.
     progs.charQuadGLID = create_shader_prog_from_srcs(ik_charQuadVertShaderSrc, ik_charQuadFragShaderSrc);
 
     if (!progs.charQuadGLID)
     {
-        glDeleteProgram(progs.spriteQuadGLID);
-        progs = {};
+        clean_shader_progs(progs);
         return false;
     }
 
@@ -263,22 +656,139 @@ bool load_shader_progs(ShaderProgs &progs)
     progs.charQuadPosUniLoc = glGetUniformLocation(progs.charQuadGLID, "u_pos");
     progs.charQuadRotUniLoc = glGetUniformLocation(progs.charQuadGLID, "u_rot");
     progs.charQuadBlendUniLoc = glGetUniformLocation(progs.charQuadGLID, "u_blend");
+    progs.charQuadDepthUniLoc = glGetUniformLocation(progs.charQuadGLID, "u_depth");
+
+    // Load the streamed vertex shader program.
+    progs.streamedVertGLID = create_shader_prog_from_srcs(ik_streamedVertShaderSrc, ik_streamedFragShaderSrc);
+
+    if (!progs.streamedVertGLID)
+    {
+        clean_shader_progs(progs);
+        return false;
+    }
+
+    progs.streamedVertProjUniLoc = glGetUniformLocation(progs.streamedVertGLID, "u_proj");
+    progs.streamedVertViewUniLoc = glGetUniformLocation(progs.streamedVertGLID, "u_view");
+
+    // Load the layer cache shader program.
+    progs.layerCacheGLID = create_shader_prog_from_srcs(ik_layerCacheVertShaderSrc, ik_layerCacheFragShaderSrc);
+
+    if (!progs.layerCacheGLID)
+    {
+        clean_shader_progs(progs);
+        return false;
+    }
+
+    progs.layerCacheProjUniLoc = glGetUniformLocation(progs.layerCacheGLID, "u_proj");
+    progs.layerCacheRectUniLoc = glGetUniformLocation(progs.layerCacheGLID, "u_rect");
+    progs.layerCacheDepthUniLoc = glGetUniformLocation(progs.layerCacheGLID, "u_depth");
+
+    // Load the sprite culling compute shader program if compute shaders are available. It is optional, so its absence is not a failure.
+    if (GLAD_GL_VERSION_4_3)
+    {
+        progs.spriteCullGLID = create_compute_shader_prog_from_src(ik_spriteCullCompShaderSrc);
+
+        progs.spriteCullProjUniLoc = glGetUniformLocation(progs.spriteCullGLID, "u_proj");
+        progs.spriteCullViewUniLoc = glGetUniformLocation(progs.spriteCullGLID, "u_view");
+        progs.spriteCullQuadOffsUniLoc = glGetUniformLocation(progs.spriteCullGLID, "u_quadOffs");
+        progs.spriteCullQuadCntUniLoc = glGetUniformLocation(progs.spriteCullGLID, "u_quadCnt");
+        progs.spriteCullCmdIndexUniLoc = glGetUniformLocation(progs.spriteCullGLID, "u_cmdIndex");
+    }
 
     return true;
 }
 
 void clean_shader_progs(ShaderProgs &progs)
 {
-    glDeleteProgram(progs.spriteQuadGLID);
+    // Programs not yet created when loading failed are zero, which deleting ignores.
+    for (int i = 0; i < gk_spriteFeatureComboCnt; ++i)
+    {
+        glDeleteProgram(progs.spriteQuads[i].glID);
+    }
+
     glDeleteProgram(progs.charQuadGLID);
+    glDeleteProgram(progs.streamedVertGLID);
+    glDeleteProgram(progs.layerCacheGLID);
+
+    if (progs.spriteCullGLID)
+    {
+        glDeleteProgram(progs.spriteCullGLID);
+    }
 
     progs = {};
 }
 
+int get_shader_prog_srcs(const ShaderProgs &progs, ShaderProgSrc *const srcs)
+{
+    int cnt = 0;
+
+    const auto addProg = [srcs, &cnt](const GLID glID, const bool compute, const char *const vertOrCompShaderSrc, const char *const fragShaderSrc)
+    {
+        if (!glID)
+        {
+            return;
+        }
+
+        srcs[cnt] = {
+            .glID = glID,
+            .compute = compute,
+            .vertShaderSrcParts = {vertOrCompShaderSrc},
+            .fragShaderSrcParts = {fragShaderSrc},
+            .partCnt = 1
+        };
+
+        ++cnt;
+    };
+
+    for (int i = 0; i < gk_spriteFeatureComboCnt; ++i)
+    {
+        ShaderProgSrc &src = srcs[cnt];
+        src.glID = progs.spriteQuads[i].glID;
+        src.compute = false;
+        src.partCnt = get_sprite_quad_shader_src_parts(i, src.vertShaderSrcParts, src.fragShaderSrcParts);
+
+        ++cnt;
+    }
+
+    addProg(progs.charQuadGLID, false, ik_charQuadVertShaderSrc, ik_charQuadFragShaderSrc);
+    addProg(progs.streamedVertGLID, false, ik_streamedVertShaderSrc, ik_streamedFragShaderSrc);
+    addProg(progs.layerCacheGLID, false, ik_layerCacheVertShaderSrc, ik_layerCacheFragShaderSrc);
+    addProg(progs.spriteCullGLID, true, ik_spriteCullCompShaderSrc, nullptr);
+
+    assert(cnt <= gk_shaderProgLimit);
+
+    return cnt;
+}
+
 bool AssetGroupManager::init(cc::MemArena &permMemArena, cc::MemArena &tempMemArena)
 {
     m_groups = cc::push_to_mem_arena<AssetGroup>(permMemArena, k_groupLimit);
-    return init_core_group(tempMemArena);
+
+    if (FT_Init_FreeType(&m_ftLib))
+    {
+        cc::log_error("Failed to initialise FreeType!");
+        return false;
+    }
+
+    // Set up the texture palette buffer, with room for every palette up front.
+    m_texPalettes = cc::push_to_mem_arena<TexPalettes>(permMemArena);
+
+    glGenBuffers(1, &m_texPalettes->bufGLID);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_texPalettes->bufGLID);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(m_texPalettes->colors), nullptr, GL_STATIC_DRAW);
+
+    if (!init_core_group(permMemArena, tempMemArena))
+    {
+        FT_Done_FreeType(m_ftLib); // Also frees any faces made before the failure.
+        m_ftLib = nullptr;
+
+        glDeleteBuffers(1, &m_texPalettes->bufGLID);
+        m_texPalettes = nullptr;
+
+        return false;
+    }
+
+    return true;
 }
 
 void AssetGroupManager::clean()
@@ -290,9 +800,26 @@ void AssetGroupManager::clean()
             clean_asset_group(i);
         }
     }
+
+    if (m_texPalettes)
+    {
+        glDeleteBuffers(1, &m_texPalettes->bufGLID);
+        m_texPalettes = nullptr;
+    }
+
+    if (m_ftLib)
+    {
+        FT_Done_FreeType(m_ftLib);
+        m_ftLib = nullptr;
+    }
 }
 
-bool AssetGroupManager::init_core_group(cc::MemArena &tempMemArena)
+int AssetGroupManager::add_tex_palette(const unsigned int *const colors, const int colorCnt)
+{
+    return add_tex_palette_with_colors(*m_texPalettes, colors, colorCnt);
+}
+
+bool AssetGroupManager::init_core_group(cc::MemArena &permMemArena, cc::MemArena &tempMemArena)
 {
     assert(!m_groupVersions[0]);
 
@@ -312,8 +839,14 @@ bool AssetGroupManager::init_core_group(cc::MemArena &tempMemArena)
     m_groups[0].musicCnt = cc::read_from_fs<int>(fs);
 
     // Load asset data.
-    init_textures_with_fs(m_groups[0].textures, fs, tempMemArena, m_groups[0].texCnt);
-    init_fonts_with_fs(m_groups[0].fonts, fs, tempMemArena, m_groups[0].fontCnt);
+    init_textures_with_fs(m_groups[0].textures, *m_texPalettes, fs, tempMemArena, m_groups[0].texCnt);
+
+    if (!init_fonts_with_fs(m_groups[0].fonts, fs, permMemArena, tempMemArena, m_groups[0].fontCnt, m_ftLib))
+    {
+        fclose(fs);
+        return false;
+    }
+
     init_sounds_with_fs(m_groups[0].sounds, fs, tempMemArena, m_groups[0].soundCnt);
     init_music_with_fs(m_groups[0].music, fs, m_groups[0].musicCnt);
 
@@ -334,7 +867,12 @@ void AssetGroupManager::clean_asset_group(const int index)
     AssetGroup &group = m_groups[index];
 
     alDeleteBuffers(group.soundCnt, group.sounds.bufALIDs);
-    glDeleteTextures(group.fontCnt, group.fonts.texGLIDs);
+
+    for (int i = 0; i < group.fontCnt; ++i)
+    {
+        FT_Done_Face(group.fonts.faces[i]);
+    }
+
     glDeleteTextures(group.texCnt, group.textures.glIDs);
 
     memset(&group, 0, sizeof(group));
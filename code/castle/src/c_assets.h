@@ -3,12 +3,34 @@
 #include <castle_common/cc_math.h>
 #include <castle_common/cc_assets.h>
 #include <castle_common/cc_mem.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
 #include "c_utils.h"
 #include "c_modding.h"
 
-constexpr int gk_spriteQuadShaderProgVertCnt = 11;
 constexpr int gk_charQuadShaderProgVertCnt = 4;
 
+constexpr int gk_spriteAnimLimit = 64; // Must match the size of the animation array in the sprite quad vertex shader.
+constexpr int gk_spriteAnimFrameLimit = 512; // Must match the size of the frame array in the sprite quad vertex shader.
+constexpr int gk_spriteAnimUniBlockBinding = 0; // Must match the binding of the animation uniform block in the sprite quad vertex shader.
+
+constexpr int gk_texPaletteLimit = 64;
+constexpr int gk_spritePaletteBufBinding = 3; // Must match the binding of the palette buffer in the sprite quad fragment shader, and be clear of those used by the sprite culling compute shader.
+
+// Optional sprite features, enabled per render layer. Each combination has its own variant of the sprite quad shader program with only those features compiled in.
+enum SpriteFeatureBits
+{
+    SPRITE_FEATURE_ROT_BIT = 1 << 0, // Sprites can be rotated.
+    SPRITE_FEATURE_ALPHA_BIT = 1 << 1, // Sprites have their own alpha.
+    SPRITE_FEATURE_ANIM_BIT = 1 << 2 // Sprites can be animated on the GPU, picking their frame from the animation time of the renderer.
+};
+
+using SpriteFeatures = int;
+
+constexpr int gk_spriteFeatureCnt = 3;
+constexpr int gk_spriteFeatureComboCnt = 1 << gk_spriteFeatureCnt;
+constexpr SpriteFeatures gk_allSpriteFeatures = gk_spriteFeatureComboCnt - 1;
+
 // NOTE: If there is a fixed limit on the number of assets in a mod, then the asset ID can be a single integer.
 struct AssetID
 {
@@ -29,14 +51,27 @@ struct Textures
 
     GLID glIDs[k_limit];
     cc::Vec2DInt sizes[k_limit];
+    int paletteIndexes[k_limit]; // -1 for textures holding their colours directly rather than as palette indexes.
+};
+
+// The palettes of indexed textures, along with any added for swapping in at draw time, kept on the GPU in a shader storage buffer.
+struct TexPalettes
+{
+    GLID bufGLID;
+    unsigned int colors[gk_texPaletteLimit][cc::gk_texPaletteColorLimit]; // Packed RGBA, with red in the lowest byte. Unused colours are transparent.
+    int cnt;
 };
 
 struct Fonts
 {
     static constexpr int k_limit = 32;
 
-    GLID texGLIDs[k_limit];
-    cc::FontDisplayInfo displayInfos[k_limit];
+    // Glyphs are rasterised from the faces as they are first needed, by the glyph cache.
+    FT_Face faces[k_limit];
+    int lineHeights[k_limit];
+
+    const cc::Byte *fileData[k_limit]; // Must outlive the faces, which read from it. Fonts with identical file data share it.
+    int fileSizes[k_limit];
 };
 
 struct Sounds
@@ -67,12 +102,21 @@ struct AssetGroup
     Music music;
 };
 
+struct SpriteQuadShaderProg
+{
+    GLID glID;
+    int projUniLoc;
+    int viewUniLoc;
+    int texturesUniLoc;
+    int depthUniLoc;
+    int alphaTestUniLoc;
+    int animTimeUniLoc; // -1 in variants without animation.
+    int texPalettesUniLoc;
+};
+
 struct ShaderProgs
 {
-    GLID spriteQuadGLID;
-    int spriteQuadProjUniLoc;
-    int spriteQuadViewUniLoc;
-    int spriteQuadTexturesUniLoc;
+    SpriteQuadShaderProg spriteQuads[gk_spriteFeatureComboCnt]; // Indexed by sprite features.
 
     GLID charQuadGLID;
     int charQuadProjUniLoc;
@@ -80,6 +124,36 @@ struct ShaderProgs
     int charQuadPosUniLoc;
     int charQuadRotUniLoc;
     int charQuadBlendUniLoc;
+    int charQuadDepthUniLoc;
+
+    GLID streamedVertGLID;
+    int streamedVertProjUniLoc;
+    int streamedVertViewUniLoc;
+
+    GLID layerCacheGLID;
+    int layerCacheProjUniLoc;
+    int layerCacheRectUniLoc;
+    int layerCacheDepthUniLoc;
+
+    GLID spriteCullGLID; // Zero if compute shaders are not supported.
+    int spriteCullProjUniLoc;
+    int spriteCullViewUniLoc;
+    int spriteCullQuadOffsUniLoc;
+    int spriteCullQuadCntUniLoc;
+    int spriteCullCmdIndexUniLoc;
+};
+
+constexpr int gk_shaderProgLimit = gk_spriteFeatureComboCnt + 4;
+constexpr int gk_shaderSrcPartLimit = 2 + gk_spriteFeatureCnt;
+
+// The sources of a shader program, as the parts they were joined from, for recreating the program elsewhere.
+struct ShaderProgSrc
+{
+    GLID glID;
+    bool compute; // If so, the vertex shader parts are those of the compute shader, and there are no fragment shader parts.
+    const char *vertShaderSrcParts[gk_shaderSrcPartLimit];
+    const char *fragShaderSrcParts[gk_shaderSrcPartLimit];
+    int partCnt;
 };
 
 class AssetGroupManager
@@ -102,16 +176,35 @@ public:
         return m_groups[id.groupIndex].textures.sizes[id.index];
     }
 
-    inline GLID get_font_tex_gl_id(const AssetID &id) const
+    inline int get_tex_palette_index(const AssetID &id) const
+    {
+        asset_id_asserts(id, m_groups[id.groupIndex].texCnt);
+        return m_groups[id.groupIndex].textures.paletteIndexes[id.index];
+    }
+
+    int add_tex_palette(const unsigned int *const colors, const int colorCnt); // Returns the index of the new palette, or -1 if the palette limit has been reached.
+
+    inline const unsigned int *get_tex_palette_colors(const int index) const
+    {
+        assert(index >= 0 && index < m_texPalettes->cnt);
+        return m_texPalettes->colors[index];
+    }
+
+    inline GLID get_tex_palette_buf_gl_id() const
+    {
+        return m_texPalettes->bufGLID;
+    }
+
+    inline FT_Face get_font_face(const AssetID &id) const
     {
         asset_id_asserts(id, m_groups[id.groupIndex].fontCnt);
-        return m_groups[id.groupIndex].fonts.texGLIDs[id.index];
+        return m_groups[id.groupIndex].fonts.faces[id.index];
     }
 
-    inline const cc::FontDisplayInfo &get_font_display_info(const AssetID &id) const
+    inline int get_font_line_height(const AssetID &id) const
     {
         asset_id_asserts(id, m_groups[id.groupIndex].fontCnt);
-        return m_groups[id.groupIndex].fonts.displayInfos[id.index];
+        return m_groups[id.groupIndex].fonts.lineHeights[id.index];
     }
 
     inline ALID get_sound_buf_al_id(const AssetID &id) const
@@ -135,9 +228,11 @@ public:
 private:
     AssetGroup *m_groups;
     int m_groupVersions[k_groupLimit];
+    TexPalettes *m_texPalettes;
     StaticBitset<k_groupLimit> m_groupActivity;
+    FT_Library m_ftLib;
 
-    bool init_core_group(cc::MemArena &tempMemArena);
+    bool init_core_group(cc::MemArena &permMemArena, cc::MemArena &tempMemArena);
     void clean_asset_group(const int index);
 
     inline void asset_id_asserts(const AssetID &id, const int assetCnt) const
@@ -150,6 +245,7 @@ private:
 
 bool load_shader_progs(ShaderProgs &progs);
 void clean_shader_progs(ShaderProgs &progs);
+int get_shader_prog_srcs(const ShaderProgs &progs, ShaderProgSrc *const srcs); // Fills in the sources of every loaded program, with room needed for the program limit. Returns how many there are.
 
 constexpr AssetID make_core_asset_id(const int index)
 {
@@ -0,0 +1,167 @@
+#include "c_debug_draw.h"
+
+#ifndef NDEBUG
+
+#include <string.h>
+#include <castle_common/cc_debugging.h>
+#include "c_glyph_cache.h"
+
+static constexpr int ik_lineVertLimit = 1 << 16;
+static constexpr int ik_triVertLimit = 1 << 16;
+static constexpr int ik_textGlyphLimit = 4096;
+
+static constexpr int ik_circleSegCnt = 24;
+
+static constexpr AssetID ik_textFontID = make_core_asset_id(cc::EB_GARAMOND_18_FONT);
+
+static StreamedVert i_lineVerts[ik_lineVertLimit];
+static StreamedVertBatch i_lines;
+
+static StreamedVert i_triVerts[ik_triVertLimit];
+static StreamedVertBatch i_tris; // Filled shapes and text.
+
+static int i_textGlyphHandles[ik_textGlyphLimit]; // Held until the next clear so that the glyphs stay in the atlas while drawn.
+static int i_textGlyphCnt;
+
+static bool i_limitWarned;
+
+static void warn_of_limit()
+{
+    if (!i_limitWarned)
+    {
+        cc::log_warning("The debug draw limit has been reached, so further primitives are being dropped.");
+        i_limitWarned = true;
+    }
+}
+
+// Negative texture coordinates mark vertices as untextured.
+static void add_tri_quad(const cc::Vec2D topLeft, const cc::Vec2D bottomRight, const cc::Vec2D texCoordsTopLeft, const cc::Vec2D texCoordsBottomRight, const Color &color)
+{
+    if (!add_streamed_quad(i_tris, topLeft, bottomRight, texCoordsTopLeft, texCoordsBottomRight, color))
+    {
+        warn_of_limit();
+    }
+}
+
+void init_debug_draw()
+{
+    init_streamed_vert_batch(i_lines, i_lineVerts, ik_lineVertLimit, GL_LINES);
+    init_streamed_vert_batch(i_tris, i_triVerts, ik_triVertLimit, GL_TRIANGLES);
+}
+
+void clean_debug_draw()
+{
+    clear_debug_draw();
+}
+
+void clear_debug_draw()
+{
+    for (int i = 0; i < i_textGlyphCnt; ++i)
+    {
+        release_glyph(i_textGlyphHandles[i]);
+    }
+
+    i_textGlyphCnt = 0;
+
+    clear_streamed_vert_batch(i_lines);
+    clear_streamed_vert_batch(i_tris);
+}
+
+bool has_debug_draw_changed()
+{
+    return i_lines.changed || i_tris.changed;
+}
+
+void render_debug_draw(const ShaderProgs &shaderProgs, const cc::Matrix4x4 &projMat, const cc::Matrix4x4 &viewMat, RenderStats &stats)
+{
+    draw_streamed_vert_batch(i_lines, shaderProgs, projMat, viewMat, stats);
+    draw_streamed_vert_batch(i_tris, shaderProgs, projMat, viewMat, stats);
+}
+
+void debug_draw_line(const cc::Vec2D a, const cc::Vec2D b, const Color &color)
+{
+    if (!add_streamed_line(i_lines, a, b, color))
+    {
+        warn_of_limit();
+    }
+}
+
+void debug_draw_rect(const cc::RectFloat &rect, const Color &color)
+{
+    const cc::Vec2D topRight = {rect.right(), rect.y};
+    const cc::Vec2D bottomRight = {rect.right(), rect.bottom()};
+    const cc::Vec2D bottomLeft = {rect.x, rect.bottom()};
+
+    debug_draw_line(rect.pos, topRight, color);
+    debug_draw_line(topRight, bottomRight, color);
+    debug_draw_line(bottomRight, bottomLeft, color);
+    debug_draw_line(bottomLeft, rect.pos, color);
+}
+
+void debug_draw_rect_filled(const cc::RectFloat &rect, const Color &color)
+{
+    add_tri_quad(rect.pos, {rect.right(), rect.bottom()}, {-1.0f, -1.0f}, {-1.0f, -1.0f}, color);
+}
+
+void debug_draw_circle(const cc::Vec2D center, const float radius, const Color &color)
+{
+    cc::Vec2D last = center + cc::make_dir_vec_2d(0.0f, radius);
+
+    for (int i = 1; i <= ik_circleSegCnt; ++i)
+    {
+        const cc::Vec2D cur = center + cc::make_dir_vec_2d((2.0f * cc::gk_pi * i) / ik_circleSegCnt, radius);
+        debug_draw_line(last, cur, color);
+        last = cur;
+    }
+}
+
+// Draws left-aligned single-line text with its top left at the position. Kerning is not applied, as exact layout does not matter here.
+void debug_draw_text(const cc::Vec2D pos, const char *const text, const Color &color, const AssetGroupManager &assetGroupManager)
+{
+    cc::Vec2D pen = pos;
+
+    for (const char *textPtr = text; *textPtr;)
+    {
+        const unsigned int codepoint = decode_utf8_char(textPtr);
+
+        if (i_textGlyphCnt == ik_textGlyphLimit)
+        {
+            warn_of_limit();
+            return;
+        }
+
+        const int glyphHandle = acquire_glyph(ik_textFontID, codepoint, assetGroupManager);
+
+        if (glyphHandle == -1)
+        {
+            continue;
+        }
+
+        i_textGlyphHandles[i_textGlyphCnt] = glyphHandle;
+        ++i_textGlyphCnt;
+
+        const GlyphInfo &glyphInfo = get_glyph_info(glyphHandle);
+
+        if (glyphInfo.srcRect.width)
+        {
+            const cc::Vec2D topLeft = {pen.x + glyphInfo.horOffs, pen.y + glyphInfo.verOffs};
+            const cc::Vec2D bottomRight = {topLeft.x + glyphInfo.srcRect.width, topLeft.y + glyphInfo.srcRect.height};
+
+            const cc::Vec2D texCoordsTopLeft = {
+                static_cast<float>(glyphInfo.srcRect.x) / gk_glyphAtlasSize.x,
+                static_cast<float>(glyphInfo.srcRect.y) / gk_glyphAtlasSize.y
+            };
+
+            const cc::Vec2D texCoordsBottomRight = {
+                static_cast<float>(glyphInfo.srcRect.right()) / gk_glyphAtlasSize.x,
+                static_cast<float>(glyphInfo.srcRect.bottom()) / gk_glyphAtlasSize.y
+            };
+
+            add_tri_quad(topLeft, bottomRight, texCoordsTopLeft, texCoordsBottomRight, color);
+        }
+
+        pen.x += glyphInfo.horAdvance;
+    }
+}
+
+#endif
@@ -0,0 +1,34 @@
+// Immediate-mode drawing of world-space shapes and text for debugging. Primitives are appended to two streamed vertex batches which are drawn over the camera layers, one for lines and one for filled shapes and text, and kept until the next tick starts.
+// Without NDEBUG defined none of this exists, and calls compile to nothing.
+
+#pragma once
+
+#include <castle_common/cc_math.h>
+#include "c_assets.h"
+#include "c_rendering.h"
+
+#ifndef NDEBUG
+void init_debug_draw();
+void clean_debug_draw();
+void clear_debug_draw(); // Called at the start of each tick, so what is drawn is what the last tick added.
+bool has_debug_draw_changed(); // Whether primitives have been added or cleared since the last render.
+void render_debug_draw(const ShaderProgs &shaderProgs, const cc::Matrix4x4 &projMat, const cc::Matrix4x4 &viewMat, RenderStats &stats);
+
+void debug_draw_line(const cc::Vec2D a, const cc::Vec2D b, const Color &color);
+void debug_draw_rect(const cc::RectFloat &rect, const Color &color);
+void debug_draw_rect_filled(const cc::RectFloat &rect, const Color &color);
+void debug_draw_circle(const cc::Vec2D center, const float radius, const Color &color);
+void debug_draw_text(const cc::Vec2D pos, const char *const text, const Color &color, const AssetGroupManager &assetGroupManager);
+#else
+inline void init_debug_draw() {}
+inline void clean_debug_draw() {}
+inline void clear_debug_draw() {}
+inline bool has_debug_draw_changed() { return false; }
+inline void render_debug_draw(const ShaderProgs &, const cc::Matrix4x4 &, const cc::Matrix4x4 &, RenderStats &) {}
+
+inline void debug_draw_line(const cc::Vec2D, const cc::Vec2D, const Color &) {}
+inline void debug_draw_rect(const cc::RectFloat &, const Color &) {}
+inline void debug_draw_rect_filled(const cc::RectFloat &, const Color &) {}
+inline void debug_draw_circle(const cc::Vec2D, const float, const Color &) {}
+inline void debug_draw_text(const cc::Vec2D, const char *const, const Color &, const AssetGroupManager &) {}
+#endif
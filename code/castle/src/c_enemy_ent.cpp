@@ -1,6 +1,9 @@
 #include "c_world.h"
 
+#include <stdio.h>
+
 constexpr AssetID ik_texID = make_core_asset_id(cc::ENEMY_ENT_TEX); // TEMP: This will depend on enemy type.
+static constexpr AssetID ik_dmgNumFontID = make_core_asset_id(cc::EB_GARAMOND_18_FONT);
 
 static void write_enemy_ent_render_data(World &world, const int entIndex, const AssetGroupManager &assetGroupManager)
 {
@@ -15,30 +18,48 @@ static void write_enemy_ent_render_data(World &world, const int entIndex, const
         .origin = {0.5f, 0.5f},
         .rot = ent.rot,
         .scale = {1.0f, 1.0f},
-        .alpha = 1.0f
+        .alpha = 1.0f,
+        .palette = -1
     };
 
     write_to_sprite_batch_slot(world.renderer, world.playerEnt.sbSlotKey, writeData, assetGroupManager);
 }
 
-int spawn_enemy_ent(World &world, const cc::Vec2D pos, const AssetGroupManager &assetGroupManager)
+int spawn_enemy_ents(World &world, const cc::Vec2D *const positions, const int cnt, const AssetGroupManager &assetGroupManager)
 {
-    const int entIndex = first_inactive_bit_index(world.enemyEntActivity);
+    assert(cnt >= 0 && cnt <= gk_enemyEntLimit);
+
+    // Find room for as many of the entities as possible.
+    int entIndices[gk_enemyEntLimit];
+    int spawnCnt = 0;
 
-    if (entIndex != -1)
+    for (int i = 0; i < gk_enemyEntLimit && spawnCnt < cnt; ++i)
     {
-        activate_bit(world.enemyEntActivity, entIndex);
+        if (!is_bit_active(world.enemyEntActivity, i))
+        {
+            entIndices[spawnCnt] = i;
+            ++spawnCnt;
+        }
+    }
+
+    // Take the sprite batch slots of the whole wave at once.
+    SpriteBatchSlotKey sbSlotKeys[gk_enemyEntLimit];
+    spawnCnt = take_sprite_batch_slots(world.renderer, WORLD_ENEMY_ENT_LAYER, ik_texID, sbSlotKeys, spawnCnt);
 
-        EnemyEnt &ent = world.enemyEnts[entIndex];
+    for (int i = 0; i < spawnCnt; ++i)
+    {
+        activate_bit(world.enemyEntActivity, entIndices[i]);
 
-        ent = {
-            .sbSlotKey = take_any_sprite_batch_slot(world.renderer, WORLD_ENEMY_ENT_LAYER, ik_texID),
-            .pos = pos,
+        world.enemyEnts[entIndices[i]] = {
+            .sbSlotKey = sbSlotKeys[i],
+            .pos = positions[i],
+            .rot = 0.0f,
+            .vel = {},
             .hp = 8
         };
     }
 
-    return entIndex;
+    return spawnCnt;
 }
 
 void enemy_ent_tick(World &world, const int entIndex, const AssetGroupManager &assetGroupManager)
@@ -60,14 +81,15 @@ void enemy_ent_tick(World &world, const int entIndex, const AssetGroupManager &a
             .origin = {0.5f, 0.5f},
             .rot = ent.rot,
             .scale = {1.0f, 1.0f},
-            .alpha = 1.0f
+            .alpha = 1.0f,
+            .palette = -1
         };
 
         write_to_sprite_batch_slot(world.renderer, ent.sbSlotKey, writeData, assetGroupManager);
     }
 }
 
-void hurt_enemy_ent(World &world, const int entIndex, const int dmg, const cc::Vec2D force)
+void hurt_enemy_ent(World &world, const int entIndex, const int dmg, const cc::Vec2D force, const AssetGroupManager &assetGroupManager)
 {
     assert(is_bit_active(world.enemyEntActivity, entIndex));
 
@@ -76,6 +98,38 @@ void hurt_enemy_ent(World &world, const int entIndex, const int dmg, const cc::V
     ent.hp -= dmg;
     ent.vel += force; // Applies knockback.
 
+    // Spawn hit particles in the direction of the force.
+    const ParticleSpawnInfo particleSpawnInfo = {
+        .pos = ent.pos,
+        .dir = cc::calc_dir({}, force),
+        .dirSpread = cc::degs_to_rads(40.0f),
+        .spdMin = 1.5f,
+        .spdMax = 5.0f,
+        .sizeMin = 1.0f,
+        .sizeMax = 3.0f,
+        .rotVelMin = -0.3f,
+        .rotVelMax = 0.3f,
+        .lifeMin = 15,
+        .lifeMax = 30
+    };
+
+    spawn_particles(world.particleSys, particleSpawnInfo, 24);
+
+    // Show a damage number rising from the entity.
+    {
+        char dmgText[16];
+        snprintf(dmgText, sizeof(dmgText), "%d", dmg);
+
+        const TransientTextSpawnInfo dmgNumSpawnInfo = {
+            .pos = ent.pos,
+            .vel = {0.0f, -0.5f},
+            .color = gk_yellow,
+            .life = 40
+        };
+
+        spawn_transient_text(world.transientText, dmgText, ik_dmgNumFontID, dmgNumSpawnInfo, assetGroupManager);
+    }
+
     // Handle entity death.
     if (ent.hp <= 0)
     {
@@ -0,0 +1,473 @@
+#include "c_frame_capture.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <castle_common/cc_debugging.h>
+
+static constexpr int ik_readbackLimit = 3; // The number of captures which can be waiting on the GPU at once.
+static constexpr int ik_writeJobLimit = 2; // The number of captures which can be waiting on the writer thread at once.
+static constexpr int ik_filePathBufSize = 256;
+static constexpr int ik_pxSize = 4;
+
+static constexpr GLuint64 ik_cleanupReadbackTimeout = 1000000000; // In nanoseconds.
+
+struct FrameReadback
+{
+    GLID pxBufGLID;
+    GLsync fence; // Null if the readback is not in progress.
+    cc::Vec2DInt size;
+    FrameCaptureFormat format;
+    char filePath[ik_filePathBufSize];
+};
+
+struct FrameWriteJob
+{
+    cc::Byte *px; // Room for the size limit. Rows are bottom up, as read.
+    cc::Vec2DInt size;
+    FrameCaptureFormat format;
+    char filePath[ik_filePathBufSize];
+};
+
+static FrameReadback i_readbacks[ik_readbackLimit];
+static int i_readbackBegin; // The index of the oldest readback in progress. Readbacks are issued and completed in order.
+static int i_readbackCnt;
+
+static cc::Vec2DInt i_sizeLimit;
+
+// A queue of write jobs, shared with the writer thread. A queued job belongs to the writer thread until it has been written and removed from the queue.
+static FrameWriteJob i_writeJobs[ik_writeJobLimit];
+static int i_writeJobBegin;
+static int i_writeJobCnt;
+static bool i_writerStopping;
+static std::mutex i_writeJobMutex;
+static std::condition_variable i_writeJobCondVar;
+static std::thread i_writerThread;
+
+static unsigned int i_crcTable[256];
+
+static void init_crc_table()
+{
+    for (unsigned int i = 0; i < 256; ++i)
+    {
+        unsigned int crc = i;
+
+        for (int j = 0; j < 8; ++j)
+        {
+            crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+        }
+
+        i_crcTable[i] = crc;
+    }
+}
+
+static unsigned int update_crc(unsigned int crc, const cc::Byte *const data, const int len)
+{
+    for (int i = 0; i < len; ++i)
+    {
+        crc = i_crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+
+static void write_u32_be(FILE *const fs, const unsigned int val)
+{
+    const cc::Byte bytes[4] = {
+        static_cast<cc::Byte>(val >> 24),
+        static_cast<cc::Byte>(val >> 16),
+        static_cast<cc::Byte>(val >> 8),
+        static_cast<cc::Byte>(val)
+    };
+
+    fwrite(bytes, 1, sizeof(bytes), fs);
+}
+
+// Writes the data of a PNG chunk in parts, tracking its CRC, which covers the type and the data.
+struct PNGChunkWriter
+{
+    FILE *fs;
+    unsigned int crc;
+};
+
+static PNGChunkWriter begin_png_chunk(FILE *const fs, const char *const type, const unsigned int dataLen)
+{
+    write_u32_be(fs, dataLen);
+    fwrite(type, 1, 4, fs);
+
+    return {fs, update_crc(0xFFFFFFFFu, reinterpret_cast<const cc::Byte *>(type), 4)};
+}
+
+static void write_png_chunk_data(PNGChunkWriter &writer, const cc::Byte *const data, const int len)
+{
+    fwrite(data, 1, len, writer.fs);
+    writer.crc = update_crc(writer.crc, data, len);
+}
+
+static void end_png_chunk(const PNGChunkWriter &writer)
+{
+    write_u32_be(writer.fs, writer.crc ^ 0xFFFFFFFFu);
+}
+
+// Writes the pixels as an RGBA PNG whose image data is a zlib stream of stored deflate blocks, one per row, flipping the rows to be top down.
+static bool write_png(FILE *const fs, const cc::Byte *const px, const cc::Vec2DInt size)
+{
+    const int rowSize = ik_pxSize * size.x;
+    const int filteredRowSize = 1 + rowSize; // Each row is preceded by a filter type byte.
+
+    if (filteredRowSize > 0xFFFF)
+    {
+        return false; // Too wide for a row to fit into a single stored block.
+    }
+
+    static const cc::Byte sig[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    fwrite(sig, 1, sizeof(sig), fs);
+
+    // Write the header.
+    {
+        cc::Byte data[13] = {};
+
+        data[0] = static_cast<cc::Byte>(size.x >> 24);
+        data[1] = static_cast<cc::Byte>(size.x >> 16);
+        data[2] = static_cast<cc::Byte>(size.x >> 8);
+        data[3] = static_cast<cc::Byte>(size.x);
+        data[4] = static_cast<cc::Byte>(size.y >> 24);
+        data[5] = static_cast<cc::Byte>(size.y >> 16);
+        data[6] = static_cast<cc::Byte>(size.y >> 8);
+        data[7] = static_cast<cc::Byte>(size.y);
+        data[8] = 8; // Bit depth.
+        data[9] = 6; // Colour type, RGBA.
+
+        PNGChunkWriter writer = begin_png_chunk(fs, "IHDR", sizeof(data));
+        write_png_chunk_data(writer, data, sizeof(data));
+        end_png_chunk(writer);
+    }
+
+    // Write the image data.
+    {
+        const int blockHeaderSize = 5;
+        const unsigned int dataLen = 2 + ((blockHeaderSize + filteredRowSize) * size.y) + 4;
+
+        PNGChunkWriter writer = begin_png_chunk(fs, "IDAT", dataLen);
+
+        const cc::Byte zlibHeader[2] = {0x78, 0x01};
+        write_png_chunk_data(writer, zlibHeader, sizeof(zlibHeader));
+
+        unsigned int adlerA = 1;
+        unsigned int adlerB = 0;
+
+        const auto updateAdler = [&adlerA, &adlerB](const cc::Byte *const data, const int len)
+        {
+            for (int i = 0; i < len; ++i)
+            {
+                adlerA = (adlerA + data[i]) % 65521;
+                adlerB = (adlerB + adlerA) % 65521;
+            }
+        };
+
+        for (int y = 0; y < size.y; ++y)
+        {
+            const bool last = y == size.y - 1;
+
+            const cc::Byte blockHeader[blockHeaderSize] = {
+                static_cast<cc::Byte>(last),
+                static_cast<cc::Byte>(filteredRowSize),
+                static_cast<cc::Byte>(filteredRowSize >> 8),
+                static_cast<cc::Byte>(~filteredRowSize),
+                static_cast<cc::Byte>(~filteredRowSize >> 8)
+            };
+
+            write_png_chunk_data(writer, blockHeader, blockHeaderSize);
+
+            const cc::Byte filterType = 0;
+            write_png_chunk_data(writer, &filterType, 1);
+            updateAdler(&filterType, 1);
+
+            const cc::Byte *const row = px + (rowSize * (size.y - 1 - y));
+            write_png_chunk_data(writer, row, rowSize);
+            updateAdler(row, rowSize);
+        }
+
+        const unsigned int adler = (adlerB << 16) | adlerA;
+
+        const cc::Byte adlerBytes[4] = {
+            static_cast<cc::Byte>(adler >> 24),
+            static_cast<cc::Byte>(adler >> 16),
+            static_cast<cc::Byte>(adler >> 8),
+            static_cast<cc::Byte>(adler)
+        };
+
+        write_png_chunk_data(writer, adlerBytes, sizeof(adlerBytes));
+        end_png_chunk(writer);
+    }
+
+    // Write the end.
+    end_png_chunk(begin_png_chunk(fs, "IEND", 0));
+
+    return true;
+}
+
+static void write_raw(FILE *const fs, const cc::Byte *const px, const cc::Vec2DInt size)
+{
+    fwrite(&size, sizeof(size), 1, fs);
+
+    const int rowSize = ik_pxSize * size.x;
+
+    for (int y = size.y - 1; y >= 0; --y)
+    {
+        fwrite(px + (rowSize * y), 1, rowSize, fs);
+    }
+}
+
+static void write_frame(const FrameWriteJob &job)
+{
+    FILE *const fs = fopen(job.filePath, "wb");
+
+    if (!fs)
+    {
+        cc::log_error("Failed to open \"%s\" for writing a frame capture to.", job.filePath);
+        return;
+    }
+
+    bool success = true;
+
+    switch (job.format)
+    {
+        case FRAME_CAPTURE_FORMAT_RAW:
+            write_raw(fs, job.px, job.size);
+            break;
+
+        case FRAME_CAPTURE_FORMAT_PNG:
+            success = write_png(fs, job.px, job.size);
+            break;
+    }
+
+    fclose(fs);
+
+    if (!success)
+    {
+        cc::log_error("Failed to write the frame capture \"%s\".", job.filePath);
+    }
+}
+
+static void run_writer_thread()
+{
+    while (true)
+    {
+        int jobIndex;
+
+        {
+            std::unique_lock<std::mutex> lock(i_writeJobMutex);
+            i_writeJobCondVar.wait(lock, []() { return i_writeJobCnt > 0 || i_writerStopping; });
+
+            if (!i_writeJobCnt)
+            {
+                return; // Stopping, with nothing left to write.
+            }
+
+            jobIndex = i_writeJobBegin;
+        }
+
+        write_frame(i_writeJobs[jobIndex]);
+
+        {
+            std::lock_guard<std::mutex> lock(i_writeJobMutex);
+            i_writeJobBegin = (i_writeJobBegin + 1) % ik_writeJobLimit;
+            --i_writeJobCnt;
+        }
+
+        i_writeJobCondVar.notify_all();
+    }
+}
+
+// Copies the pixels of the oldest readback into a write job and queues it. If wait is false, this gives up rather than wait for the readback to complete or for room in the queue.
+static bool complete_readback(const bool wait)
+{
+    assert(i_readbackCnt > 0);
+
+    FrameReadback &readback = i_readbacks[i_readbackBegin];
+
+    const GLenum waitResult = wait ? glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, ik_cleanupReadbackTimeout) : glClientWaitSync(readback.fence, 0, 0);
+
+    if (waitResult == GL_TIMEOUT_EXPIRED)
+    {
+        if (!wait)
+        {
+            return false;
+        }
+
+        cc::log_error("Timed out waiting for the readback of the frame capture \"%s\".", readback.filePath);
+    }
+    else if (waitResult == GL_WAIT_FAILED)
+    {
+        cc::log_error("Failed to wait for the readback of the frame capture \"%s\".", readback.filePath);
+    }
+
+    int jobIndex = -1;
+
+    if (waitResult != GL_TIMEOUT_EXPIRED && waitResult != GL_WAIT_FAILED)
+    {
+        std::unique_lock<std::mutex> lock(i_writeJobMutex);
+
+        if (wait)
+        {
+            i_writeJobCondVar.wait(lock, []() { return i_writeJobCnt < ik_writeJobLimit; });
+        }
+        else if (i_writeJobCnt == ik_writeJobLimit)
+        {
+            return false;
+        }
+
+        jobIndex = (i_writeJobBegin + i_writeJobCnt) % ik_writeJobLimit;
+    }
+
+    // Copy the pixels into the job. The job is not yet queued, so the writer thread does not touch it.
+    if (jobIndex != -1)
+    {
+        FrameWriteJob &job = i_writeJobs[jobIndex];
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pxBufGLID);
+
+        const int pxDataSize = ik_pxSize * readback.size.x * readback.size.y;
+        const void *const pxData = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pxDataSize, GL_MAP_READ_BIT);
+
+        if (pxData)
+        {
+            memcpy(job.px, pxData, pxDataSize);
+            job.size = readback.size;
+            job.format = readback.format;
+            strncpy(job.filePath, readback.filePath, ik_filePathBufSize);
+        }
+        else
+        {
+            cc::log_error("Failed to map the readback of the frame capture \"%s\".", readback.filePath);
+            jobIndex = -1;
+        }
+
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    if (jobIndex != -1)
+    {
+        {
+            std::lock_guard<std::mutex> lock(i_writeJobMutex);
+            ++i_writeJobCnt;
+        }
+
+        i_writeJobCondVar.notify_all();
+    }
+
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+
+    i_readbackBegin = (i_readbackBegin + 1) % ik_readbackLimit;
+    --i_readbackCnt;
+
+    return true;
+}
+
+void init_frame_capture(cc::MemArena &permMemArena, const cc::Vec2DInt sizeLimit)
+{
+    assert(sizeLimit.x > 0 && sizeLimit.y > 0);
+
+    init_crc_table();
+
+    i_sizeLimit = sizeLimit;
+
+    for (int i = 0; i < ik_readbackLimit; ++i)
+    {
+        i_readbacks[i] = {};
+        glGenBuffers(1, &i_readbacks[i].pxBufGLID);
+    }
+
+    i_readbackBegin = 0;
+    i_readbackCnt = 0;
+
+    for (int i = 0; i < ik_writeJobLimit; ++i)
+    {
+        i_writeJobs[i] = {};
+        i_writeJobs[i].px = cc::push_to_mem_arena<cc::Byte>(permMemArena, ik_pxSize * sizeLimit.x * sizeLimit.y);
+    }
+
+    i_writeJobBegin = 0;
+    i_writeJobCnt = 0;
+    i_writerStopping = false;
+    i_writerThread = std::thread(run_writer_thread);
+}
+
+void clean_frame_capture()
+{
+    while (i_readbackCnt > 0)
+    {
+        complete_readback(true);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(i_writeJobMutex);
+        i_writerStopping = true;
+    }
+
+    i_writeJobCondVar.notify_all();
+    i_writerThread.join();
+
+    for (int i = 0; i < ik_readbackLimit; ++i)
+    {
+        glDeleteBuffers(1, &i_readbacks[i].pxBufGLID);
+        i_readbacks[i] = {};
+    }
+}
+
+bool capture_frame(const char *const filePath, const FrameCaptureFormat format, const GLID fbGLID, const cc::Vec2DInt size)
+{
+    assert(size.x > 0 && size.y > 0);
+
+    if (size.x > i_sizeLimit.x || size.y > i_sizeLimit.y)
+    {
+        cc::log_error("Failed to capture a frame of size %dx%d, as it is beyond the limit of %dx%d.", size.x, size.y, i_sizeLimit.x, i_sizeLimit.y);
+        return false;
+    }
+
+    if (i_readbackCnt == ik_readbackLimit)
+    {
+        cc::log_warning("Dropped the frame capture \"%s\", as too many captures are in progress.", filePath);
+        return false;
+    }
+
+    FrameReadback &readback = i_readbacks[(i_readbackBegin + i_readbackCnt) % ik_readbackLimit];
+    readback.size = size;
+    readback.format = format;
+    strncpy(readback.filePath, filePath, ik_filePathBufSize - 1);
+    readback.filePath[ik_filePathBufSize - 1] = '\0';
+
+    // Issue the readback into the pixel buffer, which returns without waiting for the pixels.
+    GLint readFBGLIDLast;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFBGLIDLast);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbGLID);
+    glReadBuffer(fbGLID ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pxBufGLID);
+    glBufferData(GL_PIXEL_PACK_BUFFER, ik_pxSize * size.x * size.y, nullptr, GL_STREAM_READ);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFBGLIDLast);
+
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    ++i_readbackCnt;
+
+    return true;
+}
+
+void update_frame_capture()
+{
+    while (i_readbackCnt > 0 && complete_readback(false))
+    {
+    }
+}
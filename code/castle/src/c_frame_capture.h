@@ -0,0 +1,19 @@
+// Captures rendered frames to files without stalling rendering. The pixels of a frame are read into one of a ring of pixel pack buffers, which is only mapped once a fence shows the GPU has finished with it, usually a few frames later.
+// The mapped pixels are copied out and handed to a background thread, which does the file writing, so a capture costs the render thread little more than a copy.
+
+#pragma once
+
+#include <castle_common/cc_math.h>
+#include <castle_common/cc_mem.h>
+#include "c_utils.h"
+
+enum FrameCaptureFormat
+{
+    FRAME_CAPTURE_FORMAT_RAW, // The width and height as ints, followed by the rows of RGBA pixels from the top down.
+    FRAME_CAPTURE_FORMAT_PNG // Uncompressed, so that writing does not hold up the writer thread behind captures.
+};
+
+void init_frame_capture(cc::MemArena &permMemArena, const cc::Vec2DInt sizeLimit); // Reserves room for pixels of up to the size limit for each capture waiting to be written.
+void clean_frame_capture(); // Finishes all captures in progress, writing their files, before returning.
+bool capture_frame(const char *const filePath, const FrameCaptureFormat format, const GLID fbGLID, const cc::Vec2DInt size); // Reads the colour of the framebuffer, or of the default framebuffer if zero, as it will be once what has been drawn so far completes. Returns false if the size is beyond the limit or too many captures are in progress.
+void update_frame_capture(); // Called every frame, passing captures whose readbacks have completed on to the writer thread.
@@ -0,0 +1,148 @@
+#include "c_frame_pacer.h"
+
+#include <assert.h>
+#include <math.h>
+#include <algorithm>
+#include <GLFW/glfw3.h>
+#include <castle_common/cc_debugging.h>
+
+#ifdef _WIN32
+#include <chrono>
+#include <thread>
+#else
+#include <errno.h>
+#include <time.h>
+#endif
+
+static constexpr double ik_spinDur = 0.002; // How long before a deadline to stop sleeping and start spinning, in seconds. Covers the usual oversleep of the OS scheduler.
+
+static void sleep_for(const double dur)
+{
+    if (dur <= 0.0)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    std::this_thread::sleep_for(std::chrono::duration<double>(dur));
+#else
+    timespec req;
+    req.tv_sec = static_cast<time_t>(dur);
+    req.tv_nsec = static_cast<long>((dur - req.tv_sec) * 1e9);
+
+    // Resume the sleep if it gets interrupted by a signal.
+    while (clock_nanosleep(CLOCK_MONOTONIC, 0, &req, &req) == EINTR)
+    {
+    }
+#endif
+}
+
+static void wait_until(const double time)
+{
+    sleep_for(time - glfwGetTime() - ik_spinDur);
+
+    while (glfwGetTime() < time)
+    {
+    }
+}
+
+void init_frame_pacer(FramePacer &pacer, const int targFrameRate, const int swapInterval)
+{
+    assert(targFrameRate >= 0);
+    assert(swapInterval >= 0);
+
+    pacer = {};
+
+    pacer.targFrameDur = targFrameRate > 0 ? 1.0 / targFrameRate : 0.0;
+
+    glfwSwapInterval(swapInterval);
+
+    pacer.frameTimeLast = glfwGetTime();
+    pacer.frameDeadline = pacer.frameTimeLast + pacer.targFrameDur;
+}
+
+static void wait_for_frame_deadline(FramePacer &pacer)
+{
+    assert(pacer.targFrameDur > 0.0);
+
+    wait_until(pacer.frameDeadline);
+
+    // Schedule the next deadline off the previous one rather than the current time so that oversleeps do not accumulate, unless the frame ran so long that catching up would mean rushing several frames.
+    pacer.frameDeadline += pacer.targFrameDur;
+
+    const double time = glfwGetTime();
+
+    if (pacer.frameDeadline < time)
+    {
+        pacer.frameDeadline = time + pacer.targFrameDur;
+    }
+}
+
+void pace_frame(FramePacer &pacer)
+{
+    if (pacer.targFrameDur > 0.0)
+    {
+        wait_for_frame_deadline(pacer);
+    }
+
+    // Record the duration of the frame.
+    const double frameTime = glfwGetTime();
+
+    pacer.frameDurHist[pacer.frameDurHistIndex] = frameTime - pacer.frameTimeLast;
+    pacer.frameDurHistIndex = (pacer.frameDurHistIndex + 1) % FramePacer::sk_frameDurHistLen;
+    pacer.frameDurHistCnt = std::min(pacer.frameDurHistCnt + 1, FramePacer::sk_frameDurHistLen);
+
+    pacer.frameTimeLast = frameTime;
+}
+
+void pace_idle_frame(FramePacer &pacer, const double waitDur)
+{
+    assert(waitDur >= 0.0);
+
+    if (pacer.targFrameDur > 0.0)
+    {
+        wait_for_frame_deadline(pacer);
+    }
+    else
+    {
+        sleep_for(waitDur);
+    }
+
+    // Start the next frame from here, so that the recorded durations do not include time spent idle.
+    pacer.frameTimeLast = glfwGetTime();
+}
+
+FramePacerStats calc_frame_pacer_stats(const FramePacer &pacer)
+{
+    FramePacerStats stats = {};
+
+    if (!pacer.frameDurHistCnt)
+    {
+        return stats;
+    }
+
+    for (int i = 0; i < pacer.frameDurHistCnt; ++i)
+    {
+        stats.frameDurAvg += pacer.frameDurHist[i];
+        stats.frameDurMax = std::max(pacer.frameDurHist[i], stats.frameDurMax);
+    }
+
+    stats.frameDurAvg /= pacer.frameDurHistCnt;
+
+    double variance = 0.0;
+
+    for (int i = 0; i < pacer.frameDurHistCnt; ++i)
+    {
+        const double diff = pacer.frameDurHist[i] - stats.frameDurAvg;
+        variance += diff * diff;
+    }
+
+    stats.frameDurJitter = sqrt(variance / pacer.frameDurHistCnt);
+
+    return stats;
+}
+
+void log_frame_pacer_stats(const FramePacerStats &stats)
+{
+    cc::log("Frame pacing: %.3f ms average, %.3f ms jitter, %.3f ms max.", stats.frameDurAvg * 1000.0, stats.frameDurJitter * 1000.0, stats.frameDurMax * 1000.0);
+}
@@ -0,0 +1,31 @@
+// The frame pacer holds each frame back until its deadline, so that frames are evenly spaced and the loop does not spin when vertical sync is off.
+// Waiting is done by sleeping for most of the remaining time and then spinning for the rest, as sleeps alone overshoot by too much to hit a deadline reliably.
+
+#pragma once
+
+struct FramePacer
+{
+    static constexpr int sk_frameDurHistLen = 240;
+
+    double targFrameDur; // Zero if the frame rate is not capped, in which case pacing is left to vertical sync.
+    double frameDeadline;
+    double frameTimeLast;
+
+    // A ring of recent frame durations, used to measure jitter.
+    double frameDurHist[sk_frameDurHistLen];
+    int frameDurHistCnt;
+    int frameDurHistIndex;
+};
+
+struct FramePacerStats
+{
+    double frameDurAvg; // In seconds.
+    double frameDurJitter; // The standard deviation of frame durations, in seconds.
+    double frameDurMax;
+};
+
+void init_frame_pacer(FramePacer &pacer, const int targFrameRate, const int swapInterval); // A target frame rate of zero leaves the frame rate uncapped.
+void pace_frame(FramePacer &pacer); // Waits until the deadline of the current frame and records its duration.
+void pace_idle_frame(FramePacer &pacer, const double waitDur); // For frames in which nothing was rendered. Waits until the deadline of the frame, or for the given duration if the frame rate is not capped, and leaves the frame out of the recorded durations.
+FramePacerStats calc_frame_pacer_stats(const FramePacer &pacer);
+void log_frame_pacer_stats(const FramePacerStats &stats);
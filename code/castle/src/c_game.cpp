@@ -2,6 +2,9 @@
 
 #include <castle_common/cc_debugging.h>
 #include "c_rand.h"
+#include "c_debug_draw.h"
+#include "c_frame_capture.h"
+#include "c_gl_recorder.h"
 
 static constexpr int ik_permMemArenaSize = (1 << 20) * 256;
 static constexpr int ik_tempMemArenaSize = (1 << 20) * 64;
@@ -14,6 +17,32 @@ static const char *const ik_windowTitle = "Castle";
 static constexpr int ik_targTicksPerSec = 60;
 static constexpr double ik_targTickDur = 1.0 / ik_targTicksPerSec;
 
+static constexpr int ik_swapInterval = 1; // The number of screen updates to wait for before swapping buffers, with zero disabling vertical sync.
+static constexpr int ik_targFrameRate = 0; // Frames are held back to this rate if above zero, which keeps the loop from spinning when vertical sync is off.
+
+static constexpr bool ik_gpuSpriteCulling = false; // Whether to cull sprites with a compute shader where OpenGL 4.3 is available.
+
+static constexpr int ik_lowResScale = 1; // Camera layers are rendered at the window resolution divided by this and then scaled up.
+static constexpr bool ik_dynamicLowResScale = false; // Whether to adjust the low resolution scale from the measured GPU time of the camera layers, starting from the scale above.
+static constexpr int ik_lowResScaleMax = 4;
+static constexpr double ik_camLayerGPUBudget = ik_targTickDur * 0.5; // In seconds.
+
+static constexpr double ik_spriteBatchCompactionTimeBudget = 0.0002; // In seconds, per frame.
+
+static constexpr bool ik_waitForEventsWhenIdle = true; // Whether to block on events after a frame in which nothing needed to be rendered, rather than polling.
+
+static constexpr int ik_renderStatsLogInterval = 0; // In frames. Render statistics are only logged if this is above zero.
+static constexpr bool ik_spriteBatchBreakRecording = false; // Whether to record why sprite batches break, for a report logged alongside the render statistics.
+static constexpr int ik_spriteBatchBreakReportTexLimit = 8;
+
+static constexpr int ik_frameCaptureInterval = 0; // In rendered frames. Frames are only captured if this is above zero.
+static constexpr FrameCaptureFormat ik_frameCaptureFormat = FRAME_CAPTURE_FORMAT_PNG;
+static constexpr cc::Vec2DInt ik_frameCaptureSizeLimit = {2560, 1440};
+
+static constexpr int ik_glRecordingStartFrame = 0; // In rendered frames. The GL commands of frames are only recorded, for castle_gl_replay, if this is above zero.
+static constexpr int ik_glRecordingFrameCnt = 600;
+static const char *const ik_glRecordingFilePath = "frames.glrec";
+
 static cc::Vec2DInt i_windowSize = {1280, 720};
 
 static inline double calc_valid_frame_dur(const double frameTime, const double frameTimeLast)
@@ -69,6 +98,7 @@ GameCleanupInfoBitset init_game(Game &game)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, ik_glVersionMajor);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, ik_glVersionMinor);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_DEPTH_BITS, 24); // Used by the opaque sprite pass.
     glfwWindowHint(GLFW_VISIBLE, false); // Show the window later once other things have been set up.
 
     // TODO: Set minimum window size.
@@ -98,6 +128,25 @@ GameCleanupInfoBitset init_game(Game &game)
     // Initialise rendering internals.
     init_rendering_internals();
 
+    cleanupInfoBitset |= RENDERING_INTERNALS_CLEANUP_BIT;
+
+    if (ik_gpuSpriteCulling && !set_gpu_sprite_culling(true))
+    {
+        cc::log_warning("GPU sprite culling requires OpenGL 4.3, so sprites will be drawn without culling.");
+    }
+
+    set_sprite_batch_break_recording(ik_spriteBatchBreakRecording);
+
+    // Set up frame capture.
+    if (ik_frameCaptureInterval > 0)
+    {
+        init_frame_capture(game.permMemArena, ik_frameCaptureSizeLimit);
+        cleanupInfoBitset |= FRAME_CAPTURE_CLEANUP_BIT;
+    }
+
+    // Set up frame pacing.
+    init_frame_pacer(game.framePacer, ik_targFrameRate, ik_swapInterval);
+
     // Enable blending.
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -146,7 +195,10 @@ GameCleanupInfoBitset init_game(Game &game)
     glfwSetScrollCallback(game.glfwWindow, glfw_scroll_callback);
 
     // Set up animation types.
-    init_core_anim_types(game.permMemArena);
+    if (!init_core_anim_types(game.permMemArena, game.assetGroupManager))
+    {
+        return cleanupInfoBitset;
+    }
 
     // Initialise the main menu.
     init_main_menu(game.mainMenu, game.permMemArena, game.tempMemArena, game.assetGroupManager);
@@ -161,6 +213,9 @@ void run_game_loop(Game &game)
 {
     double frameTime = glfwGetTime();
     double frameDurAccum = 0.0;
+    int frameCnt = 0;
+    bool idle = false;
+    bool glRecordingBegun = false;
 
     cc::log("Entering the game loop...");
 
@@ -170,7 +225,15 @@ void run_game_loop(Game &game)
 
         const cc::Vec2DInt windowSizeBeforePoll = i_windowSize;
 
-        glfwPollEvents();
+        if (ik_waitForEventsWhenIdle && idle)
+        {
+            // Nothing changed last frame, so sleep until there is input or the next tick is due.
+            glfwWaitEventsTimeout(std::max(ik_targTickDur - frameDurAccum, 0.0));
+        }
+        else
+        {
+            glfwPollEvents();
+        }
 
         glfwGetWindowSize(game.glfwWindow, &i_windowSize.x, &i_windowSize.y);
 
@@ -179,9 +242,14 @@ void run_game_loop(Game &game)
             // A change in window size has been detected.
             glViewport(0, 0, i_windowSize.x, i_windowSize.y);
 
-            if (!game.inWorld)
+            if (game.inWorld)
+            {
+                mark_renderer_dirty(game.world.renderer);
+            }
+            else
             {
                 main_menu_on_window_resize(game.mainMenu);
+                mark_renderer_dirty(game.mainMenu.renderer);
             }
         }
 
@@ -208,6 +276,9 @@ void run_game_loop(Game &game)
 
             do
             {
+                // Debug primitives are added by ticks, so drop those of the last.
+                clear_debug_draw();
+
                 if (game.inWorld)
                 {
                     // Execute world tick.
@@ -225,7 +296,14 @@ void run_game_loop(Game &game)
                         cc::log("Going to world...");
                         clean_main_menu(game.mainMenu);
                         game.inWorld = true;
-                        init_world(game.world, game.musicManager, game.permMemArena, game.tempMemArena, game.assetGroupManager);
+
+                        if (!init_world(game.world, game.musicManager, game.permMemArena, game.tempMemArena, game.assetGroupManager))
+                        {
+                            cc::log_error("Failed to initialise the world.");
+                            return;
+                        }
+
+                        set_low_res_scale(game.world.renderer, ik_lowResScale);
                     }
                 }
 
@@ -235,19 +313,79 @@ void run_game_loop(Game &game)
             while (i < tickCnt);
         }
 
-        // Render.
-        if (game.inWorld)
+        // Render, but only if something has changed since the last frame.
+        Renderer &renderer = game.inWorld ? game.world.renderer : game.mainMenu.renderer;
+        const Camera *const cam = game.inWorld ? &game.world.cam : nullptr;
+
+        if (ik_glRecordingStartFrame > 0 && !glRecordingBegun && frameCnt + 1 >= ik_glRecordingStartFrame)
         {
-            submit_sprite_batch_slots(game.world.renderer);
-            render(game.world.renderer, gk_black, game.assetGroupManager, game.shaderProgs, &game.world.cam);
+            // Begin before compaction and submission so that the uploads of the frame are recorded along with its draws.
+            if (!begin_gl_recording(ik_glRecordingFilePath, i_windowSize, game.shaderProgs, game.assetGroupManager))
+            {
+                cc::log_error("Failed to begin GL recording, so none will be made this run.");
+            }
+
+            glRecordingBegun = true; // Even on failure, so that it is not attempted again every frame.
         }
-        else
+
+        compact_sprite_batches(renderer, ik_spriteBatchCompactionTimeBudget);
+        submit_sprite_batch_slots(renderer);
+
+        if (ik_frameCaptureInterval > 0)
+        {
+            update_frame_capture();
+        }
+
+        idle = !is_render_needed(renderer, cam);
+
+        if (idle)
+        {
+            // Sleep until the next tick is due, unless the wait for events at the top of the loop is going to.
+            pace_idle_frame(game.framePacer, ik_waitForEventsWhenIdle ? 0.0 : std::max(ik_targTickDur - frameDurAccum, 0.0));
+            continue;
+        }
+
+        render(renderer, gk_black, game.assetGroupManager, game.shaderProgs, cam);
+
+        if (ik_dynamicLowResScale && cam)
+        {
+            adapt_low_res_scale(renderer, ik_camLayerGPUBudget, ik_lowResScaleMax);
+        }
+
+        ++frameCnt;
+
+        if (ik_frameCaptureInterval > 0 && frameCnt % ik_frameCaptureInterval == 0)
+        {
+            char filePath[64];
+            snprintf(filePath, sizeof(filePath), ik_frameCaptureFormat == FRAME_CAPTURE_FORMAT_PNG ? "frame_%06d.png" : "frame_%06d.raw", frameCnt);
+            capture_frame(filePath, ik_frameCaptureFormat, 0, i_windowSize);
+        }
+
+        if (ik_renderStatsLogInterval > 0 && frameCnt % ik_renderStatsLogInterval == 0)
+        {
+            log_render_stats(get_render_stats(renderer));
+            log_frame_pacer_stats(calc_frame_pacer_stats(game.framePacer));
+
+            if (ik_spriteBatchBreakRecording)
+            {
+                log_sprite_batch_break_report(ik_spriteBatchBreakReportTexLimit);
+                clear_sprite_batch_breaks(); // So that each report covers only its own interval.
+            }
+        }
+
+        if (is_gl_recording())
         {
-            submit_sprite_batch_slots(game.mainMenu.renderer);
-            render(game.mainMenu.renderer, gk_black, game.assetGroupManager, game.shaderProgs, nullptr);
+            end_gl_recording_frame();
+
+            if (frameCnt + 1 >= ik_glRecordingStartFrame + ik_glRecordingFrameCnt)
+            {
+                end_gl_recording();
+            }
         }
 
         glfwSwapBuffers(game.glfwWindow);
+
+        pace_frame(game.framePacer);
     }
 }
 
@@ -255,6 +393,11 @@ void clean_game(Game &game, const GameCleanupInfoBitset infoBitset)
 {
     cc::log("Cleaning up...");
 
+    if (is_gl_recording())
+    {
+        end_gl_recording();
+    }
+
     if (infoBitset & MAIN_MENU_OR_WORLD_CLEANUP_BIT)
     {
         if (game.inWorld)
@@ -290,6 +433,16 @@ void clean_game(Game &game, const GameCleanupInfoBitset infoBitset)
         alcCloseDevice(game.alDevice);
     }
 
+    if (infoBitset & FRAME_CAPTURE_CLEANUP_BIT)
+    {
+        clean_frame_capture();
+    }
+
+    if (infoBitset & RENDERING_INTERNALS_CLEANUP_BIT)
+    {
+        clean_rendering_internals();
+    }
+
     if (infoBitset & GLFW_WINDOW_CLEANUP_BIT)
     {
         glfwDestroyWindow(game.glfwWindow);
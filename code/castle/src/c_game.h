@@ -11,6 +11,7 @@
 #include "c_audio.h"
 #include "c_main_menu.h"
 #include "c_world.h"
+#include "c_frame_pacer.h"
 
 using GameCleanupInfoBitset = unsigned short;
 
@@ -20,11 +21,13 @@ enum GameCleanupInfoBits : GameCleanupInfoBitset
     TEMP_MEM_ARENA_CLEANUP_BIT = 1 << 1,
     GLFW_CLEANUP_BIT = 1 << 2,
     GLFW_WINDOW_CLEANUP_BIT = 1 << 3,
-    AL_DEVICE_CLEANUP_BIT = 1 << 4,
-    AL_CONTEXT_CLEANUP_BIT = 1 << 5,
-    ASSET_GROUP_MANAGER_CLEANUP_BIT = 1 << 6,
-    SHADER_PROGS_CLEANUP_BIT = 1 << 7,
-    MAIN_MENU_OR_WORLD_CLEANUP_BIT = 1 << 8
+    RENDERING_INTERNALS_CLEANUP_BIT = 1 << 4,
+    AL_DEVICE_CLEANUP_BIT = 1 << 5,
+    AL_CONTEXT_CLEANUP_BIT = 1 << 6,
+    ASSET_GROUP_MANAGER_CLEANUP_BIT = 1 << 7,
+    SHADER_PROGS_CLEANUP_BIT = 1 << 8,
+    MAIN_MENU_OR_WORLD_CLEANUP_BIT = 1 << 9,
+    FRAME_CAPTURE_CLEANUP_BIT = 1 << 10
 };
 
 struct Game
@@ -34,6 +37,8 @@ struct Game
 
     GLFWwindow *glfwWindow;
 
+    FramePacer framePacer;
+
     ALCdevice *alDevice;
     ALCcontext *alContext;
 
@@ -0,0 +1,1285 @@
+#include "c_gl_recorder.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <castle_common/cc_debugging.h>
+#include <castle_common/cc_gl_recording.h>
+#include <castle_common/cc_misc.h>
+
+static constexpr int ik_readbackChunkSize = 1 << 16;
+static constexpr int ik_vertAttribLimit = 16;
+static constexpr int ik_progUniformLimit = 256;
+static constexpr int ik_uniformNameBufSize = 64;
+
+static constexpr GLenum ik_fbAttachmentPoints[] = {
+    GL_COLOR_ATTACHMENT0,
+    GL_COLOR_ATTACHMENT1,
+    GL_COLOR_ATTACHMENT2,
+    GL_COLOR_ATTACHMENT3,
+    GL_DEPTH_ATTACHMENT,
+    GL_STENCIL_ATTACHMENT
+};
+
+static constexpr int ik_fbAttachmentPointCnt = CC_STATIC_ARRAY_LEN(ik_fbAttachmentPoints);
+
+// The GL functions swapped out while recording, as their names without the prefix paired with the functions recording them.
+#define GL_RECORDER_HOOKS(X) \
+    X(GenBuffers, record_gen_bufs) \
+    X(DeleteBuffers, record_delete_bufs) \
+    X(GenTextures, record_gen_texs) \
+    X(DeleteTextures, record_delete_texs) \
+    X(GenVertexArrays, record_gen_vert_arrays) \
+    X(DeleteVertexArrays, record_delete_vert_arrays) \
+    X(GenFramebuffers, record_gen_framebufs) \
+    X(DeleteFramebuffers, record_delete_framebufs) \
+    X(GenRenderbuffers, record_gen_renderbufs) \
+    X(DeleteRenderbuffers, record_delete_renderbufs) \
+    X(BindBuffer, record_bind_buf) \
+    X(BindBufferBase, record_bind_buf_base) \
+    X(BindVertexArray, record_bind_vert_array) \
+    X(BindTexture, record_bind_tex) \
+    X(ActiveTexture, record_active_tex) \
+    X(BindFramebuffer, record_bind_framebuf) \
+    X(BindRenderbuffer, record_bind_renderbuf) \
+    X(UseProgram, record_use_prog) \
+    X(Enable, record_enable) \
+    X(Disable, record_disable) \
+    X(DepthFunc, record_depth_func) \
+    X(DepthMask, record_depth_mask) \
+    X(BlendFunc, record_blend_func) \
+    X(BlendFuncSeparate, record_blend_func_separate) \
+    X(Viewport, record_viewport) \
+    X(ClearColor, record_clear_color) \
+    X(Clear, record_clear) \
+    X(PixelStorei, record_pixel_store) \
+    X(MemoryBarrier, record_mem_barrier) \
+    X(BufferData, record_buf_data) \
+    X(BufferSubData, record_buf_sub_data) \
+    X(CopyBufferSubData, record_copy_buf_sub_data) \
+    X(TexImage2D, record_tex_image_2d) \
+    X(TexSubImage2D, record_tex_sub_image_2d) \
+    X(TexParameteri, record_tex_param) \
+    X(RenderbufferStorage, record_renderbuf_storage) \
+    X(FramebufferTexture2D, record_framebuf_tex_2d) \
+    X(FramebufferRenderbuffer, record_framebuf_renderbuf) \
+    X(VertexAttribPointer, record_vert_attrib_pointer) \
+    X(VertexAttribIPointer, record_vert_attrib_i_pointer) \
+    X(EnableVertexAttribArray, record_enable_vert_attrib_array) \
+    X(Uniform1i, record_uniform_1i) \
+    X(Uniform1f, record_uniform_1f) \
+    X(Uniform1iv, record_uniform_1iv) \
+    X(Uniform2fv, record_uniform_2fv) \
+    X(Uniform4fv, record_uniform_4fv) \
+    X(UniformMatrix4fv, record_uniform_matrix_4fv) \
+    X(DrawArrays, record_draw_arrays) \
+    X(DrawElementsBaseVertex, record_draw_elems_base_vert) \
+    X(MultiDrawElementsBaseVertex, record_multi_draw_elems_base_vert) \
+    X(MultiDrawElementsIndirect, record_multi_draw_elems_indirect) \
+    X(DispatchCompute, record_dispatch_compute) \
+    X(BlitFramebuffer, record_blit_framebuf)
+
+// The original functions, called through by those recording them.
+#define DECLARE_GL_RECORDER_ORIG(name, hook) static decltype(glad_gl##name) i_gl##name;
+GL_RECORDER_HOOKS(DECLARE_GL_RECORDER_ORIG)
+#undef DECLARE_GL_RECORDER_ORIG
+
+// The state written out when recording begins, as well as what the snapshot of objects has to restore.
+struct GLRecordingState
+{
+    GLint viewport[4];
+    GLfloat clearColor[4];
+    GLboolean blend;
+    GLint blendSrc;
+    GLint blendDst;
+    GLboolean depthTest;
+    GLint depthFunc;
+    GLboolean depthMask;
+    GLint unpackAlignment;
+    GLint progGLID;
+    GLint vertArrayGLID;
+    GLint drawFramebufGLID;
+    GLint readFramebufGLID;
+    GLint renderbufGLID;
+    GLint arrayBufGLID;
+    GLint drawIndirectBufGLID;
+    GLint activeTexUnit;
+    GLint texGLIDs[cc::gk_glRecordingTexUnitLimit];
+    GLint uniformBufGLIDs[cc::gk_glRecordingBufBindingPointLimit];
+    GLint storageBufGLIDs[cc::gk_glRecordingBufBindingPointLimit];
+};
+
+struct GLRecordingUniform
+{
+    int loc;
+    char name[ik_uniformNameBufSize];
+};
+
+static FILE *i_fs; // Null if not recording.
+static int i_frameCnt;
+static int i_unpackAlignment; // Tracked to work out the size of uploaded pixel data.
+
+static cc::Byte i_readbackChunk[ik_readbackChunkSize];
+
+static void write_op(const cc::GLRecordingOpcode op)
+{
+    const cc::Byte opByte = static_cast<cc::Byte>(op);
+    fwrite(&opByte, 1, 1, i_fs);
+}
+
+static void write_int(const int val)
+{
+    fwrite(&val, sizeof(val), 1, i_fs);
+}
+
+static void write_float(const float val)
+{
+    fwrite(&val, sizeof(val), 1, i_fs);
+}
+
+static void write_data(const void *const data, const int size)
+{
+    if (size > 0)
+    {
+        fwrite(data, 1, size, i_fs);
+    }
+}
+
+static inline int ptr_to_offs(const void *const ptr)
+{
+    return static_cast<int>(reinterpret_cast<intptr_t>(ptr));
+}
+
+static void write_names(const cc::GLRecordingOpcode op, const GLsizei cnt, const GLuint *const names)
+{
+    write_op(op);
+    write_int(cnt);
+
+    for (int i = 0; i < cnt; ++i)
+    {
+        assert(names[i] < cc::gk_glRecordingNameLimit && "A GL object name is beyond the recording limit!");
+        write_int(names[i]);
+    }
+}
+
+static int calc_px_data_size(const GLsizei width, const GLsizei height, const GLenum format, const GLenum type)
+{
+    if (width <= 0 || height <= 0)
+    {
+        return 0;
+    }
+
+    const int channelCnt = format == GL_RED ? 1 : (format == GL_RG ? 2 : (format == GL_RGB ? 3 : 4));
+    const int channelSize = type == GL_FLOAT ? 4 : 1;
+    const int rowSize = width * channelCnt * channelSize;
+    const int rowPitch = ((rowSize + i_unpackAlignment - 1) / i_unpackAlignment) * i_unpackAlignment;
+
+    return (rowPitch * (height - 1)) + rowSize;
+}
+
+//
+// Recording Functions
+//
+static void APIENTRY record_gen_bufs(const GLsizei cnt, GLuint *const bufGLIDs)
+{
+    i_glGenBuffers(cnt, bufGLIDs);
+    write_names(cc::GL_REC_GEN_BUFS, cnt, bufGLIDs);
+}
+
+static void APIENTRY record_delete_bufs(const GLsizei cnt, const GLuint *const bufGLIDs)
+{
+    write_names(cc::GL_REC_DELETE_BUFS, cnt, bufGLIDs);
+    i_glDeleteBuffers(cnt, bufGLIDs);
+}
+
+static void APIENTRY record_gen_texs(const GLsizei cnt, GLuint *const texGLIDs)
+{
+    i_glGenTextures(cnt, texGLIDs);
+    write_names(cc::GL_REC_GEN_TEXS, cnt, texGLIDs);
+}
+
+static void APIENTRY record_delete_texs(const GLsizei cnt, const GLuint *const texGLIDs)
+{
+    write_names(cc::GL_REC_DELETE_TEXS, cnt, texGLIDs);
+    i_glDeleteTextures(cnt, texGLIDs);
+}
+
+static void APIENTRY record_gen_vert_arrays(const GLsizei cnt, GLuint *const vertArrayGLIDs)
+{
+    i_glGenVertexArrays(cnt, vertArrayGLIDs);
+    write_names(cc::GL_REC_GEN_VERT_ARRAYS, cnt, vertArrayGLIDs);
+}
+
+static void APIENTRY record_delete_vert_arrays(const GLsizei cnt, const GLuint *const vertArrayGLIDs)
+{
+    write_names(cc::GL_REC_DELETE_VERT_ARRAYS, cnt, vertArrayGLIDs);
+    i_glDeleteVertexArrays(cnt, vertArrayGLIDs);
+}
+
+static void APIENTRY record_gen_framebufs(const GLsizei cnt, GLuint *const framebufGLIDs)
+{
+    i_glGenFramebuffers(cnt, framebufGLIDs);
+    write_names(cc::GL_REC_GEN_FRAMEBUFS, cnt, framebufGLIDs);
+}
+
+static void APIENTRY record_delete_framebufs(const GLsizei cnt, const GLuint *const framebufGLIDs)
+{
+    write_names(cc::GL_REC_DELETE_FRAMEBUFS, cnt, framebufGLIDs);
+    i_glDeleteFramebuffers(cnt, framebufGLIDs);
+}
+
+static void APIENTRY record_gen_renderbufs(const GLsizei cnt, GLuint *const renderbufGLIDs)
+{
+    i_glGenRenderbuffers(cnt, renderbufGLIDs);
+    write_names(cc::GL_REC_GEN_RENDERBUFS, cnt, renderbufGLIDs);
+}
+
+static void APIENTRY record_delete_renderbufs(const GLsizei cnt, const GLuint *const renderbufGLIDs)
+{
+    write_names(cc::GL_REC_DELETE_RENDERBUFS, cnt, renderbufGLIDs);
+    i_glDeleteRenderbuffers(cnt, renderbufGLIDs);
+}
+
+static void APIENTRY record_bind_buf(const GLenum target, const GLuint bufGLID)
+{
+    write_op(cc::GL_REC_BIND_BUF);
+    write_int(target);
+    write_int(bufGLID);
+
+    i_glBindBuffer(target, bufGLID);
+}
+
+static void APIENTRY record_bind_buf_base(const GLenum target, const GLuint index, const GLuint bufGLID)
+{
+    write_op(cc::GL_REC_BIND_BUF_BASE);
+    write_int(target);
+    write_int(index);
+    write_int(bufGLID);
+
+    i_glBindBufferBase(target, index, bufGLID);
+}
+
+static void APIENTRY record_bind_vert_array(const GLuint vertArrayGLID)
+{
+    write_op(cc::GL_REC_BIND_VERT_ARRAY);
+    write_int(vertArrayGLID);
+
+    i_glBindVertexArray(vertArrayGLID);
+}
+
+static void APIENTRY record_bind_tex(const GLenum target, const GLuint texGLID)
+{
+    write_op(cc::GL_REC_BIND_TEX);
+    write_int(target);
+    write_int(texGLID);
+
+    i_glBindTexture(target, texGLID);
+}
+
+static void APIENTRY record_active_tex(const GLenum texUnit)
+{
+    write_op(cc::GL_REC_ACTIVE_TEX);
+    write_int(texUnit);
+
+    i_glActiveTexture(texUnit);
+}
+
+static void APIENTRY record_bind_framebuf(const GLenum target, const GLuint framebufGLID)
+{
+    write_op(cc::GL_REC_BIND_FRAMEBUF);
+    write_int(target);
+    write_int(framebufGLID);
+
+    i_glBindFramebuffer(target, framebufGLID);
+}
+
+static void APIENTRY record_bind_renderbuf(const GLenum target, const GLuint renderbufGLID)
+{
+    write_op(cc::GL_REC_BIND_RENDERBUF);
+    write_int(target);
+    write_int(renderbufGLID);
+
+    i_glBindRenderbuffer(target, renderbufGLID);
+}
+
+static void APIENTRY record_use_prog(const GLuint progGLID)
+{
+    write_op(cc::GL_REC_USE_PROG);
+    write_int(progGLID);
+
+    i_glUseProgram(progGLID);
+}
+
+static void APIENTRY record_enable(const GLenum cap)
+{
+    write_op(cc::GL_REC_ENABLE);
+    write_int(cap);
+
+    i_glEnable(cap);
+}
+
+static void APIENTRY record_disable(const GLenum cap)
+{
+    write_op(cc::GL_REC_DISABLE);
+    write_int(cap);
+
+    i_glDisable(cap);
+}
+
+static void APIENTRY record_depth_func(const GLenum func)
+{
+    write_op(cc::GL_REC_DEPTH_FUNC);
+    write_int(func);
+
+    i_glDepthFunc(func);
+}
+
+static void APIENTRY record_depth_mask(const GLboolean flag)
+{
+    write_op(cc::GL_REC_DEPTH_MASK);
+    write_int(flag);
+
+    i_glDepthMask(flag);
+}
+
+static void APIENTRY record_blend_func(const GLenum srcFactor, const GLenum dstFactor)
+{
+    write_op(cc::GL_REC_BLEND_FUNC);
+    write_int(srcFactor);
+    write_int(dstFactor);
+
+    i_glBlendFunc(srcFactor, dstFactor);
+}
+
+static void APIENTRY record_blend_func_separate(const GLenum srcColorFactor, const GLenum dstColorFactor, const GLenum srcAlphaFactor, const GLenum dstAlphaFactor)
+{
+    write_op(cc::GL_REC_BLEND_FUNC_SEPARATE);
+    write_int(srcColorFactor);
+    write_int(dstColorFactor);
+    write_int(srcAlphaFactor);
+    write_int(dstAlphaFactor);
+
+    i_glBlendFuncSeparate(srcColorFactor, dstColorFactor, srcAlphaFactor, dstAlphaFactor);
+}
+
+static void APIENTRY record_viewport(const GLint x, const GLint y, const GLsizei width, const GLsizei height)
+{
+    write_op(cc::GL_REC_VIEWPORT);
+    write_int(x);
+    write_int(y);
+    write_int(width);
+    write_int(height);
+
+    i_glViewport(x, y, width, height);
+}
+
+static void APIENTRY record_clear_color(const GLfloat r, const GLfloat g, const GLfloat b, const GLfloat a)
+{
+    write_op(cc::GL_REC_CLEAR_COLOR);
+    write_float(r);
+    write_float(g);
+    write_float(b);
+    write_float(a);
+
+    i_glClearColor(r, g, b, a);
+}
+
+static void APIENTRY record_clear(const GLbitfield mask)
+{
+    write_op(cc::GL_REC_CLEAR);
+    write_int(mask);
+
+    i_glClear(mask);
+}
+
+static void APIENTRY record_pixel_store(const GLenum param, const GLint val)
+{
+    write_op(cc::GL_REC_PIXEL_STORE);
+    write_int(param);
+    write_int(val);
+
+    if (param == GL_UNPACK_ALIGNMENT)
+    {
+        i_unpackAlignment = val;
+    }
+
+    i_glPixelStorei(param, val);
+}
+
+static void APIENTRY record_mem_barrier(const GLbitfield barriers)
+{
+    write_op(cc::GL_REC_MEM_BARRIER);
+    write_int(barriers);
+
+    i_glMemoryBarrier(barriers);
+}
+
+static void APIENTRY record_buf_data(const GLenum target, const GLsizeiptr size, const void *const data, const GLenum usage)
+{
+    write_op(cc::GL_REC_BUF_DATA);
+    write_int(target);
+    write_int(static_cast<int>(size));
+    write_int(usage);
+    write_int(data != nullptr);
+
+    if (data)
+    {
+        write_data(data, static_cast<int>(size));
+    }
+
+    i_glBufferData(target, size, data, usage);
+}
+
+static void APIENTRY record_buf_sub_data(const GLenum target, const GLintptr offs, const GLsizeiptr size, const void *const data)
+{
+    write_op(cc::GL_REC_BUF_SUB_DATA);
+    write_int(target);
+    write_int(static_cast<int>(offs));
+    write_int(static_cast<int>(size));
+    write_data(data, static_cast<int>(size));
+
+    i_glBufferSubData(target, offs, size, data);
+}
+
+static void APIENTRY record_copy_buf_sub_data(const GLenum readTarget, const GLenum writeTarget, const GLintptr readOffs, const GLintptr writeOffs, const GLsizeiptr size)
+{
+    write_op(cc::GL_REC_COPY_BUF_SUB_DATA);
+    write_int(readTarget);
+    write_int(writeTarget);
+    write_int(static_cast<int>(readOffs));
+    write_int(static_cast<int>(writeOffs));
+    write_int(static_cast<int>(size));
+
+    i_glCopyBufferSubData(readTarget, writeTarget, readOffs, writeOffs, size);
+}
+
+static void APIENTRY record_tex_image_2d(const GLenum target, const GLint level, const GLint internalFormat, const GLsizei width, const GLsizei height, const GLint border, const GLenum format, const GLenum type, const void *const px)
+{
+    const int pxDataSize = px ? calc_px_data_size(width, height, format, type) : 0;
+
+    write_op(cc::GL_REC_TEX_IMAGE_2D);
+    write_int(target);
+    write_int(level);
+    write_int(internalFormat);
+    write_int(width);
+    write_int(height);
+    write_int(format);
+    write_int(type);
+    write_int(pxDataSize);
+    write_data(px, pxDataSize);
+
+    i_glTexImage2D(target, level, internalFormat, width, height, border, format, type, px);
+}
+
+static void APIENTRY record_tex_sub_image_2d(const GLenum target, const GLint level, const GLint x, const GLint y, const GLsizei width, const GLsizei height, const GLenum format, const GLenum type, const void *const px)
+{
+    const int pxDataSize = px ? calc_px_data_size(width, height, format, type) : 0;
+
+    write_op(cc::GL_REC_TEX_SUB_IMAGE_2D);
+    write_int(target);
+    write_int(level);
+    write_int(x);
+    write_int(y);
+    write_int(width);
+    write_int(height);
+    write_int(format);
+    write_int(type);
+    write_int(pxDataSize);
+    write_data(px, pxDataSize);
+
+    i_glTexSubImage2D(target, level, x, y, width, height, format, type, px);
+}
+
+static void APIENTRY record_tex_param(const GLenum target, const GLenum param, const GLint val)
+{
+    write_op(cc::GL_REC_TEX_PARAM);
+    write_int(target);
+    write_int(param);
+    write_int(val);
+
+    i_glTexParameteri(target, param, val);
+}
+
+static void APIENTRY record_renderbuf_storage(const GLenum target, const GLenum internalFormat, const GLsizei width, const GLsizei height)
+{
+    write_op(cc::GL_REC_RENDERBUF_STORAGE);
+    write_int(target);
+    write_int(internalFormat);
+    write_int(width);
+    write_int(height);
+
+    i_glRenderbufferStorage(target, internalFormat, width, height);
+}
+
+static void APIENTRY record_framebuf_tex_2d(const GLenum target, const GLenum attachment, const GLenum texTarget, const GLuint texGLID, const GLint level)
+{
+    write_op(cc::GL_REC_FRAMEBUF_TEX_2D);
+    write_int(target);
+    write_int(attachment);
+    write_int(texTarget);
+    write_int(texGLID);
+    write_int(level);
+
+    i_glFramebufferTexture2D(target, attachment, texTarget, texGLID, level);
+}
+
+static void APIENTRY record_framebuf_renderbuf(const GLenum target, const GLenum attachment, const GLenum renderbufTarget, const GLuint renderbufGLID)
+{
+    write_op(cc::GL_REC_FRAMEBUF_RENDERBUF);
+    write_int(target);
+    write_int(attachment);
+    write_int(renderbufTarget);
+    write_int(renderbufGLID);
+
+    i_glFramebufferRenderbuffer(target, attachment, renderbufTarget, renderbufGLID);
+}
+
+static void APIENTRY record_vert_attrib_pointer(const GLuint index, const GLint size, const GLenum type, const GLboolean normalized, const GLsizei stride, const void *const ptr)
+{
+    write_op(cc::GL_REC_VERT_ATTRIB_POINTER);
+    write_int(index);
+    write_int(size);
+    write_int(type);
+    write_int(normalized);
+    write_int(stride);
+    write_int(ptr_to_offs(ptr));
+
+    i_glVertexAttribPointer(index, size, type, normalized, stride, ptr);
+}
+
+static void APIENTRY record_vert_attrib_i_pointer(const GLuint index, const GLint size, const GLenum type, const GLsizei stride, const void *const ptr)
+{
+    write_op(cc::GL_REC_VERT_ATTRIB_I_POINTER);
+    write_int(index);
+    write_int(size);
+    write_int(type);
+    write_int(stride);
+    write_int(ptr_to_offs(ptr));
+
+    i_glVertexAttribIPointer(index, size, type, stride, ptr);
+}
+
+static void APIENTRY record_enable_vert_attrib_array(const GLuint index)
+{
+    write_op(cc::GL_REC_ENABLE_VERT_ATTRIB_ARRAY);
+    write_int(index);
+
+    i_glEnableVertexAttribArray(index);
+}
+
+static void APIENTRY record_uniform_1i(const GLint loc, const GLint val)
+{
+    write_op(cc::GL_REC_UNIFORM_1I);
+    write_int(loc);
+    write_int(val);
+
+    i_glUniform1i(loc, val);
+}
+
+static void APIENTRY record_uniform_1f(const GLint loc, const GLfloat val)
+{
+    write_op(cc::GL_REC_UNIFORM_1F);
+    write_int(loc);
+    write_float(val);
+
+    i_glUniform1f(loc, val);
+}
+
+static void APIENTRY record_uniform_1iv(const GLint loc, const GLsizei cnt, const GLint *const vals)
+{
+    write_op(cc::GL_REC_UNIFORM_1IV);
+    write_int(loc);
+    write_int(cnt);
+    write_data(vals, sizeof(GLint) * cnt);
+
+    i_glUniform1iv(loc, cnt, vals);
+}
+
+static void APIENTRY record_uniform_2fv(const GLint loc, const GLsizei cnt, const GLfloat *const vals)
+{
+    write_op(cc::GL_REC_UNIFORM_2FV);
+    write_int(loc);
+    write_int(cnt);
+    write_data(vals, sizeof(GLfloat) * 2 * cnt);
+
+    i_glUniform2fv(loc, cnt, vals);
+}
+
+static void APIENTRY record_uniform_4fv(const GLint loc, const GLsizei cnt, const GLfloat *const vals)
+{
+    write_op(cc::GL_REC_UNIFORM_4FV);
+    write_int(loc);
+    write_int(cnt);
+    write_data(vals, sizeof(GLfloat) * 4 * cnt);
+
+    i_glUniform4fv(loc, cnt, vals);
+}
+
+static void APIENTRY record_uniform_matrix_4fv(const GLint loc, const GLsizei cnt, const GLboolean transpose, const GLfloat *const vals)
+{
+    write_op(cc::GL_REC_UNIFORM_MATRIX_4FV);
+    write_int(loc);
+    write_int(cnt);
+    write_int(transpose);
+    write_data(vals, sizeof(GLfloat) * 16 * cnt);
+
+    i_glUniformMatrix4fv(loc, cnt, transpose, vals);
+}
+
+static void APIENTRY record_draw_arrays(const GLenum mode, const GLint first, const GLsizei cnt)
+{
+    write_op(cc::GL_REC_DRAW_ARRAYS);
+    write_int(mode);
+    write_int(first);
+    write_int(cnt);
+
+    i_glDrawArrays(mode, first, cnt);
+}
+
+static void APIENTRY record_draw_elems_base_vert(const GLenum mode, const GLsizei cnt, const GLenum type, const void *const indices, const GLint baseVert)
+{
+    write_op(cc::GL_REC_DRAW_ELEMS_BASE_VERT);
+    write_int(mode);
+    write_int(cnt);
+    write_int(type);
+    write_int(ptr_to_offs(indices));
+    write_int(baseVert);
+
+    i_glDrawElementsBaseVertex(mode, cnt, type, indices, baseVert);
+}
+
+static void APIENTRY record_multi_draw_elems_base_vert(const GLenum mode, const GLsizei *const cnts, const GLenum type, const void *const *const indices, const GLsizei drawCnt, const GLint *const baseVerts)
+{
+    write_op(cc::GL_REC_MULTI_DRAW_ELEMS_BASE_VERT);
+    write_int(mode);
+    write_int(type);
+    write_int(drawCnt);
+
+    for (int i = 0; i < drawCnt; ++i)
+    {
+        write_int(cnts[i]);
+        write_int(ptr_to_offs(indices[i]));
+        write_int(baseVerts[i]);
+    }
+
+    i_glMultiDrawElementsBaseVertex(mode, cnts, type, indices, drawCnt, baseVerts);
+}
+
+static void APIENTRY record_multi_draw_elems_indirect(const GLenum mode, const GLenum type, const void *const indirect, const GLsizei drawCnt, const GLsizei stride)
+{
+    write_op(cc::GL_REC_MULTI_DRAW_ELEMS_INDIRECT);
+    write_int(mode);
+    write_int(type);
+    write_int(ptr_to_offs(indirect));
+    write_int(drawCnt);
+    write_int(stride);
+
+    i_glMultiDrawElementsIndirect(mode, type, indirect, drawCnt, stride);
+}
+
+static void APIENTRY record_dispatch_compute(const GLuint groupCntX, const GLuint groupCntY, const GLuint groupCntZ)
+{
+    write_op(cc::GL_REC_DISPATCH_COMPUTE);
+    write_int(groupCntX);
+    write_int(groupCntY);
+    write_int(groupCntZ);
+
+    i_glDispatchCompute(groupCntX, groupCntY, groupCntZ);
+}
+
+static void APIENTRY record_blit_framebuf(const GLint srcX0, const GLint srcY0, const GLint srcX1, const GLint srcY1, const GLint dstX0, const GLint dstY0, const GLint dstX1, const GLint dstY1, const GLbitfield mask, const GLenum filter)
+{
+    write_op(cc::GL_REC_BLIT_FRAMEBUF);
+    write_int(srcX0);
+    write_int(srcY0);
+    write_int(srcX1);
+    write_int(srcY1);
+    write_int(dstX0);
+    write_int(dstY0);
+    write_int(dstX1);
+    write_int(dstY1);
+    write_int(mask);
+    write_int(filter);
+
+    i_glBlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+}
+
+//
+// Snapshot
+//
+static void query_state(GLRecordingState &state)
+{
+    glGetIntegerv(GL_VIEWPORT, state.viewport);
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, state.clearColor);
+    state.blend = glIsEnabled(GL_BLEND);
+    glGetIntegerv(GL_BLEND_SRC_RGB, &state.blendSrc);
+    glGetIntegerv(GL_BLEND_DST_RGB, &state.blendDst);
+    state.depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glGetIntegerv(GL_DEPTH_FUNC, &state.depthFunc);
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &state.depthMask);
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &state.unpackAlignment);
+    glGetIntegerv(GL_CURRENT_PROGRAM, &state.progGLID);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &state.vertArrayGLID);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &state.drawFramebufGLID);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &state.readFramebufGLID);
+    glGetIntegerv(GL_RENDERBUFFER_BINDING, &state.renderbufGLID);
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &state.arrayBufGLID);
+    glGetIntegerv(GL_DRAW_INDIRECT_BUFFER_BINDING, &state.drawIndirectBufGLID);
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &state.activeTexUnit);
+
+    GLint texUnitLimit;
+    glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &texUnitLimit);
+
+    for (int i = 0; i < cc::gk_glRecordingTexUnitLimit; ++i)
+    {
+        state.texGLIDs[i] = 0;
+
+        if (i < texUnitLimit)
+        {
+            glActiveTexture(GL_TEXTURE0 + i);
+            glGetIntegerv(GL_TEXTURE_BINDING_2D, &state.texGLIDs[i]);
+        }
+    }
+
+    glActiveTexture(state.activeTexUnit);
+
+    for (int i = 0; i < cc::gk_glRecordingBufBindingPointLimit; ++i)
+    {
+        glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, i, &state.uniformBufGLIDs[i]);
+        glGetIntegeri_v(GL_SHADER_STORAGE_BUFFER_BINDING, i, &state.storageBufGLIDs[i]);
+    }
+}
+
+static void write_state(const GLRecordingState &state)
+{
+    write_op(cc::GL_REC_DEF_STATE);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        write_int(state.viewport[i]);
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+        write_float(state.clearColor[i]);
+    }
+
+    write_int(state.blend);
+    write_int(state.blendSrc);
+    write_int(state.blendDst);
+    write_int(state.depthTest);
+    write_int(state.depthFunc);
+    write_int(state.depthMask);
+    write_int(state.unpackAlignment);
+    write_int(state.progGLID);
+    write_int(state.vertArrayGLID);
+    write_int(state.drawFramebufGLID);
+    write_int(state.readFramebufGLID);
+    write_int(state.renderbufGLID);
+    write_int(state.arrayBufGLID);
+    write_int(state.drawIndirectBufGLID);
+    write_int(state.activeTexUnit);
+
+    for (int i = 0; i < cc::gk_glRecordingTexUnitLimit; ++i)
+    {
+        write_int(state.texGLIDs[i]);
+    }
+
+    for (int i = 0; i < cc::gk_glRecordingBufBindingPointLimit; ++i)
+    {
+        write_int(state.uniformBufGLIDs[i]);
+    }
+
+    for (int i = 0; i < cc::gk_glRecordingBufBindingPointLimit; ++i)
+    {
+        write_int(state.storageBufGLIDs[i]);
+    }
+}
+
+// Writes the contents of the buffer bound to the target, a chunk at a time. A mapped buffer cannot be read, so is written as zeros.
+static void write_buf_contents(const GLenum target, const int size, const bool mapped)
+{
+    if (mapped)
+    {
+        memset(i_readbackChunk, 0, sizeof(i_readbackChunk));
+    }
+
+    for (int offs = 0; offs < size; offs += ik_readbackChunkSize)
+    {
+        const int chunkSize = std::min(size - offs, ik_readbackChunkSize);
+
+        if (!mapped)
+        {
+            glGetBufferSubData(target, offs, chunkSize, i_readbackChunk);
+        }
+
+        write_data(i_readbackChunk, chunkSize);
+    }
+}
+
+static void write_bufs(const GLID readbackBufGLID)
+{
+    for (GLID glID = 1; glID < cc::gk_glRecordingNameLimit; ++glID)
+    {
+        if (glID == readbackBufGLID || !glIsBuffer(glID))
+        {
+            continue;
+        }
+
+        glBindBuffer(GL_COPY_READ_BUFFER, glID);
+
+        GLint size;
+        glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+
+        GLint usage;
+        glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_USAGE, &usage);
+
+        GLint mapped;
+        glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_MAPPED, &mapped);
+
+        write_op(cc::GL_REC_DEF_BUF);
+        write_int(glID);
+        write_int(size);
+        write_int(usage);
+        write_buf_contents(GL_COPY_READ_BUFFER, size, mapped);
+    }
+}
+
+static int find_core_tex_index(const GLID glID, const AssetGroupManager &assetGroupManager)
+{
+    for (int i = 0; i < cc::CORE_TEX_CNT; ++i)
+    {
+        if (assetGroupManager.get_tex_gl_id(make_core_asset_id(i)) == glID)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void write_texs(const GLID readbackBufGLID, const AssetGroupManager &assetGroupManager)
+{
+    for (GLID glID = 1; glID < cc::gk_glRecordingNameLimit; ++glID)
+    {
+        if (!glIsTexture(glID))
+        {
+            continue;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, glID);
+
+        GLint minFilter, magFilter, wrapS, wrapT;
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &minFilter);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &magFilter);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &wrapS);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, &wrapT);
+
+        // Reference core textures by index, as the replay can load them from the assets file itself.
+        const int coreTexIndex = find_core_tex_index(glID, assetGroupManager);
+
+        if (coreTexIndex != -1)
+        {
+            write_op(cc::GL_REC_DEF_ASSET_TEX);
+            write_int(glID);
+            write_int(coreTexIndex);
+            write_int(minFilter);
+            write_int(magFilter);
+            write_int(wrapS);
+            write_int(wrapT);
+
+            continue;
+        }
+
+        GLint internalFormat, width, height;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+
+        GLenum pxFormat = 0;
+        int pxSize = 0;
+
+        if (internalFormat == GL_R8)
+        {
+            pxFormat = GL_RED;
+            pxSize = 1;
+        }
+        else if (internalFormat == GL_RGBA || internalFormat == GL_RGBA8)
+        {
+            pxFormat = GL_RGBA;
+            pxSize = 4;
+        }
+        else if (width > 0 && height > 0)
+        {
+            cc::log_warning("Texture %u has an internal format which cannot be recorded, so its contents have been left out.", glID);
+        }
+
+        const int pxDataSize = pxSize * width * height;
+
+        write_op(cc::GL_REC_DEF_TEX);
+        write_int(glID);
+        write_int(internalFormat);
+        write_int(width);
+        write_int(height);
+        write_int(minFilter);
+        write_int(magFilter);
+        write_int(wrapS);
+        write_int(wrapT);
+        write_int(pxFormat);
+        write_int(GL_UNSIGNED_BYTE);
+        write_int(pxDataSize);
+
+        if (pxDataSize > 0)
+        {
+            // Read the pixels into a buffer first, so they can be written out a chunk at a time.
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBufGLID);
+            glBufferData(GL_PIXEL_PACK_BUFFER, pxDataSize, nullptr, GL_STREAM_READ);
+            glGetTexImage(GL_TEXTURE_2D, 0, pxFormat, GL_UNSIGNED_BYTE, nullptr);
+            write_buf_contents(GL_PIXEL_PACK_BUFFER, pxDataSize, false);
+        }
+    }
+}
+
+static void write_renderbufs()
+{
+    for (GLID glID = 1; glID < cc::gk_glRecordingNameLimit; ++glID)
+    {
+        if (!glIsRenderbuffer(glID))
+        {
+            continue;
+        }
+
+        glBindRenderbuffer(GL_RENDERBUFFER, glID);
+
+        GLint internalFormat, width, height;
+        glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_INTERNAL_FORMAT, &internalFormat);
+        glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_WIDTH, &width);
+        glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_HEIGHT, &height);
+
+        write_op(cc::GL_REC_DEF_RENDERBUF);
+        write_int(glID);
+        write_int(internalFormat);
+        write_int(width);
+        write_int(height);
+    }
+}
+
+static void write_framebufs()
+{
+    for (GLID glID = 1; glID < cc::gk_glRecordingNameLimit; ++glID)
+    {
+        if (!glIsFramebuffer(glID))
+        {
+            continue;
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, glID);
+
+        GLint attachmentTypes[ik_fbAttachmentPointCnt];
+        GLint attachmentGLIDs[ik_fbAttachmentPointCnt];
+        int attachmentCnt = 0;
+
+        for (int i = 0; i < ik_fbAttachmentPointCnt; ++i)
+        {
+            glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, ik_fbAttachmentPoints[i], GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &attachmentTypes[i]);
+
+            if (attachmentTypes[i] != GL_NONE)
+            {
+                glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, ik_fbAttachmentPoints[i], GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &attachmentGLIDs[i]);
+                ++attachmentCnt;
+            }
+        }
+
+        write_op(cc::GL_REC_DEF_FRAMEBUF);
+        write_int(glID);
+        write_int(attachmentCnt);
+
+        for (int i = 0; i < ik_fbAttachmentPointCnt; ++i)
+        {
+            if (attachmentTypes[i] != GL_NONE)
+            {
+                write_int(ik_fbAttachmentPoints[i]);
+                write_int(attachmentTypes[i] == GL_RENDERBUFFER);
+                write_int(attachmentGLIDs[i]);
+            }
+        }
+    }
+}
+
+static void write_vert_arrays()
+{
+    GLint attribLimit;
+    glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &attribLimit);
+    attribLimit = std::min(attribLimit, ik_vertAttribLimit);
+
+    for (GLID glID = 1; glID < cc::gk_glRecordingNameLimit; ++glID)
+    {
+        if (!glIsVertexArray(glID))
+        {
+            continue;
+        }
+
+        glBindVertexArray(glID);
+
+        GLint elemBufGLID;
+        glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &elemBufGLID);
+
+        // Attributes which have never been set up are left out.
+        GLint enableds[ik_vertAttribLimit];
+        GLint bufGLIDs[ik_vertAttribLimit];
+        int attribCnt = 0;
+
+        for (int i = 0; i < attribLimit; ++i)
+        {
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enableds[i]);
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &bufGLIDs[i]);
+
+            if (enableds[i] || bufGLIDs[i])
+            {
+                ++attribCnt;
+            }
+        }
+
+        write_op(cc::GL_REC_DEF_VERT_ARRAY);
+        write_int(glID);
+        write_int(elemBufGLID);
+        write_int(attribCnt);
+
+        for (int i = 0; i < attribLimit; ++i)
+        {
+            if (!enableds[i] && !bufGLIDs[i])
+            {
+                continue;
+            }
+
+            GLint size, type, normalized, integer, stride;
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &size);
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &type);
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &normalized);
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &integer);
+            glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &stride);
+
+            void *ptr;
+            glGetVertexAttribPointerv(i, GL_VERTEX_ATTRIB_ARRAY_POINTER, &ptr);
+
+            write_int(i);
+            write_int(enableds[i]);
+            write_int(size);
+            write_int(type);
+            write_int(normalized);
+            write_int(integer);
+            write_int(stride);
+            write_int(ptr_to_offs(ptr));
+            write_int(bufGLIDs[i]);
+        }
+    }
+}
+
+static void write_shader_src_parts(const char *const *const parts, const int partCnt)
+{
+    int size = 0;
+
+    for (int i = 0; i < partCnt; ++i)
+    {
+        size += strlen(parts[i]);
+    }
+
+    write_int(size);
+
+    for (int i = 0; i < partCnt; ++i)
+    {
+        write_data(parts[i], strlen(parts[i]));
+    }
+}
+
+// Returns the number of uniforms, with each element of an array as its own.
+static int get_prog_uniforms(const GLID glID, GLRecordingUniform *const uniforms)
+{
+    GLint activeUniformCnt;
+    glGetProgramiv(glID, GL_ACTIVE_UNIFORMS, &activeUniformCnt);
+
+    int cnt = 0;
+
+    for (int i = 0; i < activeUniformCnt; ++i)
+    {
+        char name[ik_uniformNameBufSize];
+        GLsizei nameLen;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(glID, i, sizeof(name), &nameLen, &size, &type, name);
+
+        // The name of an array ends in the subscript of its first element, which is dropped so that each element can be named.
+        const char *const subscript = strchr(name, '[');
+        const int baseNameLen = subscript ? static_cast<int>(subscript - name) : nameLen;
+
+        for (int j = 0; j < size; ++j)
+        {
+            if (cnt == ik_progUniformLimit)
+            {
+                cc::log_warning("Program %u has more uniforms than can be recorded.", glID);
+                return cnt;
+            }
+
+            GLRecordingUniform &uniform = uniforms[cnt];
+
+            if (subscript)
+            {
+                snprintf(uniform.name, sizeof(uniform.name), "%.*s[%d]", baseNameLen, name, j);
+            }
+            else
+            {
+                snprintf(uniform.name, sizeof(uniform.name), "%s", name);
+            }
+
+            uniform.loc = glGetUniformLocation(glID, uniform.name);
+
+            // Members of uniform blocks have no location.
+            if (uniform.loc == -1)
+            {
+                continue;
+            }
+
+            if (uniform.loc >= cc::gk_glRecordingUniformLocLimit)
+            {
+                cc::log_warning("Uniform \"%s\" of program %u has a location beyond the recording limit, so it has been left out.", uniform.name, glID);
+                continue;
+            }
+
+            ++cnt;
+        }
+    }
+
+    return cnt;
+}
+
+static void write_progs(const ShaderProgs &shaderProgs)
+{
+    ShaderProgSrc srcs[gk_shaderProgLimit];
+    const int srcCnt = get_shader_prog_srcs(shaderProgs, srcs);
+
+    GLRecordingUniform uniforms[ik_progUniformLimit];
+
+    for (int i = 0; i < srcCnt; ++i)
+    {
+        const ShaderProgSrc &src = srcs[i];
+
+        write_op(cc::GL_REC_DEF_PROG);
+        write_int(src.glID);
+        write_int(src.compute);
+        write_shader_src_parts(src.vertShaderSrcParts, src.partCnt);
+        write_shader_src_parts(src.fragShaderSrcParts, src.compute ? 0 : src.partCnt);
+
+        const int uniformCnt = get_prog_uniforms(src.glID, uniforms);
+        write_int(uniformCnt);
+
+        for (int j = 0; j < uniformCnt; ++j)
+        {
+            const int nameLen = strlen(uniforms[j].name);
+
+            write_int(uniforms[j].loc);
+            write_int(nameLen);
+            write_data(uniforms[j].name, nameLen);
+        }
+    }
+}
+
+bool begin_gl_recording(const char *const filePath, const cc::Vec2DInt windowSize, const ShaderProgs &shaderProgs, const AssetGroupManager &assetGroupManager)
+{
+    assert(!i_fs);
+
+    i_fs = fopen(filePath, "wb");
+
+    if (!i_fs)
+    {
+        cc::log_error("Failed to create GL recording file with path \"%s\"!", filePath);
+        return false;
+    }
+
+    write_int(cc::gk_glRecordingMagic);
+    write_int(cc::gk_glRecordingVersion);
+    write_int(windowSize.x);
+    write_int(windowSize.y);
+
+    GLRecordingState state;
+    query_state(state);
+
+    // Write out every object, changing bindings and pack state as needed and restoring them afterwards.
+    GLint copyReadBufGLID;
+    glGetIntegerv(GL_COPY_READ_BUFFER_BINDING, &copyReadBufGLID);
+
+    GLint packBufGLID;
+    glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &packBufGLID);
+
+    GLint packAlignment;
+    glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    GLID readbackBufGLID;
+    glGenBuffers(1, &readbackBufGLID);
+
+    write_bufs(readbackBufGLID);
+    write_texs(readbackBufGLID, assetGroupManager);
+    write_renderbufs();
+    write_framebufs();
+    write_vert_arrays();
+    write_progs(shaderProgs);
+
+    glDeleteBuffers(1, &readbackBufGLID);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, packBufGLID);
+    glBindBuffer(GL_COPY_READ_BUFFER, copyReadBufGLID);
+    glBindTexture(GL_TEXTURE_2D, state.texGLIDs[state.activeTexUnit - GL_TEXTURE0]);
+    glBindRenderbuffer(GL_RENDERBUFFER, state.renderbufGLID);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, state.drawFramebufGLID);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, state.readFramebufGLID);
+    glBindVertexArray(state.vertArrayGLID);
+
+    write_state(state);
+
+    i_frameCnt = 0;
+    i_unpackAlignment = state.unpackAlignment;
+
+    // Swap in the recording functions.
+#define INSTALL_GL_RECORDER_HOOK(name, hook) \
+    i_gl##name = glad_gl##name; \
+    glad_gl##name = hook;
+
+    GL_RECORDER_HOOKS(INSTALL_GL_RECORDER_HOOK)
+#undef INSTALL_GL_RECORDER_HOOK
+
+    cc::log("Began recording GL commands to \"%s\".", filePath);
+
+    return true;
+}
+
+void end_gl_recording_frame()
+{
+    assert(i_fs);
+
+    write_op(cc::GL_REC_FRAME_END);
+    ++i_frameCnt;
+}
+
+void end_gl_recording()
+{
+    assert(i_fs);
+
+#define RESTORE_GL_RECORDER_HOOK(name, hook) glad_gl##name = i_gl##name;
+    GL_RECORDER_HOOKS(RESTORE_GL_RECORDER_HOOK)
+#undef RESTORE_GL_RECORDER_HOOK
+
+    write_op(cc::GL_REC_END);
+
+    fclose(i_fs);
+    i_fs = nullptr;
+
+    cc::log("Recorded the GL commands of %d frames.", i_frameCnt);
+}
+
+bool is_gl_recording()
+{
+    return i_fs != nullptr;
+}
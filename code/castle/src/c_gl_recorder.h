@@ -0,0 +1,13 @@
+// Records the GL commands of a run of frames to a file, so that castle_gl_replay can execute and time them away from the game, with the format given in cc_gl_recording.h.
+// Recording begins by writing out every existing GL object and the relevant GL state, after which the GL function pointers loaded by glad are swapped for ones which write each call out before making it. Textures of the core asset group are referenced by index rather than written out.
+// Shader programs are written out from their sources in c_assets, so programs must not be created or destroyed while recording.
+
+#pragma once
+
+#include <castle_common/cc_math.h>
+#include "c_assets.h"
+
+bool begin_gl_recording(const char *const filePath, const cc::Vec2DInt windowSize, const ShaderProgs &shaderProgs, const AssetGroupManager &assetGroupManager); // Returns false if the file could not be created.
+void end_gl_recording_frame(); // Called just before the buffers are swapped.
+void end_gl_recording(); // Restores the GL function pointers and finishes the file.
+bool is_gl_recording();
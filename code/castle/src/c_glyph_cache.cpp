@@ -0,0 +1,522 @@
+#include "c_glyph_cache.h"
+
+#include <string.h>
+#include <algorithm>
+#include <castle_common/cc_debugging.h>
+
+static constexpr int ik_glyphLimit = 4096;
+static constexpr int ik_glyphMapCap = ik_glyphLimit * 2; // Kept at most half full so that probe sequences stay short.
+
+static constexpr int ik_cellSizeStep = 8; // Cell sizes are multiples of this, keeping the rows of uploaded cells aligned.
+static constexpr int ik_cellSizeClassCnt = 32;
+static constexpr int ik_cellSizeLimit = ik_cellSizeStep * ik_cellSizeClassCnt;
+
+static constexpr int ik_shelfLimit = gk_glyphAtlasSize.y / ik_cellSizeStep;
+static constexpr int ik_shelfCellLimit = gk_glyphAtlasSize.x / ik_cellSizeStep;
+
+static constexpr int ik_noCellLRUListIndex = ik_cellSizeClassCnt; // The list of unreferenced glyphs without cells follows those of the size classes.
+
+static_assert((ik_glyphMapCap & (ik_glyphMapCap - 1)) == 0, "The glyph map capacity must be a power of two.");
+static_assert(ik_cellSizeLimit <= gk_glyphAtlasSize.x && ik_cellSizeLimit <= gk_glyphAtlasSize.y);
+
+struct Glyph
+{
+    int fontKey; // Combines the group and index of the font.
+    int fontGroupVersion;
+    unsigned int codepoint;
+
+    GlyphInfo info;
+
+    int refCnt;
+
+    int shelfIndex; // -1 if the glyph has nothing to draw and so has no cell.
+    int cellIndex;
+
+    // Links in the LRU list of the glyph, which it is in only while unreferenced.
+    int lruPrev;
+    int lruNext;
+    unsigned int releaseNum; // Which release this glyph was last unreferenced by, for comparing glyphs across lists.
+};
+
+struct GlyphShelf
+{
+    int y;
+    int height;
+    int cellSize; // Can be less than the height if the shelf has been reused for smaller glyphs.
+    int cellCnt;
+    int usedCellCnt;
+    int pinnedCellCnt; // How many of the used cells hold referenced glyphs.
+    StaticBitset<ik_shelfCellLimit> cellActivity;
+    int cellGlyphIndices[ik_shelfCellLimit];
+};
+
+static GLID i_atlasTexGLID;
+
+static Glyph i_glyphs[ik_glyphLimit];
+static StaticBitset<ik_glyphLimit> i_glyphActivity;
+static int i_glyphMap[ik_glyphMapCap]; // Open addressing with linear probing. Holds glyph indices, or -1 for empty entries.
+
+static GlyphShelf i_shelves[ik_shelfLimit];
+static int i_shelfCnt;
+static int i_shelfHeightUsed;
+
+static int i_lruHeads[ik_cellSizeClassCnt + 1]; // The least recently released glyph of each list.
+static int i_lruTails[ik_cellSizeClassCnt + 1];
+static unsigned int i_releaseCnt;
+
+static cc::Byte i_cellPxData[ik_cellSizeLimit * ik_cellSizeLimit]; // Working space for the pixels of a cell being uploaded.
+
+static inline int calc_font_key(const AssetID fontID)
+{
+    return (fontID.groupIndex * Fonts::k_limit) + fontID.index;
+}
+
+static inline int calc_glyph_map_index(const int fontKey, const unsigned int codepoint)
+{
+    unsigned int hash = (static_cast<unsigned int>(fontKey) * 0x9E3779B1u) ^ codepoint;
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+
+    return hash & (ik_glyphMapCap - 1);
+}
+
+static int find_glyph(const int fontKey, const int fontGroupVersion, const unsigned int codepoint)
+{
+    for (int i = calc_glyph_map_index(fontKey, codepoint); i_glyphMap[i] != -1; i = (i + 1) & (ik_glyphMapCap - 1))
+    {
+        const Glyph &glyph = i_glyphs[i_glyphMap[i]];
+
+        if (glyph.fontKey == fontKey && glyph.fontGroupVersion == fontGroupVersion && glyph.codepoint == codepoint)
+        {
+            return i_glyphMap[i];
+        }
+    }
+
+    return -1;
+}
+
+static void add_glyph_to_map(const int glyphIndex)
+{
+    const Glyph &glyph = i_glyphs[glyphIndex];
+
+    int i = calc_glyph_map_index(glyph.fontKey, glyph.codepoint);
+
+    while (i_glyphMap[i] != -1)
+    {
+        i = (i + 1) & (ik_glyphMapCap - 1);
+    }
+
+    i_glyphMap[i] = glyphIndex;
+}
+
+// Removes the glyph from the map, shifting later entries of its probe sequence back to fill the gap so that no tombstones are needed.
+static void remove_glyph_from_map(const int glyphIndex)
+{
+    const Glyph &glyph = i_glyphs[glyphIndex];
+
+    int gap = calc_glyph_map_index(glyph.fontKey, glyph.codepoint);
+
+    while (i_glyphMap[gap] != glyphIndex)
+    {
+        assert(i_glyphMap[gap] != -1);
+        gap = (gap + 1) & (ik_glyphMapCap - 1);
+    }
+
+    for (int i = (gap + 1) & (ik_glyphMapCap - 1); i_glyphMap[i] != -1; i = (i + 1) & (ik_glyphMapCap - 1))
+    {
+        const Glyph &other = i_glyphs[i_glyphMap[i]];
+        const int home = calc_glyph_map_index(other.fontKey, other.codepoint);
+
+        // Move the entry into the gap only if the gap lies between its home index and where it is now.
+        if (((i - home) & (ik_glyphMapCap - 1)) >= ((i - gap) & (ik_glyphMapCap - 1)))
+        {
+            i_glyphMap[gap] = i_glyphMap[i];
+            gap = i;
+        }
+    }
+
+    i_glyphMap[gap] = -1;
+}
+
+static inline int get_glyph_lru_list_index(const Glyph &glyph)
+{
+    if (glyph.shelfIndex == -1)
+    {
+        return ik_noCellLRUListIndex;
+    }
+
+    return (i_shelves[glyph.shelfIndex].cellSize / ik_cellSizeStep) - 1;
+}
+
+static void add_glyph_to_lru_list(const int glyphIndex)
+{
+    Glyph &glyph = i_glyphs[glyphIndex];
+    const int listIndex = get_glyph_lru_list_index(glyph);
+
+    glyph.lruPrev = i_lruTails[listIndex];
+    glyph.lruNext = -1;
+    glyph.releaseNum = i_releaseCnt++;
+
+    if (i_lruTails[listIndex] != -1)
+    {
+        i_glyphs[i_lruTails[listIndex]].lruNext = glyphIndex;
+    }
+    else
+    {
+        i_lruHeads[listIndex] = glyphIndex;
+    }
+
+    i_lruTails[listIndex] = glyphIndex;
+}
+
+static void remove_glyph_from_lru_list(const int glyphIndex)
+{
+    Glyph &glyph = i_glyphs[glyphIndex];
+    const int listIndex = get_glyph_lru_list_index(glyph);
+
+    if (glyph.lruPrev != -1)
+    {
+        i_glyphs[glyph.lruPrev].lruNext = glyph.lruNext;
+    }
+    else
+    {
+        i_lruHeads[listIndex] = glyph.lruNext;
+    }
+
+    if (glyph.lruNext != -1)
+    {
+        i_glyphs[glyph.lruNext].lruPrev = glyph.lruPrev;
+    }
+    else
+    {
+        i_lruTails[listIndex] = glyph.lruPrev;
+    }
+
+    glyph.lruPrev = -1;
+    glyph.lruNext = -1;
+}
+
+static void evict_glyph(const int glyphIndex)
+{
+    Glyph &glyph = i_glyphs[glyphIndex];
+    assert(!glyph.refCnt);
+
+    remove_glyph_from_lru_list(glyphIndex);
+    remove_glyph_from_map(glyphIndex);
+
+    if (glyph.shelfIndex != -1)
+    {
+        GlyphShelf &shelf = i_shelves[glyph.shelfIndex];
+        deactivate_bit(shelf.cellActivity, glyph.cellIndex);
+        --shelf.usedCellCnt;
+    }
+
+    deactivate_bit(i_glyphActivity, glyphIndex);
+}
+
+// Evicts the least recently released of all unreferenced glyphs, returning whether there was one.
+static bool evict_least_recent_glyph()
+{
+    int glyphIndex = -1;
+
+    for (int i = 0; i <= ik_cellSizeClassCnt; ++i)
+    {
+        const int headIndex = i_lruHeads[i];
+
+        if (headIndex != -1 && (glyphIndex == -1 || i_glyphs[headIndex].releaseNum < i_glyphs[glyphIndex].releaseNum))
+        {
+            glyphIndex = headIndex;
+        }
+    }
+
+    if (glyphIndex == -1)
+    {
+        return false;
+    }
+
+    evict_glyph(glyphIndex);
+
+    return true;
+}
+
+static void init_shelf(GlyphShelf &shelf, const int y, const int height, const int cellSize)
+{
+    shelf = {};
+    shelf.y = y;
+    shelf.height = height;
+    shelf.cellSize = cellSize;
+    shelf.cellCnt = gk_glyphAtlasSize.x / cellSize;
+}
+
+// Finds a free cell of the given size, in order of preference: a free cell in a shelf of that size, a new shelf, an empty shelf tall enough, the cell of the least recently released glyph of that size, and lastly a shelf tall enough whose glyphs are all unreferenced, evicting them.
+static bool take_cell(const int cellSize, int &shelfIndex, int &cellIndex)
+{
+    for (int i = 0; i < i_shelfCnt; ++i)
+    {
+        GlyphShelf &shelf = i_shelves[i];
+
+        if (shelf.cellSize != cellSize || shelf.usedCellCnt == shelf.cellCnt)
+        {
+            continue;
+        }
+
+        shelfIndex = i;
+        cellIndex = first_inactive_bit_index(shelf.cellActivity.bytes, shelf.cellCnt);
+        return true;
+    }
+
+    if (i_shelfHeightUsed + cellSize <= gk_glyphAtlasSize.y)
+    {
+        assert(i_shelfCnt < ik_shelfLimit);
+
+        shelfIndex = i_shelfCnt;
+        cellIndex = 0;
+
+        init_shelf(i_shelves[i_shelfCnt], i_shelfHeightUsed, cellSize, cellSize);
+        ++i_shelfCnt;
+        i_shelfHeightUsed += cellSize;
+
+        return true;
+    }
+
+    for (int i = 0; i < i_shelfCnt; ++i)
+    {
+        GlyphShelf &shelf = i_shelves[i];
+
+        if (!shelf.usedCellCnt && shelf.height >= cellSize)
+        {
+            init_shelf(shelf, shelf.y, shelf.height, cellSize);
+
+            shelfIndex = i;
+            cellIndex = 0;
+            return true;
+        }
+    }
+
+    const int lruHeadIndex = i_lruHeads[(cellSize / ik_cellSizeStep) - 1];
+
+    if (lruHeadIndex != -1)
+    {
+        shelfIndex = i_glyphs[lruHeadIndex].shelfIndex;
+        cellIndex = i_glyphs[lruHeadIndex].cellIndex;
+        evict_glyph(lruHeadIndex);
+        return true;
+    }
+
+    for (int i = 0; i < i_shelfCnt; ++i)
+    {
+        GlyphShelf &shelf = i_shelves[i];
+
+        if (shelf.pinnedCellCnt || shelf.height < cellSize)
+        {
+            continue;
+        }
+
+        for (int j = 0; j < shelf.cellCnt; ++j)
+        {
+            if (is_bit_active(shelf.cellActivity, j))
+            {
+                evict_glyph(shelf.cellGlyphIndices[j]);
+            }
+        }
+
+        init_shelf(shelf, shelf.y, shelf.height, cellSize);
+
+        shelfIndex = i;
+        cellIndex = 0;
+        return true;
+    }
+
+    return false;
+}
+
+// Writes the bitmap of the glyph last rendered by the face into the cell, clearing the rest of the cell so that nothing of a previous glyph remains around it.
+static void upload_glyph_bitmap(const FT_Bitmap &bitmap, const GlyphShelf &shelf, const int cellIndex)
+{
+    memset(i_cellPxData, 0, shelf.cellSize * shelf.cellSize);
+
+    for (unsigned int y = 0; y < bitmap.rows; ++y)
+    {
+        memcpy(i_cellPxData + (y * shelf.cellSize), bitmap.buffer + (y * bitmap.pitch), bitmap.width);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, i_atlasTexGLID);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, cellIndex * shelf.cellSize, shelf.y, shelf.cellSize, shelf.cellSize, GL_RED, GL_UNSIGNED_BYTE, i_cellPxData);
+}
+
+void init_glyph_cache()
+{
+    assert(!i_atlasTexGLID);
+
+    glGenTextures(1, &i_atlasTexGLID);
+    glBindTexture(GL_TEXTURE_2D, i_atlasTexGLID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, gk_glyphAtlasSize.x, gk_glyphAtlasSize.y, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+
+    memset(i_glyphMap, -1, sizeof(i_glyphMap));
+    memset(i_lruHeads, -1, sizeof(i_lruHeads));
+    memset(i_lruTails, -1, sizeof(i_lruTails));
+}
+
+void clean_glyph_cache()
+{
+    glDeleteTextures(1, &i_atlasTexGLID);
+    i_atlasTexGLID = 0;
+
+    i_glyphActivity = {};
+    i_shelfCnt = 0;
+    i_shelfHeightUsed = 0;
+    i_releaseCnt = 0;
+}
+
+int acquire_glyph(const AssetID fontID, const unsigned int codepoint, const AssetGroupManager &assetGroupManager)
+{
+    const int fontKey = calc_font_key(fontID);
+
+    // Use the cached glyph if there is one.
+    const int cachedIndex = find_glyph(fontKey, fontID.groupVersion, codepoint);
+
+    if (cachedIndex != -1)
+    {
+        Glyph &glyph = i_glyphs[cachedIndex];
+
+        if (!glyph.refCnt)
+        {
+            remove_glyph_from_lru_list(cachedIndex);
+
+            if (glyph.shelfIndex != -1)
+            {
+                ++i_shelves[glyph.shelfIndex].pinnedCellCnt;
+            }
+        }
+
+        ++glyph.refCnt;
+
+        return cachedIndex;
+    }
+
+    // Rasterise the glyph.
+    const FT_Face ftFace = assetGroupManager.get_font_face(fontID);
+
+    if (FT_Load_Char(ftFace, codepoint, FT_LOAD_RENDER))
+    {
+        cc::log_error("Failed to load the glyph for codepoint U+%04X!", codepoint);
+        return -1;
+    }
+
+    const FT_GlyphSlot ftGlyph = ftFace->glyph;
+
+    // Find room for the glyph.
+    int glyphIndex = first_inactive_bit_index(i_glyphActivity);
+
+    if (glyphIndex == -1)
+    {
+        if (!evict_least_recent_glyph())
+        {
+            cc::log_error("The glyph cache is full of referenced glyphs!");
+            return -1;
+        }
+
+        glyphIndex = first_inactive_bit_index(i_glyphActivity);
+    }
+
+    int shelfIndex = -1;
+    int cellIndex = 0;
+
+    if (ftGlyph->bitmap.width && ftGlyph->bitmap.rows)
+    {
+        const int glyphSize = static_cast<int>(std::max(ftGlyph->bitmap.width, ftGlyph->bitmap.rows)) + 1; // Leave a gap between neighbouring glyphs, as a column either side of a glyph is sampled.
+        const int cellSize = ((glyphSize + ik_cellSizeStep - 1) / ik_cellSizeStep) * ik_cellSizeStep;
+
+        if (cellSize > ik_cellSizeLimit)
+        {
+            cc::log_error("The glyph for codepoint U+%04X is too large for the glyph atlas!", codepoint);
+            return -1;
+        }
+
+        if (!take_cell(cellSize, shelfIndex, cellIndex))
+        {
+            cc::log_error("There is no room in the glyph atlas for the glyph for codepoint U+%04X!", codepoint);
+            return -1;
+        }
+
+        GlyphShelf &shelf = i_shelves[shelfIndex];
+        activate_bit(shelf.cellActivity, cellIndex);
+        shelf.cellGlyphIndices[cellIndex] = glyphIndex;
+        ++shelf.usedCellCnt;
+        ++shelf.pinnedCellCnt;
+
+        upload_glyph_bitmap(ftGlyph->bitmap, shelf, cellIndex);
+    }
+
+    // Add the glyph to the cache.
+    Glyph &glyph = i_glyphs[glyphIndex];
+
+    glyph = {
+        .fontKey = fontKey,
+        .fontGroupVersion = fontID.groupVersion,
+        .codepoint = codepoint,
+        .info = {
+            .horOffs = static_cast<int>(ftGlyph->metrics.horiBearingX >> 6),
+            .verOffs = static_cast<int>((ftFace->size->metrics.ascender - ftGlyph->metrics.horiBearingY) >> 6),
+            .horAdvance = static_cast<int>(ftGlyph->metrics.horiAdvance >> 6),
+            .srcRect = {}, // Set below if the glyph has a cell.
+            .ftIndex = ftGlyph->glyph_index
+        },
+        .refCnt = 1,
+        .shelfIndex = shelfIndex,
+        .cellIndex = cellIndex,
+        .lruPrev = -1,
+        .lruNext = -1,
+        .releaseNum = 0
+    };
+
+    if (shelfIndex != -1)
+    {
+        glyph.info.srcRect.x = cellIndex * i_shelves[shelfIndex].cellSize;
+        glyph.info.srcRect.y = i_shelves[shelfIndex].y;
+        glyph.info.srcRect.width = ftGlyph->bitmap.width;
+        glyph.info.srcRect.height = ftGlyph->bitmap.rows;
+    }
+
+    activate_bit(i_glyphActivity, glyphIndex);
+    add_glyph_to_map(glyphIndex);
+
+    return glyphIndex;
+}
+
+void release_glyph(const int handle)
+{
+    assert(handle >= 0 && handle < ik_glyphLimit);
+    assert(is_bit_active(i_glyphActivity, handle));
+
+    Glyph &glyph = i_glyphs[handle];
+    assert(glyph.refCnt > 0);
+
+    --glyph.refCnt;
+
+    if (!glyph.refCnt)
+    {
+        if (glyph.shelfIndex != -1)
+        {
+            --i_shelves[glyph.shelfIndex].pinnedCellCnt;
+        }
+
+        add_glyph_to_lru_list(handle);
+    }
+}
+
+const GlyphInfo &get_glyph_info(const int handle)
+{
+    assert(handle >= 0 && handle < ik_glyphLimit);
+    assert(is_bit_active(i_glyphActivity, handle));
+
+    return i_glyphs[handle].info;
+}
+
+GLID get_glyph_atlas_tex_gl_id()
+{
+    return i_atlasTexGLID;
+}
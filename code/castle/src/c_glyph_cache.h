@@ -0,0 +1,25 @@
+// Glyphs are rasterised from font faces the first time they are used, into a single atlas texture shared by every font, so memory grows with the glyphs actually used rather than with the character range of the fonts.
+// The atlas is divided into shelves, each a row of square cells of one size. Glyphs no longer used by any text stay cached, and are evicted least recently released first only once their room is needed.
+
+#pragma once
+
+#include <castle_common/cc_math.h>
+#include "c_assets.h"
+
+constexpr cc::Vec2DInt gk_glyphAtlasSize = {1024, 1024};
+
+struct GlyphInfo
+{
+    int horOffs;
+    int verOffs; // From the top of the line.
+    int horAdvance;
+    cc::Rect srcRect; // Where the glyph lies in the atlas. Empty for glyphs with nothing to draw, such as spaces.
+    FT_UInt ftIndex; // Used for looking up kerning.
+};
+
+void init_glyph_cache();
+void clean_glyph_cache();
+int acquire_glyph(const AssetID fontID, const unsigned int codepoint, const AssetGroupManager &assetGroupManager); // Returns a handle to the glyph, rasterising it if it is not already cached, which stops it from being evicted until released. Returns -1 if the glyph could not be loaded or there is no room for it.
+void release_glyph(const int handle);
+const GlyphInfo &get_glyph_info(const int handle);
+GLID get_glyph_atlas_tex_gl_id();
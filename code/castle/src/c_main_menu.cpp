@@ -10,9 +10,11 @@ static RenderLayerInitInfo render_layer_factory(const int index)
     {
         case MAIN_MENU_GENERAL_LAYER:
             return {
-                .spriteBatchCnt = 0,
                 .spriteBatchSlotCnt = 0,
-                .charBatchCnt = 8
+                .spriteBatchUsage = SPRITE_BATCH_USAGE_STATIC,
+                .opaqueSprites = false,
+                .spriteFeatures = 0,
+                .cached = false
             };
 
         default:
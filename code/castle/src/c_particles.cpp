@@ -0,0 +1,202 @@
+#include "c_particles.h"
+
+#include <algorithm>
+#include "c_rand.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PARTICLES_USE_SSE
+#endif
+
+static_assert(gk_particleSIMDWidth == 4, "The SIMD kernels assume 4-wide float vectors.");
+
+static inline int round_up_to_simd_width(const int cnt)
+{
+    return (cnt + gk_particleSIMDWidth - 1) & ~(gk_particleSIMDWidth - 1);
+}
+
+static void move_particle(ParticleSystem &sys, const int srcIndex, const int destIndex)
+{
+    sys.posXs[destIndex] = sys.posXs[srcIndex];
+    sys.posYs[destIndex] = sys.posYs[srcIndex];
+    sys.velXs[destIndex] = sys.velXs[srcIndex];
+    sys.velYs[destIndex] = sys.velYs[srcIndex];
+    sys.rots[destIndex] = sys.rots[srcIndex];
+    sys.rotVels[destIndex] = sys.rotVels[srcIndex];
+    sys.sizes[destIndex] = sys.sizes[srcIndex];
+    sys.lives[destIndex] = sys.lives[srcIndex];
+    sys.lifeInvs[destIndex] = sys.lifeInvs[srcIndex];
+}
+
+// Advances positions, velocities, rotations and lives. Entries past the particle count up to the next SIMD width multiple are processed too, which is harmless as they are never read.
+static void integrate_particles(ParticleSystem &sys)
+{
+    const int chunkedCnt = round_up_to_simd_width(sys.cnt);
+
+#ifdef PARTICLES_USE_SSE
+    const __m128 velDamp = _mm_set1_ps(sys.velDamp);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    for (int i = 0; i < chunkedCnt; i += gk_particleSIMDWidth)
+    {
+        const __m128 velXs = _mm_loadu_ps(sys.velXs + i);
+        const __m128 velYs = _mm_loadu_ps(sys.velYs + i);
+
+        _mm_storeu_ps(sys.posXs + i, _mm_add_ps(_mm_loadu_ps(sys.posXs + i), velXs));
+        _mm_storeu_ps(sys.posYs + i, _mm_add_ps(_mm_loadu_ps(sys.posYs + i), velYs));
+        _mm_storeu_ps(sys.velXs + i, _mm_mul_ps(velXs, velDamp));
+        _mm_storeu_ps(sys.velYs + i, _mm_mul_ps(velYs, velDamp));
+        _mm_storeu_ps(sys.rots + i, _mm_add_ps(_mm_loadu_ps(sys.rots + i), _mm_loadu_ps(sys.rotVels + i)));
+        _mm_storeu_ps(sys.lives + i, _mm_sub_ps(_mm_loadu_ps(sys.lives + i), one));
+    }
+#else
+    for (int i = 0; i < chunkedCnt; ++i)
+    {
+        sys.posXs[i] += sys.velXs[i];
+        sys.posYs[i] += sys.velYs[i];
+        sys.velXs[i] *= sys.velDamp;
+        sys.velYs[i] *= sys.velDamp;
+        sys.rots[i] += sys.rotVels[i];
+        sys.lives[i] -= 1.0f;
+    }
+#endif
+}
+
+// Removes dead particles by moving the last particle into their place. Iterating backwards means the particle moved in has always already been checked.
+static void kill_dead_particles(ParticleSystem &sys)
+{
+    for (int i = sys.cnt - 1; i >= 0; --i)
+    {
+        if (sys.lives[i] > 0.0f)
+        {
+            continue;
+        }
+
+        --sys.cnt;
+
+        if (i != sys.cnt)
+        {
+            move_particle(sys, sys.cnt, i);
+        }
+    }
+}
+
+void init_particle_system(ParticleSystem &sys, cc::MemArena &permMemArena, const int limit, const AssetID texID, const int layerIndex, const int layerSlotCnt, const float velDamp)
+{
+    assert(limit > 0);
+    assert(layerSlotCnt > 0);
+
+    sys = {};
+
+    sys.limit = round_up_to_simd_width(limit);
+
+    sys.posXs = cc::push_to_mem_arena<float>(permMemArena, sys.limit);
+    sys.posYs = cc::push_to_mem_arena<float>(permMemArena, sys.limit);
+    sys.velXs = cc::push_to_mem_arena<float>(permMemArena, sys.limit);
+    sys.velYs = cc::push_to_mem_arena<float>(permMemArena, sys.limit);
+    sys.rots = cc::push_to_mem_arena<float>(permMemArena, sys.limit);
+    sys.rotVels = cc::push_to_mem_arena<float>(permMemArena, sys.limit);
+    sys.sizes = cc::push_to_mem_arena<float>(permMemArena, sys.limit);
+    sys.lives = cc::push_to_mem_arena<float>(permMemArena, sys.limit);
+    sys.lifeInvs = cc::push_to_mem_arena<float>(permMemArena, sys.limit);
+
+    sys.velDamp = velDamp;
+
+    sys.texID = texID;
+    sys.layerIndex = layerIndex;
+    sys.batchIndices = cc::push_to_mem_arena<int>(permMemArena, (sys.limit + layerSlotCnt - 1) / layerSlotCnt);
+}
+
+void spawn_particles(ParticleSystem &sys, const ParticleSpawnInfo &info, const int cnt)
+{
+    assert(cnt > 0);
+
+    const int spawnCnt = std::min(cnt, sys.limit - sys.cnt);
+
+    for (int i = 0; i < spawnCnt; ++i)
+    {
+        const int index = sys.cnt + i;
+
+        const float dir = info.dir + gen_rand_float(-info.dirSpread, info.dirSpread);
+        const cc::Vec2D vel = cc::make_dir_vec_2d(dir, gen_rand_float(info.spdMin, info.spdMax));
+        const int life = gen_rand_int(info.lifeMin, info.lifeMax);
+
+        sys.posXs[index] = info.pos.x;
+        sys.posYs[index] = info.pos.y;
+        sys.velXs[index] = vel.x;
+        sys.velYs[index] = vel.y;
+        sys.rots[index] = dir;
+        sys.rotVels[index] = gen_rand_float(info.rotVelMin, info.rotVelMax);
+        sys.sizes[index] = gen_rand_float(info.sizeMin, info.sizeMax);
+        sys.lives[index] = static_cast<float>(life);
+        sys.lifeInvs[index] = 1.0f / life;
+    }
+
+    sys.cnt += spawnCnt;
+}
+
+void particle_system_tick(ParticleSystem &sys)
+{
+    integrate_particles(sys);
+    kill_dead_particles(sys);
+}
+
+void write_particle_system_render_data(ParticleSystem &sys, Renderer &renderer, const AssetGroupManager &assetGroupManager)
+{
+    const int slotCnt = renderer.layers[sys.layerIndex].spriteBatchSlotCnt;
+
+    // Take more batches if the live particles no longer fit into those already owned.
+    const int batchCntNeeded = (sys.cnt + slotCnt - 1) / slotCnt;
+
+    while (sys.batchCnt < batchCntNeeded)
+    {
+        const int batchIndex = take_whole_sprite_batch(renderer, sys.layerIndex, sys.texID);
+
+        if (batchIndex == -1)
+        {
+            break;
+        }
+
+        sys.batchIndices[sys.batchCnt] = batchIndex;
+        ++sys.batchCnt;
+    }
+
+    // Release batches which are no longer needed so that the layer can shrink, keeping one spare to avoid churn when the particle count hovers around a batch boundary.
+    while (sys.batchCnt > batchCntNeeded + 1)
+    {
+        --sys.batchCnt;
+        release_whole_sprite_batch(renderer, sys.layerIndex, sys.batchIndices[sys.batchCnt]);
+    }
+
+    const int writeCnt = std::min(sys.cnt, sys.batchCnt * slotCnt);
+
+    const cc::Vec2D texSize = assetGroupManager.get_tex_size(sys.texID);
+    const cc::Vec2D origin = {0.5f, 0.5f};
+    const cc::Vec2D texCoordsTopLeft = {0.0f, 0.0f};
+    const cc::Vec2D texCoordsBottomRight = {1.0f, 1.0f};
+
+    for (int i = 0; i < sys.batchCnt; ++i)
+    {
+        const int batchBegin = i * slotCnt;
+        const int liveEnd = std::clamp(writeCnt - batchBegin, 0, slotCnt);
+
+        // Only the slots of live particles are drawn, so those of particles which have since died need no clearing.
+        set_whole_sprite_batch_active_slot_cnt(renderer, sys.layerIndex, sys.batchIndices[i], liveEnd);
+
+        if (!liveEnd)
+        {
+            continue;
+        }
+
+        SpriteQuadVert *const verts = get_sprite_batch_slot_verts_for_write(renderer, sys.layerIndex, sys.batchIndices[i], 0, liveEnd);
+
+        for (int j = 0; j < liveEnd; ++j)
+        {
+            const int index = batchBegin + j;
+            const cc::Vec2D scale = {sys.sizes[index], sys.sizes[index]};
+            const float alpha = sys.lives[index] * sys.lifeInvs[index];
+
+            write_sprite_quad_verts(verts + (j * gk_spriteBatchSlotVertsCnt), {sys.posXs[index], sys.posYs[index]}, texSize, origin, scale, sys.rots[index], 0, texCoordsTopLeft, texCoordsBottomRight, alpha);
+        }
+    }
+}
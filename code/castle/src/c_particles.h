@@ -0,0 +1,50 @@
+// Particles are stored as structure-of-arrays so that their per-tick integration can be done several at a time with SIMD.
+// A particle system owns whole sprite batches in a dedicated render layer and writes the vertex data of all its live particles into them in bulk. Each batch is only drawn up to its last live particle, so the particle limit costs memory rather than fill.
+
+#pragma once
+
+#include <castle_common/cc_math.h>
+#include <castle_common/cc_mem.h>
+#include "c_assets.h"
+#include "c_rendering.h"
+
+constexpr int gk_particleSIMDWidth = 4;
+
+struct ParticleSpawnInfo
+{
+    cc::Vec2D pos;
+    float dir; // The central direction of the spawned particles, in radians.
+    float dirSpread; // How far either side of the central direction a particle can be spawned in, in radians.
+    float spdMin, spdMax;
+    float sizeMin, sizeMax;
+    float rotVelMin, rotVelMax;
+    int lifeMin, lifeMax; // In ticks.
+};
+
+struct ParticleSystem
+{
+    int limit; // Always a multiple of the SIMD width, so kernels can process the arrays in whole chunks.
+    int cnt;
+
+    float *posXs;
+    float *posYs;
+    float *velXs;
+    float *velYs;
+    float *rots;
+    float *rotVels;
+    float *sizes;
+    float *lives; // Remaining ticks.
+    float *lifeInvs; // The reciprocal of the starting life, used to determine alpha.
+
+    float velDamp;
+
+    AssetID texID;
+    int layerIndex;
+    int *batchIndices; // The sprite batches owned by this system, in the order that particles are written to them.
+    int batchCnt;
+};
+
+void init_particle_system(ParticleSystem &sys, cc::MemArena &permMemArena, const int limit, const AssetID texID, const int layerIndex, const int layerSlotCnt, const float velDamp);
+void spawn_particles(ParticleSystem &sys, const ParticleSpawnInfo &info, const int cnt);
+void particle_system_tick(ParticleSystem &sys);
+void write_particle_system_render_data(ParticleSystem &sys, Renderer &renderer, const AssetGroupManager &assetGroupManager);
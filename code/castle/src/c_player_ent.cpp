@@ -1,5 +1,6 @@
 #include "c_world.h"
 
+#include <castle_common/cc_debugging.h>
 #include "c_game.h"
 
 static constexpr AssetID ik_texID = make_core_asset_id(cc::PLAYER_ENT_TEX);
@@ -10,50 +11,27 @@ static constexpr float ik_swordHitboxStrength = 11.0f;
 static constexpr float ik_swordRotOffsLimit = cc::degs_to_rads(120.0f);
 static constexpr float ik_swordRotOffsLerpFactor = 0.3f;
 
-static void write_player_ent_render_data(World &world, const AssetGroupManager &assetGroupManager)
-{
-    {
-        const cc::Vec2DInt texSize = assetGroupManager.get_tex_size(ik_texID);
-
-        const SpriteBatchSlotWriteData writeData = {
-            .pos = world.playerEnt.pos,
-            .srcRect = get_anim_src_rect(world.playerEnt.animInst),
-            .origin = {0.5f, 0.5f},
-            .rot = world.playerEnt.rot,
-            .scale = {1.0f, 1.0f},
-            .alpha = 1.0f
-        };
-
-        write_to_sprite_batch_slot(world.renderer, world.playerEnt.sbSlotKey, writeData, assetGroupManager);
-    }
-
-    {
-        const cc::Vec2DInt texSize = assetGroupManager.get_tex_size(make_core_asset_id(cc::SWORD_TEX));
-
-        const SpriteBatchSlotWriteData writeData = {
-            .pos = world.playerEnt.pos,
-            .srcRect = {0, 0, texSize},
-            .origin = {-0.25f, 0.5f},
-            .rot = world.playerEnt.rot + world.playerEnt.sword.rotOffs,
-            .scale = {1.0f, 1.0f},
-            .alpha = 1.0f
-        };
-
-        write_to_sprite_batch_slot(world.renderer, world.playerEnt.sword.sbSlotKey, writeData, assetGroupManager);
-    }
-}
-
 static float calc_sword_rot_offs_targ(const PlayerEntSword &sword)
 {
     return ik_swordRotOffsLimit * (sword.rotNeg ? -1.0f : 1.0f);
 }
 
-void init_player_ent(World &world, const AssetGroupManager &assetGroupManager)
+bool init_player_ent(World &world, const AssetGroupManager &assetGroupManager)
 {
-    world.playerEnt.sbSlotKey = take_any_sprite_batch_slot(world.renderer, WORLD_PLAYER_ENT_LAYER, ik_texID);
-    world.playerEnt.animInst.frameInterval = 20;
-    world.playerEnt.sword.sbSlotKey = take_any_sprite_batch_slot(world.renderer, WORLD_PLAYER_ENT_LAYER, make_core_asset_id(cc::SWORD_TEX));
+    if (!take_any_sprite_batch_slot(world.renderer, WORLD_PLAYER_ENT_LAYER, ik_texID, world.playerEnt.sbSlotKey)
+        || !take_any_sprite_batch_slot(world.renderer, WORLD_PLAYER_ENT_LAYER, make_core_asset_id(cc::SWORD_TEX), world.playerEnt.sword.sbSlotKey))
+    {
+        cc::log_error("Failed to take the sprite batch slots of the player entity.");
+        return false;
+    }
+
+    world.playerEnt.animInst.startTime = world.renderer.spriteAnimTime;
+    world.playerEnt.animInst.frameInterval = 21; // Frames used to be shown for one tick more than the interval, so this keeps the timing of the old interval of 20.
+    world.playerEnt.transformIndex = add_transform(world.transforms, -1, world.playerEnt.pos, world.playerEnt.rot);
     world.playerEnt.sword.rotOffs = calc_sword_rot_offs_targ(world.playerEnt.sword);
+    world.playerEnt.sword.transformIndex = add_transform(world.transforms, world.playerEnt.transformIndex, {}, world.playerEnt.sword.rotOffs);
+
+    return true;
 }
 
 void player_ent_tick(World &world, SoundManager &soundManager, const InputManager &inputManager, const AssetGroupManager &assetGroupManager)
@@ -74,6 +52,9 @@ void player_ent_tick(World &world, SoundManager &soundManager, const InputManage
 
     ent.rot = cc::calc_dir(ent.pos, screen_to_camera_pos(inputManager.get_mouse_pos(), world.cam));
 
+    set_transform_local_pos(world.transforms, ent.transformIndex, ent.pos);
+    set_transform_local_rot(world.transforms, ent.transformIndex, ent.rot);
+
     //
     // Enemy Collisions
     //
@@ -117,20 +98,69 @@ void player_ent_tick(World &world, SoundManager &soundManager, const InputManage
         };
 
         add_hitbox(world, hitboxRect, forwards * ik_swordHitboxStrength);
+
+        // Spawn swing particles along the arc of the sword.
+        const ParticleSpawnInfo particleSpawnInfo = {
+            .pos = hitboxRectCenterPos,
+            .dir = ent.rot,
+            .dirSpread = ik_swordRotOffsLimit,
+            .spdMin = 0.5f,
+            .spdMax = 2.0f,
+            .sizeMin = 1.0f,
+            .sizeMax = 2.0f,
+            .rotVelMin = -0.2f,
+            .rotVelMax = 0.2f,
+            .lifeMin = 8,
+            .lifeMax = 16
+        };
+
+        spawn_particles(world.particleSys, particleSpawnInfo, 12);
     }
 
     ent.sword.rotOffs = cc::lerp(ent.sword.rotOffs, calc_sword_rot_offs_targ(ent.sword), ik_swordRotOffsLerpFactor);
+    set_transform_local_rot(world.transforms, ent.sword.transformIndex, ent.sword.rotOffs);
+}
 
-    //
-    // Display
-    //
-    write_player_ent_render_data(world, assetGroupManager);
-    anim_inst_tick(ent.animInst);
+void write_player_ent_render_data(World &world, const AssetGroupManager &assetGroupManager)
+{
+    const PlayerEnt &ent = world.playerEnt;
+
+    {
+        const SpriteBatchSlotAnimWriteData writeData = {
+            .pos = get_transform_world_pos(world.transforms, ent.transformIndex),
+            .animIndex = g_coreAnimTypes[ent.animInst.typeIndex].spriteAnimIndex,
+            .startTime = ent.animInst.startTime,
+            .rate = get_anim_rate(ent.animInst),
+            .origin = {0.5f, 0.5f},
+            .rot = get_transform_world_rot(world.transforms, ent.transformIndex),
+            .scale = get_transform_world_scale(world.transforms, ent.transformIndex),
+            .alpha = 1.0f,
+            .palette = -1
+        };
+
+        write_anim_to_sprite_batch_slot(world.renderer, ent.sbSlotKey, writeData, assetGroupManager);
+    }
+
+    {
+        const cc::Vec2DInt texSize = assetGroupManager.get_tex_size(make_core_asset_id(cc::SWORD_TEX));
+
+        const SpriteBatchSlotWriteData writeData = {
+            .pos = get_transform_world_pos(world.transforms, ent.sword.transformIndex),
+            .srcRect = {0, 0, texSize},
+            .origin = {-0.25f, 0.5f},
+            .rot = get_transform_world_rot(world.transforms, ent.sword.transformIndex),
+            .scale = get_transform_world_scale(world.transforms, ent.sword.transformIndex),
+            .alpha = 1.0f,
+            .palette = -1
+        };
+
+        write_to_sprite_batch_slot(world.renderer, ent.sword.sbSlotKey, writeData, assetGroupManager);
+    }
 }
 
 cc::RectFloat make_player_ent_collider(PlayerEnt &ent, const AssetGroupManager &assetGroupManager)
 {
-    const cc::Vec2DInt size = get_anim_src_rect(ent.animInst).size;
+    const cc::Vec2DInt size = get_anim_frame_size(ent.animInst);
 
     return {
         ent.pos - (size / 2.0f),
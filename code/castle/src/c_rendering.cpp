@@ -1,7 +1,14 @@
 #include "c_rendering.h"
 
+#include <stddef.h>
+#include <limits.h>
+#include <string.h>
 #include <numeric>
+#include <algorithm>
+#include <castle_common/cc_debugging.h>
 #include "c_game.h"
+#include "c_glyph_cache.h"
+#include "c_debug_draw.h"
 
 TexUnit i_texUnitLimit;
 
@@ -9,31 +16,537 @@ constexpr int ik_quadLimit = std::max(RenderLayer::sk_spriteBatchSlotLimit, Char
 constexpr int ik_quadIndicesLen = 6 * ik_quadLimit;
 unsigned short i_quadIndices[ik_quadIndicesLen];
 
+static_assert(ik_quadLimit * 4 <= 0xFFFF, "Quad indices must fit into unsigned shorts.");
+
+// A single vertex buffer for a vertex format, from which the quad buffers of batches are sub-allocated. It grows when it runs out of room.
+struct QuadVertArena
+{
+    static constexpr int sk_freeRangeLimit = 256;
+
+    GLID vertArrayGLID;
+    GLID vertBufGLID;
+    int quadCap;
+    bool isSprite;
+    GLenum bufUsage;
+
+    cc::Range freeRanges[sk_freeRangeLimit]; // Sorted and never adjacent to one another.
+    int freeRangeCnt;
+};
+
+constexpr int ik_dynamicSpriteQuadVertArenaInitQuadCap = 1 << 14;
+constexpr int ik_staticSpriteQuadVertArenaInitQuadCap = 1 << 12;
+constexpr int ik_charQuadVertArenaInitQuadCap = 1 << 12;
+
+static GLID i_quadElemBufGLID; // Shared by every batch of every vertex format.
+static int i_liveGLObjCnt;
+static QuadVertArena i_quadVertArenas[QUAD_VERT_ARENA_CNT];
+
+// Matches the layout OpenGL expects for indirect indexed draws.
+struct DrawElemsIndirectCmd
+{
+    unsigned int cnt;
+    unsigned int instanceCnt;
+    unsigned int firstIndex;
+    int baseVert;
+    unsigned int baseInstance;
+};
+
+// Buffers for culling the sprites of a sprite vertex arena with a compute shader, only created if compute shaders are supported. The compute shader writes the indices of the visible quads of each batch into the range of the element buffer matching where the batch lies in the arena, and counts them in an indirect draw command for the batch.
+struct SpriteCullBufs
+{
+    GLID vertArrayGLID; // Reads from the sprite vertex arena, but with the element buffer below bound.
+    GLID elemBufGLID;
+};
+
+static constexpr int ik_spriteCullWorkGroupSize = 64; // Must match the local size in the compute shader.
+
+static SpriteCullBufs i_spriteCullBufs[SPRITE_BATCH_USAGE_CNT]; // One per sprite vertex arena.
+static GLID i_spriteCullCmdBufGLID; // Room for a command per sprite batch of a layer.
+static bool i_gpuSpriteCulling;
+
+// The render target camera layers are drawn into when they are rendered at a reduced resolution. It is recreated whenever the size needed changes.
+struct LowResTarget
+{
+    GLID fbGLID;
+    GLID colorTexGLID;
+    GLID depthRenderBufGLID;
+    cc::Vec2DInt size;
+};
+
+static LowResTarget i_lowResTarget;
+
+static constexpr int ik_renderLayerCacheMargin = 64; // In window pixels, around each side of the view. Camera moves up to this are covered by moving the cache rather than redrawing it.
+
+static GLID i_emptyVertArrayGLID; // For draws whose vertices come from their IDs alone, as a vertex array must still be bound.
+
+static GLID i_streamedVertArrayGLID;
+static GLID i_streamedVertBufGLID; // Shared by every streamed vertex batch, and given fresh storage for each draw.
+
+// Timer queries measuring how long the GPU takes to draw the camera layers. Two are alternated between so that a result can be read a frame late without stalling.
+static GLID i_camLayerTimerQueryGLIDs[2];
+static bool i_camLayerTimerQueriesIssued[2];
+static int i_camLayerTimerQueryIndex;
+
+// An animation whose frames are held on the GPU, in a uniform buffer laid out as the animation uniform block of the sprite quad vertex shader: the first frame index and frame count of every animation, followed by the texture coordinates of every frame.
+struct SpriteAnim
+{
+    AssetID texID;
+    cc::Vec2DInt frameSize;
+    int frameCnt;
+};
+
+static constexpr int ik_spriteAnimBufFramesOffs = sizeof(int) * 4 * gk_spriteAnimLimit;
+static constexpr int ik_spriteAnimBufSize = ik_spriteAnimBufFramesOffs + (sizeof(float) * 4 * gk_spriteAnimFrameLimit);
+
+static GLID i_spriteAnimBufGLID;
+static SpriteAnim i_spriteAnims[gk_spriteAnimLimit];
+static int i_spriteAnimCnt;
+static int i_spriteAnimFrameCnt;
+
+static const char *const ik_spriteBatchBreakReasonNames[SPRITE_BATCH_BREAK_REASON_CNT] = {
+    "first in layer",
+    "texture units exhausted",
+    "slots full",
+    "taken whole",
+    "texture batches full"
+};
+
+struct SpriteBatchBreakTexTally
+{
+    AssetID texID;
+    int reasonCnts[SPRITE_BATCH_BREAK_REASON_CNT];
+    int total;
+};
+
+static constexpr int ik_spriteBatchBreakHistoryLen = 16;
+static constexpr int ik_spriteBatchBreakTexTallyLimit = 256;
+
+static bool i_spriteBatchBreakRecording;
+static SpriteBatchBreak i_spriteBatchBreaks[ik_spriteBatchBreakHistoryLen]; // The latest breaks, as a ring.
+static int i_spriteBatchBreakCnt;
+static int i_spriteBatchBreakReasonCnts[SPRITE_BATCH_BREAK_REASON_CNT];
+static SpriteBatchBreakTexTally i_spriteBatchBreakTexTallies[ik_spriteBatchBreakTexTallyLimit];
+static int i_spriteBatchBreakTexTallyCnt;
+static int i_spriteBatchBreakUntalliedCnt; // Breaks of textures beyond the tally limit.
+
+static constexpr int ik_lowResScaleChangeCooldown = 60; // The number of frames dynamic scaling waits after changing the scale before it can change it again, giving the measurements time to settle.
+static constexpr double ik_lowResScaleDownBudgetPerc = 0.8; // How much of the budget the estimated cost at the next lower scale can use for the scale to be lowered. Below one to stop the scale bouncing back and forth.
+
+// A static batch modified in this many frames, without a long enough run of unmodified frames in between, is moved to dynamic storage.
+static constexpr int ik_spriteBatchToDynamicModifiedFrameCnt = 8;
+static constexpr int ik_spriteBatchModificationForgetFrameCnt = 120;
+
+// A batch moved to dynamic storage from a static layer is moved back after going unmodified for this many frames.
+static constexpr int ik_spriteBatchToStaticUnmodifiedFrameCnt = 600;
+
+// An empty batch is only retired after staying empty for this many frames, so that slots released and soon taken again reuse it rather than making batches come and go.
+static constexpr int ik_spriteBatchRetireEmptyFrameCnt = 120;
+
+using SpriteQuadVertWriter = void (*)(SpriteQuadVert *const verts, const cc::Vec2D pos, const cc::Vec2D size, const cc::Vec2D origin, const cc::Vec2D scale, const float rot, const TexUnit texUnit, const cc::Vec2D texCoordsTopLeft, const cc::Vec2D texCoordsBottomRight, const float alpha, const int palette, const int anim);
+
+// The sprite quad vertex writer specialised for each combination of sprite features, indexed by the features.
+static constexpr SpriteQuadVertWriter ik_spriteQuadVertWriters[gk_spriteFeatureComboCnt] = {
+    write_sprite_quad_verts<0>,
+    write_sprite_quad_verts<1>,
+    write_sprite_quad_verts<2>,
+    write_sprite_quad_verts<3>,
+    write_sprite_quad_verts<4>,
+    write_sprite_quad_verts<5>,
+    write_sprite_quad_verts<6>,
+    write_sprite_quad_verts<7>
+};
+
+static_assert(gk_spriteFeatureComboCnt == 8, "There must be a sprite quad vertex writer for every combination of sprite features.");
+
+// Batches taken whole are only drawn up to the slots their owners have in use, as they keep no record of which slots are free.
+static inline int get_sprite_batch_drawn_slot_cnt(const RenderLayer &layer, const SpriteBatch &batch)
+{
+    return batch.takenWhole ? batch.activeSlotCnt : layer.spriteBatchSlotCnt;
+}
+
+static inline int get_quad_verts_size(const bool isSprite)
+{
+    return isSprite ? gk_spriteBatchSlotVertsSize : gk_charBatchSlotVertsSize;
+}
+
+static void set_quad_vert_attrib_pointers(const bool isSprite)
+{
+    if (isSprite)
+    {
+        const int vertsStride = sizeof(SpriteQuadVert);
+
+        glVertexAttribPointer(0, 2, GL_HALF_FLOAT, false, vertsStride, reinterpret_cast<void *>(offsetof(SpriteQuadVert, offs)));
+        glEnableVertexAttribArray(0);
+
+        glVertexAttribPointer(1, 2, GL_FLOAT, false, vertsStride, reinterpret_cast<void *>(offsetof(SpriteQuadVert, pos)));
+        glEnableVertexAttribArray(1);
+
+        glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, true, vertsStride, reinterpret_cast<void *>(offsetof(SpriteQuadVert, texCoord)));
+        glEnableVertexAttribArray(2);
+
+        glVertexAttribPointer(3, 1, GL_HALF_FLOAT, false, vertsStride, reinterpret_cast<void *>(offsetof(SpriteQuadVert, rot)));
+        glEnableVertexAttribArray(3);
+
+        glVertexAttribPointer(4, 1, GL_UNSIGNED_BYTE, true, vertsStride, reinterpret_cast<void *>(offsetof(SpriteQuadVert, alpha)));
+        glEnableVertexAttribArray(4);
+
+        // The texture unit, palette and animation are read as integers.
+        glVertexAttribIPointer(5, 3, GL_UNSIGNED_BYTE, vertsStride, reinterpret_cast<void *>(offsetof(SpriteQuadVert, texUnit)));
+        glEnableVertexAttribArray(5);
+    }
+    else
+    {
+        const int vertsStride = sizeof(float) * gk_charQuadShaderProgVertCnt;
+
+        glVertexAttribPointer(0, 2, GL_FLOAT, false, vertsStride, reinterpret_cast<void *>(sizeof(float) * 0));
+        glEnableVertexAttribArray(0);
+
+        glVertexAttribPointer(1, 2, GL_FLOAT, false, vertsStride, reinterpret_cast<void *>(sizeof(float) * 2));
+        glEnableVertexAttribArray(1);
+    }
+}
+
+static void init_quad_vert_arena(QuadVertArena &arena, const bool isSprite, const int quadCap, const GLenum bufUsage)
+{
+    assert(quadCap > 0);
+
+    arena = {};
+    arena.quadCap = quadCap;
+    arena.isSprite = isSprite;
+    arena.bufUsage = bufUsage;
+
+    // Generate the vertex array, binding the shared element buffer to it.
+    glGenVertexArrays(1, &arena.vertArrayGLID);
+    glBindVertexArray(arena.vertArrayGLID);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, i_quadElemBufGLID);
+
+    // Generate the vertex buffer.
+    glGenBuffers(1, &arena.vertBufGLID);
+    glBindBuffer(GL_ARRAY_BUFFER, arena.vertBufGLID);
+    glBufferData(GL_ARRAY_BUFFER, get_quad_verts_size(isSprite) * quadCap, nullptr, bufUsage);
+
+    set_quad_vert_attrib_pointers(isSprite);
+
+    glBindVertexArray(0);
+
+    i_liveGLObjCnt += 2;
+
+    // Initially the whole arena is free.
+    arena.freeRanges[0] = {0, quadCap};
+    arena.freeRangeCnt = 1;
+}
+
+static void clean_quad_vert_arena(QuadVertArena &arena)
+{
+    glDeleteBuffers(1, &arena.vertBufGLID);
+    glDeleteVertexArrays(1, &arena.vertArrayGLID);
+
+    i_liveGLObjCnt -= 2;
+
+    arena = {};
+}
+
+static void free_quad_vert_arena_range(QuadVertArena &arena, const cc::Range range)
+{
+    // Find where the range goes in the sorted free list.
+    int index = 0;
+
+    while (index < arena.freeRangeCnt && arena.freeRanges[index].begin < range.begin)
+    {
+        ++index;
+    }
+
+    const bool joinsPrev = index > 0 && arena.freeRanges[index - 1].end == range.begin;
+    const bool joinsNext = index < arena.freeRangeCnt && arena.freeRanges[index].begin == range.end;
+
+    if (joinsPrev && joinsNext)
+    {
+        arena.freeRanges[index - 1].end = arena.freeRanges[index].end;
+        memmove(arena.freeRanges + index, arena.freeRanges + index + 1, sizeof(cc::Range) * (arena.freeRangeCnt - index - 1));
+        --arena.freeRangeCnt;
+    }
+    else if (joinsPrev)
+    {
+        arena.freeRanges[index - 1].end = range.end;
+    }
+    else if (joinsNext)
+    {
+        arena.freeRanges[index].begin = range.begin;
+    }
+    else
+    {
+        assert(arena.freeRangeCnt < QuadVertArena::sk_freeRangeLimit);
+
+        memmove(arena.freeRanges + index + 1, arena.freeRanges + index, sizeof(cc::Range) * (arena.freeRangeCnt - index));
+        arena.freeRanges[index] = range;
+        ++arena.freeRangeCnt;
+    }
+}
+
+static void init_sprite_cull_bufs(SpriteCullBufs &bufs, const QuadVertArena &arena)
+{
+    assert(arena.isSprite);
+
+    // The element buffer has an index for every quad vertex of the arena, and is filled by the compute shader each frame.
+    glGenBuffers(1, &bufs.elemBufGLID);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, bufs.elemBufGLID);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * 6 * arena.quadCap, nullptr, GL_DYNAMIC_COPY);
+
+    glGenVertexArrays(1, &bufs.vertArrayGLID);
+    glBindVertexArray(bufs.vertArrayGLID);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufs.elemBufGLID);
+    glBindBuffer(GL_ARRAY_BUFFER, arena.vertBufGLID);
+    set_quad_vert_attrib_pointers(true);
+    glBindVertexArray(0);
+
+    i_liveGLObjCnt += 2;
+}
+
+static void clean_sprite_cull_bufs(SpriteCullBufs &bufs)
+{
+    glDeleteVertexArrays(1, &bufs.vertArrayGLID);
+    glDeleteBuffers(1, &bufs.elemBufGLID);
+
+    i_liveGLObjCnt -= 2;
+
+    bufs = {};
+}
+
+// Replaces the vertex buffer of the arena with a larger one, copying the existing vertex data over.
+static void grow_quad_vert_arena(QuadVertArena &arena, const int minQuadCap)
+{
+    const int quadCapLast = arena.quadCap;
+    const int quadCap = std::max(quadCapLast * 2, minQuadCap);
+    const int quadVertsSize = get_quad_verts_size(arena.isSprite);
+
+    GLID vertBufGLID;
+    glGenBuffers(1, &vertBufGLID);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertBufGLID);
+    glBufferData(GL_COPY_WRITE_BUFFER, quadVertsSize * quadCap, nullptr, arena.bufUsage);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, arena.vertBufGLID);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, quadVertsSize * quadCapLast);
+
+    glDeleteBuffers(1, &arena.vertBufGLID);
+    arena.vertBufGLID = vertBufGLID;
+    arena.quadCap = quadCap;
+
+    // Point the vertex attributes at the new buffer.
+    glBindVertexArray(arena.vertArrayGLID);
+    glBindBuffer(GL_ARRAY_BUFFER, arena.vertBufGLID);
+    set_quad_vert_attrib_pointers(arena.isSprite);
+    glBindVertexArray(0);
+
+    // The culling buffers are tied to the size and buffer of the sprite arena, so recreate them.
+    if (arena.isSprite && i_spriteCullCmdBufGLID)
+    {
+        SpriteCullBufs &cullBufs = i_spriteCullBufs[&arena - i_quadVertArenas];
+        clean_sprite_cull_bufs(cullBufs);
+        init_sprite_cull_bufs(cullBufs, arena);
+    }
+
+    free_quad_vert_arena_range(arena, {quadCapLast, quadCap});
+}
+
+static void clean_low_res_target()
+{
+    LowResTarget &target = i_lowResTarget;
+
+    if (!target.fbGLID)
+    {
+        return;
+    }
+
+    glDeleteFramebuffers(1, &target.fbGLID);
+    glDeleteTextures(1, &target.colorTexGLID);
+    glDeleteRenderbuffers(1, &target.depthRenderBufGLID);
+
+    i_liveGLObjCnt -= 3;
+
+    target = {};
+}
+
+static void ensure_low_res_target_size(const cc::Vec2DInt size)
+{
+    LowResTarget &target = i_lowResTarget;
+
+    if (target.fbGLID && target.size == size)
+    {
+        return;
+    }
+
+    clean_low_res_target();
+
+    glGenTextures(1, &target.colorTexGLID);
+    glBindTexture(GL_TEXTURE_2D, target.colorTexGLID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    glGenRenderbuffers(1, &target.depthRenderBufGLID);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.depthRenderBufGLID);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size.x, size.y);
+
+    glGenFramebuffers(1, &target.fbGLID);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.fbGLID);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.colorTexGLID, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target.depthRenderBufGLID);
+    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    i_liveGLObjCnt += 3;
+
+    target.size = size;
+}
+
+// The margin in units of the view, rounded up to a whole number of cache pixels.
+static inline int calc_render_layer_cache_margin(const int pxScale)
+{
+    return ((ik_renderLayerCacheMargin + pxScale - 1) / pxScale) * pxScale;
+}
+
+static void clean_render_layer_cache(RenderLayerCache &cache)
+{
+    if (!cache.fbGLID)
+    {
+        return;
+    }
+
+    glDeleteFramebuffers(1, &cache.fbGLID);
+    glDeleteTextures(1, &cache.colorTexGLID);
+
+    i_liveGLObjCnt -= 2;
+
+    cache = {};
+}
+
+static void ensure_render_layer_cache_size(RenderLayerCache &cache, const cc::Vec2DInt size)
+{
+    if (cache.fbGLID && cache.size == size)
+    {
+        return;
+    }
+
+    clean_render_layer_cache(cache);
+
+    glGenTextures(1, &cache.colorTexGLID);
+    glBindTexture(GL_TEXTURE_2D, cache.colorTexGLID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    glGenFramebuffers(1, &cache.fbGLID);
+    glBindFramebuffer(GL_FRAMEBUFFER, cache.fbGLID);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, cache.colorTexGLID, 0);
+    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    i_liveGLObjCnt += 2;
+
+    cache.size = size;
+}
+
+// Whether the cache can be drawn in place of the layer for the given view, which it can be if the layer has not changed and the view has only moved within the margin.
+static bool is_render_layer_cache_usable(const RenderLayerCache &cache, const cc::Vec2DInt size, const int pxScale, const int margin, const cc::Matrix4x4 &viewMat)
+{
+    if (cache.dirty || !cache.fbGLID || cache.size != size || cache.pxScale != pxScale || cache.margin != margin)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+        for (int j = 0; j < 4; ++j)
+        {
+            if (i == 3 && j < 2)
+            {
+                continue; // The translation.
+            }
+
+            if (viewMat.elems[i][j] != cache.viewMat.elems[i][j])
+            {
+                return false;
+            }
+        }
+    }
+
+    return std::abs(viewMat.elems[3][0] - cache.viewMat.elems[3][0]) <= margin && std::abs(viewMat.elems[3][1] - cache.viewMat.elems[3][1]) <= margin;
+}
+
+static cc::Range alloc_quad_vert_arena_range(QuadVertArena &arena, const int quadCnt)
+{
+    // Use the first free range big enough.
+    for (int i = 0; i < arena.freeRangeCnt; ++i)
+    {
+        cc::Range &freeRange = arena.freeRanges[i];
+
+        if (freeRange.end - freeRange.begin < quadCnt)
+        {
+            continue;
+        }
+
+        const cc::Range range = {freeRange.begin, freeRange.begin + quadCnt};
+        freeRange.begin += quadCnt;
+
+        if (freeRange.begin == freeRange.end)
+        {
+            memmove(arena.freeRanges + i, arena.freeRanges + i + 1, sizeof(cc::Range) * (arena.freeRangeCnt - i - 1));
+            --arena.freeRangeCnt;
+        }
+
+        return range;
+    }
+
+    // Nothing fits, so grow the arena and try again.
+    grow_quad_vert_arena(arena, arena.quadCap + quadCnt);
+    return alloc_quad_vert_arena_range(arena, quadCnt);
+}
+
 static void init_render_layer(RenderLayer &layer, cc::MemArena &permMemArena, const RenderLayerInitInfo &initInfo)
 {
-    assert(initInfo.spriteBatchCnt >= 0);
-    assert(initInfo.spriteBatchSlotCnt >= 0);
-    assert(initInfo.charBatchCnt >= 0);
+    assert(initInfo.spriteBatchSlotCnt >= 0 && initInfo.spriteBatchSlotCnt <= RenderLayer::sk_spriteBatchSlotLimit);
 
-    // Initialise sprite batches.
-    layer.spriteBatches = cc::push_to_mem_arena<SpriteBatch>(permMemArena, initInfo.spriteBatchCnt);
-    layer.spriteBatchCnt = initInfo.spriteBatchCnt;
+    // Reserve room for sprite batches. Their memory is allocated as the layer grows.
+    layer.spriteBatches = cc::push_to_mem_arena<SpriteBatch>(permMemArena, RenderLayer::sk_spriteBatchLimit);
+    layer.spriteBatchCnt = 0;
+    layer.spriteBatchMemCnt = 0;
     layer.spriteBatchSlotCnt = initInfo.spriteBatchSlotCnt;
-    layer.spriteBatchActivity = cc::push_to_mem_arena<cc::Byte>(permMemArena, bits_to_bytes(initInfo.spriteBatchCnt));
+    layer.spriteBatchUsage = initInfo.spriteBatchUsage;
+    layer.opaqueSprites = initInfo.opaqueSprites;
+    layer.spriteFeatures = initInfo.spriteFeatures;
+    layer.spriteAnimFrameChangeTime = INT_MAX;
+    layer.cached = initInfo.cached;
+    layer.cache.dirty = true;
+    layer.spriteBatchActivity = cc::push_to_mem_arena<cc::Byte>(permMemArena, bits_to_bytes(RenderLayer::sk_spriteBatchLimit));
+    layer.spriteBatchOpenness = cc::push_to_mem_arena<cc::Byte>(permMemArena, bits_to_bytes(RenderLayer::sk_spriteBatchLimit));
+    layer.spriteBatchFreeHandleIndex = -1;
+    layer.spriteBatchCompactionStalled = false;
+
+    layer.spriteBatchTexHints = cc::push_to_mem_arena<SpriteBatchTexHint>(permMemArena, RenderLayer::sk_spriteBatchTexHintCnt);
+
+    for (int i = 0; i < RenderLayer::sk_spriteBatchTexHintCnt; ++i)
+    {
+        layer.spriteBatchTexHints[i].batchIndex = -1;
+    }
+
+    // Reserve room for character batches.
+    layer.charBatches = cc::push_to_mem_arena<CharBatch>(permMemArena, RenderLayer::sk_charBatchLimit);
+    layer.charBatchCnt = 0;
+    layer.charBatchActivity = cc::push_to_mem_arena<cc::Byte>(permMemArena, bits_to_bytes(RenderLayer::sk_charBatchLimit));
+}
 
-    for (int i = 0; i < initInfo.spriteBatchCnt; ++i)
+static void release_char_batch_glyphs(CharBatch &batch)
+{
+    for (int i = 0; i < batch.writtenSlotCnt; ++i)
     {
-        SpriteBatch &sb = layer.spriteBatches[i];
-        sb.quadBufVerts = cc::push_to_mem_arena<float>(permMemArena, gk_spriteBatchSlotVertsCnt * initInfo.spriteBatchSlotCnt);
-        sb.slotActivity = cc::push_to_mem_arena<cc::Byte>(permMemArena, bits_to_bytes(initInfo.spriteBatchSlotCnt));
-        sb.slotTexUnits = cc::push_to_mem_arena<TexUnit>(permMemArena, initInfo.spriteBatchSlotCnt);
-        sb.texUnitInfos = cc::push_to_mem_arena<SpriteBatchTexUnitInfo>(permMemArena, i_texUnitLimit);
+        if (batch.glyphHandles[i] != -1)
+        {
+            release_glyph(batch.glyphHandles[i]);
+        }
     }
 
-    // Initialise character batches.
-    layer.charBatches = cc::push_to_mem_arena<CharBatch>(permMemArena, initInfo.charBatchCnt);
-    layer.charBatchCnt = initInfo.charBatchCnt;
-    layer.charBatchActivity = cc::push_to_mem_arena<cc::Byte>(permMemArena, bits_to_bytes(initInfo.charBatchCnt));
+    batch.writtenSlotCnt = 0;
 }
 
 static void clean_render_layer(RenderLayer &layer)
@@ -45,7 +558,7 @@ static void clean_render_layer(RenderLayer &layer)
             continue;
         }
 
-        clean_quad_buf(layer.spriteBatches[i].quadBufGLIDs);
+        clean_quad_buf(layer.spriteBatches[i].quadBuf);
     }
 
     for (int i = 0; i < layer.charBatchCnt; ++i)
@@ -55,482 +568,2141 @@ static void clean_render_layer(RenderLayer &layer)
             continue;
         }
 
-        clean_quad_buf(layer.charBatches[i].quadBufGLIDs);
+        release_char_batch_glyphs(layer.charBatches[i]);
+        clean_quad_buf(layer.charBatches[i].quadBuf);
     }
 
+    clean_render_layer_cache(layer.cache);
+
     layer = {};
 }
 
-static TexUnit find_sprite_batch_tex_unit_to_use(const RenderLayer &renderLayer, const int batchIndex, const AssetID texID)
+static void update_render_layer_batch_cnts(RenderLayer &layer)
 {
-    TexUnit freeTexUnit = -1;
+    while (layer.spriteBatchCnt > 0 && !is_bit_active(layer.spriteBatchActivity, layer.spriteBatchCnt - 1))
+    {
+        --layer.spriteBatchCnt;
+    }
 
-    for (int i = 0; i < i_texUnitLimit; ++i)
+    while (layer.charBatchCnt > 0 && !is_bit_active(layer.charBatchActivity, layer.charBatchCnt - 1))
     {
-        const SpriteBatchTexUnitInfo &texUnitInfo = renderLayer.spriteBatches[batchIndex].texUnitInfos[i];
+        --layer.charBatchCnt;
+    }
+}
 
-        if (!texUnitInfo.refCnt)
-        {
-            if (freeTexUnit == -1)
-            {
-                freeTexUnit = i;
-            }
+// Returns the texture unit already holding the texture, otherwise the one that would be taken next, or -1 if there are none free.
+static TexUnit find_sprite_batch_tex_unit_to_use(const RenderLayer &renderLayer, const int batchIndex, const AssetID texID)
+{
+    const SpriteBatch &batch = renderLayer.spriteBatches[batchIndex];
 
-            continue;
-        }
+    for (int i = 0; i < i_texUnitLimit; ++i)
+    {
+        const SpriteBatchTexUnitInfo &texUnitInfo = batch.texUnitInfos[i];
 
-        if (texUnitInfo.texID == texID)
+        if (texUnitInfo.refCnt && texUnitInfo.texID == texID)
         {
             return i;
         }
     }
 
-    return freeTexUnit;
+    return batch.freeTexUnitCnt ? batch.freeTexUnits[batch.freeTexUnitCnt - 1] : -1;
 }
 
-static void activate_any_sprite_batch(Renderer &renderer, const int layerIndex)
+static TexUnit take_free_sprite_batch_tex_unit(SpriteBatch &batch, const AssetID texID)
 {
-    assert(layerIndex >= 0 && layerIndex < renderer.layerCnt);
+    assert(batch.freeTexUnitCnt > 0);
 
-    RenderLayer &layer = renderer.layers[layerIndex];
+    --batch.freeTexUnitCnt;
+    const TexUnit texUnit = batch.freeTexUnits[batch.freeTexUnitCnt];
 
-    const int batchIndex = first_inactive_bit_index(layer.spriteBatchActivity, layer.spriteBatchCnt);
+    batch.texUnitInfos[texUnit] = {
+        .texID = texID,
+        .refCnt = 0
+    };
 
-    if (batchIndex == -1)
+    return texUnit;
+}
+
+static void unref_sprite_batch_tex_unit(SpriteBatch &batch, const TexUnit texUnit, const int refCnt)
+{
+    SpriteBatchTexUnitInfo &texUnitInfo = batch.texUnitInfos[texUnit];
+    assert(texUnitInfo.refCnt >= refCnt);
+
+    texUnitInfo.refCnt -= refCnt;
+
+    if (!texUnitInfo.refCnt)
     {
-        assert(false);
-        return;
+        batch.freeTexUnits[batch.freeTexUnitCnt] = texUnit;
+        ++batch.freeTexUnitCnt;
     }
+}
 
-    activate_bit(layer.spriteBatchActivity, batchIndex);
+static int take_free_sprite_batch_slot(SpriteBatch &batch)
+{
+    const int slotIndex = batch.freeSlotIndex;
+    assert(slotIndex != -1);
 
-    SpriteBatch &batch = layer.spriteBatches[batchIndex];
+    batch.freeSlotIndex = batch.slotHandleIndices[slotIndex];
 
-    batch.quadBufGLIDs = make_quad_buf(layer.spriteBatchSlotCnt, true);
-    memset(batch.quadBufVerts, 0, gk_spriteBatchSlotVertsSize * layer.spriteBatchSlotCnt);
-    clear_bits(batch.slotActivity, layer.spriteBatchSlotCnt);
-    memset(batch.slotTexUnits, 0, layer.spriteBatchSlotCnt * sizeof(TexUnit));
-    batch.modifiedSlotRange = {};
-    memset(batch.texUnitInfos, 0, i_texUnitLimit * sizeof(SpriteBatchTexUnitInfo));
+    activate_bit(batch.slotActivity, slotIndex);
+    ++batch.activeSlotCnt;
+
+    return slotIndex;
 }
 
-void init_rendering_internals()
+static void release_free_sprite_batch_slot(SpriteBatch &batch, const int slotIndex)
 {
-    int limit;
-    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &limit);
-    i_texUnitLimit = std::min(limit, gk_texUnitLimitCap);
+    deactivate_bit(batch.slotActivity, slotIndex);
+    --batch.activeSlotCnt;
 
-    for (int i = 0; i < ik_quadLimit; i++)
+    batch.slotHandleIndices[slotIndex] = batch.freeSlotIndex;
+    batch.freeSlotIndex = slotIndex;
+}
+
+static void update_sprite_batch_openness(RenderLayer &layer, const int batchIndex)
+{
+    const SpriteBatch &batch = layer.spriteBatches[batchIndex];
+
+    if (is_bit_active(layer.spriteBatchActivity, batchIndex) && !batch.takenWhole && batch.freeSlotIndex != -1 && batch.freeTexUnitCnt)
     {
-        i_quadIndices[(i * 6) + 0] = (i * 4) + 0;
-        i_quadIndices[(i * 6) + 1] = (i * 4) + 1;
-        i_quadIndices[(i * 6) + 2] = (i * 4) + 2;
-        i_quadIndices[(i * 6) + 3] = (i * 4) + 2;
-        i_quadIndices[(i * 6) + 4] = (i * 4) + 3;
-        i_quadIndices[(i * 6) + 5] = (i * 4) + 0;
+        activate_bit(layer.spriteBatchOpenness, batchIndex);
+    }
+    else
+    {
+        deactivate_bit(layer.spriteBatchOpenness, batchIndex);
     }
 }
 
-QuadBufGLIDs make_quad_buf(const int quadCnt, const bool isSprite)
+static inline SpriteBatchTexHint &get_sprite_batch_tex_hint(RenderLayer &layer, const AssetID texID)
 {
-    assert(quadCnt > 0);
+    const int hash = (texID.groupIndex * 31) + texID.index;
+    return layer.spriteBatchTexHints[hash & (RenderLayer::sk_spriteBatchTexHintCnt - 1)];
+}
+
+// Whether the hint can be used to give the texture another slot, in that it still points at a batch with room where the texture has a texture unit.
+static bool is_sprite_batch_tex_hint_usable(const RenderLayer &layer, const SpriteBatchTexHint &hint, const AssetID texID)
+{
+    if (hint.batchIndex == -1 || !(hint.texID == texID) || !is_bit_active(layer.spriteBatchActivity, hint.batchIndex))
+    {
+        return false;
+    }
+
+    const SpriteBatch &batch = layer.spriteBatches[hint.batchIndex];
+    const SpriteBatchTexUnitInfo &texUnitInfo = batch.texUnitInfos[hint.texUnit];
+
+    return !batch.takenWhole && batch.freeSlotIndex != -1 && texUnitInfo.refCnt && texUnitInfo.texID == texID;
+}
 
-    QuadBufGLIDs glIDs = {};
+// Finds a batch with room where the texture already has a texture unit, for when the hint of the texture does not lead to one. Returns -1 if there is none.
+static int find_sprite_batch_holding_tex(const RenderLayer &layer, const AssetID texID, TexUnit &texUnit)
+{
+    for (int i = 0; i < layer.spriteBatchCnt; ++i)
+    {
+        if (!is_bit_active(layer.spriteBatchActivity, i))
+        {
+            continue;
+        }
+
+        const SpriteBatch &batch = layer.spriteBatches[i];
+
+        if (batch.takenWhole || batch.freeSlotIndex == -1)
+        {
+            continue;
+        }
+
+        const TexUnit unit = find_sprite_batch_tex_unit_to_use(layer, i, texID);
+
+        if (unit != -1 && batch.texUnitInfos[unit].refCnt && batch.texUnitInfos[unit].texID == texID)
+        {
+            texUnit = unit;
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static inline SpriteBatchSlotLoc &get_sprite_batch_slot_handle_loc(const RenderLayer &layer, const int handleIndex)
+{
+    assert(handleIndex >= 0 && handleIndex < layer.spriteBatchMemCnt * layer.spriteBatchSlotCnt);
+
+    const SpriteBatch &handleBatch = layer.spriteBatches[handleIndex / layer.spriteBatchSlotCnt];
+    assert(is_bit_active(handleBatch.handleActivity, handleIndex % layer.spriteBatchSlotCnt));
+
+    return handleBatch.handleLocs[handleIndex % layer.spriteBatchSlotCnt];
+}
+
+static inline const SpriteBatchSlotLoc &get_sprite_batch_slot_loc(const Renderer &renderer, const SpriteBatchSlotKey &key)
+{
+    assert(key.layerIndex >= 0 && key.layerIndex < renderer.layerCnt);
+    return get_sprite_batch_slot_handle_loc(renderer.layers[key.layerIndex], key.handleIndex);
+}
+
+static void release_sprite_batch_slot_handle(RenderLayer &layer, const int handleIndex)
+{
+    SpriteBatch &handleBatch = layer.spriteBatches[handleIndex / layer.spriteBatchSlotCnt];
+    deactivate_bit(handleBatch.handleActivity, handleIndex % layer.spriteBatchSlotCnt);
+
+    handleBatch.handleLocs[handleIndex % layer.spriteBatchSlotCnt].batchIndex = layer.spriteBatchFreeHandleIndex;
+    layer.spriteBatchFreeHandleIndex = handleIndex;
+}
+
+static int take_sprite_batch_slot_handle(RenderLayer &layer, const SpriteBatchSlotLoc &loc)
+{
+    const int handleIndex = layer.spriteBatchFreeHandleIndex;
+
+    // There is a handle for every slot of every batch with memory, so this should never happen.
+    assert(handleIndex != -1);
+
+    SpriteBatch &handleBatch = layer.spriteBatches[handleIndex / layer.spriteBatchSlotCnt];
+    SpriteBatchSlotLoc &handleLoc = handleBatch.handleLocs[handleIndex % layer.spriteBatchSlotCnt];
+
+    layer.spriteBatchFreeHandleIndex = handleLoc.batchIndex;
+
+    activate_bit(handleBatch.handleActivity, handleIndex % layer.spriteBatchSlotCnt);
+    handleLoc = loc;
+
+    return handleIndex;
+}
+
+static inline void mark_sprite_batch_slots_modified(SpriteBatch &batch, const int slotBegin, const int slotEnd)
+{
+    batch.modifiedSlotRange.begin = std::min(batch.modifiedSlotRange.begin, slotBegin);
+    batch.modifiedSlotRange.end = std::max(batch.modifiedSlotRange.end, slotEnd);
+}
+
+static void write_sprite_batch_slot_verts(SpriteBatch &batch, const int slotIndex, const SpriteQuadVert *const newVerts)
+{
+    SpriteQuadVert *const verts = batch.quadBufVerts + (slotIndex * gk_spriteBatchSlotVertsCnt);
+
+    // Many owners rewrite their slots every tick with the same data, so only count the write as a modification if something actually changed.
+    if (memcmp(verts, newVerts, gk_spriteBatchSlotVertsSize) == 0)
+    {
+        return;
+    }
+
+    memcpy(verts, newVerts, gk_spriteBatchSlotVertsSize);
+
+    mark_sprite_batch_slots_modified(batch, slotIndex, slotIndex + 1);
+}
+
+static void record_sprite_batch_break(const SpriteBatchBreak &brk)
+{
+    i_spriteBatchBreaks[i_spriteBatchBreakCnt % ik_spriteBatchBreakHistoryLen] = brk;
+    ++i_spriteBatchBreakCnt;
+    ++i_spriteBatchBreakReasonCnts[brk.reason];
+
+    // Tally the break against its texture.
+    SpriteBatchBreakTexTally *tally = nullptr;
+
+    for (int i = 0; i < i_spriteBatchBreakTexTallyCnt; ++i)
+    {
+        if (i_spriteBatchBreakTexTallies[i].texID == brk.texID)
+        {
+            tally = &i_spriteBatchBreakTexTallies[i];
+            break;
+        }
+    }
+
+    if (!tally)
+    {
+        if (i_spriteBatchBreakTexTallyCnt == ik_spriteBatchBreakTexTallyLimit)
+        {
+            ++i_spriteBatchBreakUntalliedCnt;
+            return;
+        }
+
+        tally = &i_spriteBatchBreakTexTallies[i_spriteBatchBreakTexTallyCnt];
+        ++i_spriteBatchBreakTexTallyCnt;
+
+        *tally = {
+            .texID = brk.texID,
+            .reasonCnts = {},
+            .total = 0
+        };
+    }
+
+    ++tally->reasonCnts[brk.reason];
+    ++tally->total;
+}
+
+// Must be called before the new batch is activated.
+static SpriteBatchBreakReason find_sprite_batch_activation_reason(const RenderLayer &layer)
+{
+    bool anyActive = false;
+
+    for (int i = 0; i < layer.spriteBatchCnt; ++i)
+    {
+        if (!is_bit_active(layer.spriteBatchActivity, i))
+        {
+            continue;
+        }
+
+        anyActive = true;
+
+        const SpriteBatch &batch = layer.spriteBatches[i];
+
+        if (!batch.takenWhole && batch.freeSlotIndex != -1)
+        {
+            return SPRITE_BATCH_BREAK_TEX_UNITS_EXHAUSTED;
+        }
+    }
+
+    return anyActive ? SPRITE_BATCH_BREAK_SLOTS_FULL : SPRITE_BATCH_BREAK_FIRST_IN_LAYER;
+}
+
+// Must only be called once no batch where the texture has a unit has room. Returns the reason count if the texture has a unit in none of the batches of the layer, in which case no batch is preferred over another.
+static SpriteBatchBreakReason find_sprite_batch_slot_break_reason(const RenderLayer &layer, const AssetID texID)
+{
+    bool texInLayer = false;
+
+    for (int i = 0; i < layer.spriteBatchCnt; ++i)
+    {
+        if (!is_bit_active(layer.spriteBatchActivity, i))
+        {
+            continue;
+        }
+
+        const SpriteBatch &batch = layer.spriteBatches[i];
+
+        if (batch.takenWhole)
+        {
+            continue;
+        }
+
+        for (int j = 0; j < i_texUnitLimit; ++j)
+        {
+            if (batch.texUnitInfos[j].refCnt && batch.texUnitInfos[j].texID == texID)
+            {
+                assert(batch.freeSlotIndex == -1);
+                texInLayer = true;
+                break;
+            }
+        }
+    }
+
+    return texInLayer ? SPRITE_BATCH_BREAK_TEX_BATCHES_FULL : SPRITE_BATCH_BREAK_REASON_CNT;
+}
+
+static int activate_any_sprite_batch(Renderer &renderer, const int layerIndex)
+{
+    assert(layerIndex >= 0 && layerIndex < renderer.layerCnt);
+
+    RenderLayer &layer = renderer.layers[layerIndex];
+    assert(layer.spriteBatchSlotCnt > 0);
+
+    const int batchIndex = first_inactive_bit_index(layer.spriteBatchActivity, RenderLayer::sk_spriteBatchLimit);
+
+    if (batchIndex == -1)
+    {
+        return -1;
+    }
+
+    activate_bit(layer.spriteBatchActivity, batchIndex);
+    layer.spriteBatchCnt = std::max(layer.spriteBatchCnt, batchIndex + 1);
+
+    SpriteBatch &batch = layer.spriteBatches[batchIndex];
+
+    // Allocate the memory of the batch if this is the first time it has been needed. Batches are always activated lowest index first, so the allocated ones stay contiguous.
+    if (batchIndex == layer.spriteBatchMemCnt)
+    {
+        cc::MemArena &permMemArena = *renderer.permMemArena;
+
+        batch.quadBufVerts = cc::push_to_mem_arena<SpriteQuadVert>(permMemArena, gk_spriteBatchSlotVertsCnt * layer.spriteBatchSlotCnt);
+        batch.slotActivity = cc::push_to_mem_arena<cc::Byte>(permMemArena, bits_to_bytes(layer.spriteBatchSlotCnt));
+        batch.slotTexUnits = cc::push_to_mem_arena<TexUnit>(permMemArena, layer.spriteBatchSlotCnt);
+        batch.slotHandleIndices = cc::push_to_mem_arena<int>(permMemArena, layer.spriteBatchSlotCnt);
+        batch.handleLocs = cc::push_to_mem_arena<SpriteBatchSlotLoc>(permMemArena, layer.spriteBatchSlotCnt);
+        batch.handleActivity = cc::push_to_mem_arena<cc::Byte>(permMemArena, bits_to_bytes(layer.spriteBatchSlotCnt));
+        batch.texUnitInfos = cc::push_to_mem_arena<SpriteBatchTexUnitInfo>(permMemArena, i_texUnitLimit);
+        batch.freeTexUnits = cc::push_to_mem_arena<TexUnit>(permMemArena, i_texUnitLimit);
+
+        // Add the handles of the batch to the free list, lowest index first.
+        for (int i = layer.spriteBatchSlotCnt - 1; i >= 0; --i)
+        {
+            batch.handleLocs[i].batchIndex = layer.spriteBatchFreeHandleIndex;
+            layer.spriteBatchFreeHandleIndex = (batchIndex * layer.spriteBatchSlotCnt) + i;
+        }
+
+        ++layer.spriteBatchMemCnt;
+    }
+
+    batch.usage = layer.spriteBatchUsage;
+    batch.modifiedFrameCnt = 0;
+    batch.unmodifiedFrameCnt = 0;
+    batch.emptyFrameCnt = 0;
+    batch.quadBuf = make_quad_buf(layer.spriteBatchSlotCnt, get_sprite_quad_vert_arena_id(batch.usage));
+    memset(batch.quadBufVerts, 0, gk_spriteBatchSlotVertsSize * layer.spriteBatchSlotCnt);
+    clear_bits(batch.slotActivity, layer.spriteBatchSlotCnt);
+    memset(batch.slotTexUnits, 0, layer.spriteBatchSlotCnt * sizeof(TexUnit));
+    batch.activeSlotCnt = 0;
+    batch.modifiedSlotRange = {0, layer.spriteBatchSlotCnt}; // The quad buffer may still hold vertex data from a previous batch, so it needs to be overwritten.
+    memset(batch.texUnitInfos, 0, i_texUnitLimit * sizeof(SpriteBatchTexUnitInfo));
+    batch.takenWhole = false;
+
+    // Thread every slot onto the free list, lowest index first.
+    for (int i = 0; i < layer.spriteBatchSlotCnt; ++i)
+    {
+        batch.slotHandleIndices[i] = i + 1 < layer.spriteBatchSlotCnt ? i + 1 : -1;
+    }
+
+    batch.freeSlotIndex = 0;
+
+    // Stack the texture units so that the lowest is taken first.
+    for (int i = 0; i < i_texUnitLimit; ++i)
+    {
+        batch.freeTexUnits[i] = static_cast<TexUnit>(i_texUnitLimit - 1 - i);
+    }
+
+    batch.freeTexUnitCnt = i_texUnitLimit;
+
+    update_sprite_batch_openness(layer, batchIndex);
+
+    return batchIndex;
+}
+
+// Tracks how often the batch is modified and moves its vertex data to the arena suiting how it is actually used, in which case all of it is marked for submission.
+static void update_sprite_batch_usage(SpriteBatch &batch, const RenderLayer &layer)
+{
+    if (batch.modifiedSlotRange.end > batch.modifiedSlotRange.begin)
+    {
+        ++batch.modifiedFrameCnt;
+        batch.unmodifiedFrameCnt = 0;
+    }
+    else
+    {
+        batch.unmodifiedFrameCnt = std::min(batch.unmodifiedFrameCnt + 1, ik_spriteBatchToStaticUnmodifiedFrameCnt);
+
+        if (batch.unmodifiedFrameCnt >= ik_spriteBatchModificationForgetFrameCnt)
+        {
+            batch.modifiedFrameCnt = 0;
+        }
+    }
+
+    SpriteBatchUsage usage = batch.usage;
+
+    if (batch.usage == SPRITE_BATCH_USAGE_STATIC && batch.modifiedFrameCnt >= ik_spriteBatchToDynamicModifiedFrameCnt)
+    {
+        usage = SPRITE_BATCH_USAGE_DYNAMIC;
+    }
+    else if (batch.usage == SPRITE_BATCH_USAGE_DYNAMIC && layer.spriteBatchUsage == SPRITE_BATCH_USAGE_STATIC && batch.unmodifiedFrameCnt >= ik_spriteBatchToStaticUnmodifiedFrameCnt)
+    {
+        usage = SPRITE_BATCH_USAGE_STATIC;
+    }
+
+    if (usage == batch.usage)
+    {
+        return;
+    }
+
+    // Move the batch into the other arena. Its vertex data is all still held client-side, so it only needs to be resubmitted.
+    clean_quad_buf(batch.quadBuf);
+    batch.quadBuf = make_quad_buf(layer.spriteBatchSlotCnt, get_sprite_quad_vert_arena_id(usage));
+
+    batch.usage = usage;
+    batch.modifiedFrameCnt = 0;
+    batch.unmodifiedFrameCnt = 0;
+    batch.modifiedSlotRange = {0, layer.spriteBatchSlotCnt};
+}
+
+static void retire_sprite_batch(Renderer &renderer, RenderLayer &layer, const int batchIndex)
+{
+    assert(is_bit_active(layer.spriteBatchActivity, batchIndex));
+    assert(!layer.spriteBatches[batchIndex].activeSlotCnt);
+
+    clean_quad_buf(layer.spriteBatches[batchIndex].quadBuf);
+    deactivate_bit(layer.spriteBatchActivity, batchIndex);
+    update_sprite_batch_openness(layer, batchIndex);
+
+    update_render_layer_batch_cnts(layer);
+
+    renderer.dirty = true;
+    layer.cache.dirty = true;
+}
+
+// Moves a slot into a hole of another batch which can accommodate its texture, updating the handle referring to it. Returns false if the destination batch has no room.
+static bool move_sprite_batch_slot(RenderLayer &layer, const SpriteBatchSlotLoc &srcLoc, const int destBatchIndex)
+{
+    SpriteBatch &srcBatch = layer.spriteBatches[srcLoc.batchIndex];
+    SpriteBatch &destBatch = layer.spriteBatches[destBatchIndex];
+
+    if (destBatch.freeSlotIndex == -1)
+    {
+        return false;
+    }
+
+    const TexUnit srcTexUnit = srcBatch.slotTexUnits[srcLoc.slotIndex];
+    const AssetID texID = srcBatch.texUnitInfos[srcTexUnit].texID;
+
+    TexUnit destTexUnit = find_sprite_batch_tex_unit_to_use(layer, destBatchIndex, texID);
+
+    if (destTexUnit == -1)
+    {
+        return false;
+    }
+
+    if (!destBatch.texUnitInfos[destTexUnit].refCnt)
+    {
+        destTexUnit = take_free_sprite_batch_tex_unit(destBatch, texID);
+    }
+
+    const int destSlotIndex = take_free_sprite_batch_slot(destBatch);
+
+    // Copy the vertex data over, updating the texture unit in each vertex to the new one.
+    SpriteQuadVert *const srcVerts = srcBatch.quadBufVerts + (srcLoc.slotIndex * gk_spriteBatchSlotVertsCnt);
+    SpriteQuadVert *const destVerts = destBatch.quadBufVerts + (destSlotIndex * gk_spriteBatchSlotVertsCnt);
+    memcpy(destVerts, srcVerts, gk_spriteBatchSlotVertsSize);
+
+    for (int i = 0; i < gk_spriteBatchSlotVertsCnt; ++i)
+    {
+        destVerts[i].texUnit = static_cast<unsigned char>(destTexUnit);
+    }
+
+    memset(srcVerts, 0, gk_spriteBatchSlotVertsSize);
+
+    mark_sprite_batch_slots_modified(srcBatch, srcLoc.slotIndex, srcLoc.slotIndex + 1);
+    mark_sprite_batch_slots_modified(destBatch, destSlotIndex, destSlotIndex + 1);
+
+    // Point the handle at the new location.
+    const int handleIndex = srcBatch.slotHandleIndices[srcLoc.slotIndex];
+    destBatch.slotHandleIndices[destSlotIndex] = handleIndex;
+
+    get_sprite_batch_slot_handle_loc(layer, handleIndex) = {
+        .batchIndex = destBatchIndex,
+        .slotIndex = destSlotIndex
+    };
+
+    // Transfer the texture unit reference, and free the source slot.
+    ++destBatch.texUnitInfos[destTexUnit].refCnt;
+    destBatch.slotTexUnits[destSlotIndex] = destTexUnit;
+
+    unref_sprite_batch_tex_unit(srcBatch, srcTexUnit, 1);
+    release_free_sprite_batch_slot(srcBatch, srcLoc.slotIndex);
+
+    update_sprite_batch_openness(layer, srcLoc.batchIndex);
+    update_sprite_batch_openness(layer, destBatchIndex);
+
+    return true;
+}
+
+void init_rendering_internals()
+{
+    int limit;
+    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &limit);
+    i_texUnitLimit = std::min(limit, gk_texUnitLimitCap);
+
+    for (int i = 0; i < ik_quadLimit; i++)
+    {
+        i_quadIndices[(i * 6) + 0] = (i * 4) + 0;
+        i_quadIndices[(i * 6) + 1] = (i * 4) + 1;
+        i_quadIndices[(i * 6) + 2] = (i * 4) + 2;
+        i_quadIndices[(i * 6) + 3] = (i * 4) + 2;
+        i_quadIndices[(i * 6) + 4] = (i * 4) + 3;
+        i_quadIndices[(i * 6) + 5] = (i * 4) + 0;
+    }
+
+    // Generate the element buffer shared by all quad buffers.
+    glGenBuffers(1, &i_quadElemBufGLID);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, i_quadElemBufGLID);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(i_quadIndices), i_quadIndices, GL_STATIC_DRAW);
+
+    ++i_liveGLObjCnt;
+
+    // Set up the vertex arenas.
+    init_quad_vert_arena(i_quadVertArenas[DYNAMIC_SPRITE_QUAD_VERT_ARENA], true, ik_dynamicSpriteQuadVertArenaInitQuadCap, GL_STREAM_DRAW);
+    init_quad_vert_arena(i_quadVertArenas[STATIC_SPRITE_QUAD_VERT_ARENA], true, ik_staticSpriteQuadVertArenaInitQuadCap, GL_STATIC_DRAW);
+    init_quad_vert_arena(i_quadVertArenas[CHAR_QUAD_VERT_ARENA], false, ik_charQuadVertArenaInitQuadCap, GL_DYNAMIC_DRAW);
+
+    // Set up the glyph atlas shared by all character batches.
+    init_glyph_cache();
+
+    // Set up the vertex array of streamed vertex batches.
+    glGenVertexArrays(1, &i_streamedVertArrayGLID);
+    glBindVertexArray(i_streamedVertArrayGLID);
+
+    glGenBuffers(1, &i_streamedVertBufGLID);
+    glBindBuffer(GL_ARRAY_BUFFER, i_streamedVertBufGLID);
+
+    glVertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(StreamedVert), reinterpret_cast<void *>(offsetof(StreamedVert, pos)));
+    glEnableVertexAttribArray(0);
+
+    glVertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(StreamedVert), reinterpret_cast<void *>(offsetof(StreamedVert, texCoord)));
+    glEnableVertexAttribArray(1);
+
+    glVertexAttribPointer(2, 4, GL_FLOAT, false, sizeof(StreamedVert), reinterpret_cast<void *>(offsetof(StreamedVert, color)));
+    glEnableVertexAttribArray(2);
+
+    glBindVertexArray(0);
+
+    i_liveGLObjCnt += 2;
+
+    init_debug_draw();
+
+    glGenVertexArrays(1, &i_emptyVertArrayGLID);
+    ++i_liveGLObjCnt;
+
+    // Generate the buffer holding the frames of sprite animations, filled as animations are added.
+    glGenBuffers(1, &i_spriteAnimBufGLID);
+    glBindBuffer(GL_UNIFORM_BUFFER, i_spriteAnimBufGLID);
+    glBufferData(GL_UNIFORM_BUFFER, ik_spriteAnimBufSize, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    ++i_liveGLObjCnt;
+
+    // Generate the camera layer timer queries.
+    glGenQueries(2, i_camLayerTimerQueryGLIDs);
+    i_liveGLObjCnt += 2;
+
+    // Set up the sprite culling buffers if compute shaders are supported.
+    if (GLAD_GL_VERSION_4_3)
+    {
+        glGenBuffers(1, &i_spriteCullCmdBufGLID);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, i_spriteCullCmdBufGLID);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElemsIndirectCmd) * RenderLayer::sk_spriteBatchLimit, nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        ++i_liveGLObjCnt;
+
+        for (int i = 0; i < SPRITE_BATCH_USAGE_CNT; ++i)
+        {
+            init_sprite_cull_bufs(i_spriteCullBufs[i], i_quadVertArenas[get_sprite_quad_vert_arena_id(static_cast<SpriteBatchUsage>(i))]);
+        }
+    }
+}
+
+void clean_rendering_internals()
+{
+    if (i_spriteCullCmdBufGLID)
+    {
+        for (int i = 0; i < SPRITE_BATCH_USAGE_CNT; ++i)
+        {
+            clean_sprite_cull_bufs(i_spriteCullBufs[i]);
+        }
+
+        glDeleteBuffers(1, &i_spriteCullCmdBufGLID);
+        i_spriteCullCmdBufGLID = 0;
+
+        --i_liveGLObjCnt;
+    }
+
+    i_gpuSpriteCulling = false;
+
+    clean_low_res_target();
+
+    glDeleteVertexArrays(1, &i_emptyVertArrayGLID);
+    i_emptyVertArrayGLID = 0;
+    --i_liveGLObjCnt;
+
+    glDeleteQueries(2, i_camLayerTimerQueryGLIDs);
+    i_liveGLObjCnt -= 2;
+
+    glDeleteBuffers(1, &i_spriteAnimBufGLID);
+    i_spriteAnimBufGLID = 0;
+    i_spriteAnimCnt = 0;
+    i_spriteAnimFrameCnt = 0;
+
+    --i_liveGLObjCnt;
+
+    for (int i = 0; i < QUAD_VERT_ARENA_CNT; ++i)
+    {
+        clean_quad_vert_arena(i_quadVertArenas[i]);
+    }
+
+    clean_debug_draw();
+
+    glDeleteBuffers(1, &i_streamedVertBufGLID);
+    i_streamedVertBufGLID = 0;
+
+    glDeleteVertexArrays(1, &i_streamedVertArrayGLID);
+    i_streamedVertArrayGLID = 0;
+
+    i_liveGLObjCnt -= 2;
+
+    clean_glyph_cache();
+
+    glDeleteBuffers(1, &i_quadElemBufGLID);
+    i_quadElemBufGLID = 0;
+
+    --i_liveGLObjCnt;
+}
+
+int add_sprite_anim(const AssetID texID, const cc::Rect *const frameSrcRects, const int frameCnt, const AssetGroupManager &assetGroupManager)
+{
+    assert(frameCnt > 0);
+
+    if (i_spriteAnimCnt == gk_spriteAnimLimit || i_spriteAnimFrameCnt + frameCnt > gk_spriteAnimFrameLimit)
+    {
+        return -1;
+    }
+
+    const cc::Vec2DInt texSize = assetGroupManager.get_tex_size(texID);
+
+    // Write the texture coordinates of the frames.
+    float frameTexCoords[4 * gk_spriteAnimFrameLimit];
+
+    for (int i = 0; i < frameCnt; ++i)
+    {
+        const cc::Rect &srcRect = frameSrcRects[i];
+        assert(srcRect.size == frameSrcRects[0].size && "The frames of a sprite animation must all be the same size!");
+
+        frameTexCoords[(i * 4) + 0] = static_cast<float>(srcRect.x) / texSize.x;
+        frameTexCoords[(i * 4) + 1] = static_cast<float>(srcRect.y) / texSize.y;
+        frameTexCoords[(i * 4) + 2] = static_cast<float>(srcRect.right()) / texSize.x;
+        frameTexCoords[(i * 4) + 3] = static_cast<float>(srcRect.bottom()) / texSize.y;
+    }
+
+    const int animInfo[4] = {i_spriteAnimFrameCnt, frameCnt};
+
+    glBindBuffer(GL_UNIFORM_BUFFER, i_spriteAnimBufGLID);
+    glBufferSubData(GL_UNIFORM_BUFFER, sizeof(animInfo) * i_spriteAnimCnt, sizeof(animInfo), animInfo);
+    glBufferSubData(GL_UNIFORM_BUFFER, ik_spriteAnimBufFramesOffs + (sizeof(float) * 4 * i_spriteAnimFrameCnt), sizeof(float) * 4 * frameCnt, frameTexCoords);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    i_spriteAnims[i_spriteAnimCnt] = {
+        .texID = texID,
+        .frameSize = frameSrcRects[0].size,
+        .frameCnt = frameCnt
+    };
+
+    i_spriteAnimFrameCnt += frameCnt;
+
+    return i_spriteAnimCnt++;
+}
+
+bool set_gpu_sprite_culling(const bool enabled)
+{
+    if (enabled && !i_spriteCullCmdBufGLID)
+    {
+        return false;
+    }
+
+    i_gpuSpriteCulling = enabled;
+    return true;
+}
+
+QuadBuf make_quad_buf(const int quadCnt, const QuadVertArenaID arenaID)
+{
+    assert(quadCnt > 0 && quadCnt <= ik_quadLimit);
+
+    const cc::Range range = alloc_quad_vert_arena_range(i_quadVertArenas[arenaID], quadCnt);
+
+    return {
+        .arenaID = arenaID,
+        .quadOffs = range.begin,
+        .quadCnt = quadCnt
+    };
+}
+
+void clean_quad_buf(QuadBuf &buf)
+{
+    free_quad_vert_arena_range(i_quadVertArenas[buf.arenaID], {buf.quadOffs, buf.quadOffs + buf.quadCnt});
+    buf = {};
+}
+
+void init_renderer(Renderer &renderer, cc::MemArena &permMemArena, const int layerCnt, const int camLayerCnt, const RenderLayerInitInfoFactory layerInitInfoFactory)
+{
+    assert(layerCnt > 0);
+    assert(camLayerCnt >= 0 && camLayerCnt <= layerCnt);
+    assert(layerInitInfoFactory);
+
+    renderer.layerCnt = layerCnt;
+    renderer.camLayerCnt = camLayerCnt;
+    renderer.permMemArena = &permMemArena;
+    renderer.compactionLayerIndex = 0;
+    renderer.dirty = true;
+    renderer.camViewMatLast = {};
+    renderer.lowResScale = 1;
+    renderer.lowResScaleCooldown = 0;
+    renderer.camLayerGPUDur = 0.0;
+    renderer.camLayerGPUTiming = false;
+    renderer.frameStats = {};
+    renderer.lastFrameStats = {};
+
+    if (camLayerCnt > 0)
+    {
+        const int vertLimit = gk_camStreamedQuadLimit * 6;
+        init_streamed_vert_batch(renderer.camStreamedQuads, cc::push_to_mem_arena<StreamedVert>(permMemArena, vertLimit), vertLimit, GL_TRIANGLES);
+    }
+    else
+    {
+        renderer.camStreamedQuads = {};
+    }
+
+    renderer.layers = cc::push_to_mem_arena<RenderLayer>(permMemArena, layerCnt);
+
+    for (int i = 0; i < layerCnt; ++i)
+    {
+        init_render_layer(renderer.layers[i], permMemArena, layerInitInfoFactory(i));
+    }
+}
+
+void clean_renderer(Renderer &renderer)
+{
+    for (int i = 0; i < renderer.layerCnt; ++i)
+    {
+        clean_render_layer(renderer.layers[i]);
+    }
+
+    renderer = {};
+}
+
+// Returns the normalised device depth of a layer, evenly spaced within the depth range and nearer for later layers.
+static inline float calc_render_layer_depth(const int layerIndex, const int layerCnt)
+{
+    return 1.0f - (2.0f * (layerIndex + 1) / (layerCnt + 1));
+}
+
+// Culls the sprites of every active batch of the layer on the GPU, leaving an indirect draw command per batch bound for drawing, in batch order.
+static void cull_sprite_batches(const RenderLayer &layer, const ShaderProgs &shaderProgs, const cc::Matrix4x4 &projMat, const cc::Matrix4x4 &viewMat, RenderStats &stats)
+{
+    // Reset the commands, each starting with no indices.
+    static DrawElemsIndirectCmd cmds[RenderLayer::sk_spriteBatchLimit];
+    int cmdCnt = 0;
+
+    for (int i = 0; i < layer.spriteBatchCnt; ++i)
+    {
+        if (!is_bit_active(layer.spriteBatchActivity, i))
+        {
+            continue;
+        }
+
+        cmds[cmdCnt] = {
+            .cnt = 0,
+            .instanceCnt = 1,
+            .firstIndex = static_cast<unsigned int>(6 * layer.spriteBatches[i].quadBuf.quadOffs),
+            .baseVert = 0,
+            .baseInstance = 0
+        };
+
+        ++cmdCnt;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, i_spriteCullCmdBufGLID);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(DrawElemsIndirectCmd) * cmdCnt, cmds);
+    stats.uploadedByteCnt += sizeof(DrawElemsIndirectCmd) * cmdCnt;
+
+    // Dispatch the compute shader for each batch.
+    glUseProgram(shaderProgs.spriteCullGLID);
+    ++stats.progSwitchCnt;
+
+    glUniformMatrix4fv(shaderProgs.spriteCullProjUniLoc, 1, false, reinterpret_cast<const float *>(projMat.elems));
+    glUniformMatrix4fv(shaderProgs.spriteCullViewUniLoc, 1, false, reinterpret_cast<const float *>(viewMat.elems));
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, i_spriteCullCmdBufGLID);
+
+    int cmdIndex = 0;
+    int boundUsage = -1;
+
+    for (int i = 0; i < layer.spriteBatchCnt; ++i)
+    {
+        if (!is_bit_active(layer.spriteBatchActivity, i))
+        {
+            continue;
+        }
+
+        // Bind the vertex and element buffers of the arena the batch lies in.
+        const SpriteBatchUsage usage = layer.spriteBatches[i].usage;
+
+        if (usage != boundUsage)
+        {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, i_quadVertArenas[get_sprite_quad_vert_arena_id(usage)].vertBufGLID);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, i_spriteCullBufs[usage].elemBufGLID);
+            boundUsage = usage;
+        }
+
+        // Batches with nothing to draw keep their command, left with no indices.
+        const int quadCnt = get_sprite_batch_drawn_slot_cnt(layer, layer.spriteBatches[i]);
+
+        if (quadCnt)
+        {
+            glUniform1i(shaderProgs.spriteCullQuadCntUniLoc, quadCnt);
+            glUniform1i(shaderProgs.spriteCullQuadOffsUniLoc, layer.spriteBatches[i].quadBuf.quadOffs);
+            glUniform1i(shaderProgs.spriteCullCmdIndexUniLoc, cmdIndex);
+            glDispatchCompute((quadCnt + ik_spriteCullWorkGroupSize - 1) / ik_spriteCullWorkGroupSize, 1, 1);
+        }
+
+        ++cmdIndex;
+    }
+
+    // Make the written indices and counts visible to the draws.
+    glMemoryBarrier(GL_ELEMENT_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+void set_low_res_scale(Renderer &renderer, const int scale)
+{
+    assert(scale >= 1);
+
+    if (renderer.lowResScale != scale)
+    {
+        renderer.lowResScale = scale;
+        renderer.dirty = true;
+    }
+}
+
+void adapt_low_res_scale(Renderer &renderer, const double gpuBudget, const int scaleMax)
+{
+    assert(gpuBudget > 0.0);
+    assert(scaleMax >= 1);
+
+    // Start measuring if nothing was, holding the scale until the first measurements come in.
+    if (!renderer.camLayerGPUTiming)
+    {
+        renderer.camLayerGPUTiming = true;
+        renderer.lowResScaleCooldown = ik_lowResScaleChangeCooldown;
+        return;
+    }
+
+    if (renderer.lowResScaleCooldown > 0)
+    {
+        --renderer.lowResScaleCooldown;
+        return;
+    }
+
+    const int scale = renderer.lowResScale;
+
+    // Fill cost falls with the square of the scale, which is used to estimate what the cost would be one scale lower.
+    int scaleNew = scale;
+
+    if (renderer.camLayerGPUDur > gpuBudget)
+    {
+        scaleNew = std::min(scale + 1, scaleMax);
+    }
+    else if (scale > 1)
+    {
+        const double scaleDownCostMult = static_cast<double>(scale * scale) / ((scale - 1) * (scale - 1));
+
+        if (renderer.camLayerGPUDur * scaleDownCostMult < gpuBudget * ik_lowResScaleDownBudgetPerc)
+        {
+            scaleNew = scale - 1;
+        }
+    }
+
+    if (scaleNew != scale)
+    {
+        set_low_res_scale(renderer, scaleNew);
+        renderer.lowResScaleCooldown = ik_lowResScaleChangeCooldown;
+    }
+}
+
+bool is_render_needed(const Renderer &renderer, const Camera *const cam)
+{
+    if (renderer.dirty)
+    {
+        return true;
+    }
+
+    if (!cam)
+    {
+        return false;
+    }
+
+    const cc::Matrix4x4 camViewMat = make_camera_view_matrix(*cam);
+
+    return memcmp(&camViewMat, &renderer.camViewMatLast, sizeof(camViewMat)) || renderer.camStreamedQuads.changed || has_debug_draw_changed();
+}
+
+void render(Renderer &renderer, const Color &bgColor, const AssetGroupManager &assetGroupManager, const ShaderProgs &shaderProgs, const Camera *const cam)
+{
+    assert((renderer.camLayerCnt > 0) == (cam != nullptr));
+
+    // Clear the screen with the background colour.
+    glClearColor(bgColor.r, bgColor.g, bgColor.b, bgColor.a);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Set up texture units.
+    static int texUnits[gk_texUnitLimitCap];
+    static bool texUnitsInitialized;
+
+    if (!texUnitsInitialized)
+    {
+        std::iota(texUnits, texUnits + i_texUnitLimit, 0);
+        texUnitsInitialized = true;
+    }
+
+    // Make the sprite animation frames available to the sprite quad shader programs.
+    glBindBufferBase(GL_UNIFORM_BUFFER, gk_spriteAnimUniBlockBinding, i_spriteAnimBufGLID);
+
+    // Likewise the colours of the texture palettes.
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, gk_spritePaletteBufBinding, assetGroupManager.get_tex_palette_buf_gl_id());
+
+    // Create the projection matrices.
+    const cc::Vec2DInt windowSize = get_window_size();
+    const auto projMat = cc::make_ortho_matrix_4x4(0.0f, windowSize.x, windowSize.y, 0.0f, -1.0f, 1.0f);
+
+    // Define functions for rendering the sprite and character batches of a layer.
+    RenderStats &stats = renderer.frameStats;
+
+    auto renderSpriteBatches = [&renderer, &assetGroupManager, &shaderProgs, &stats](const RenderLayer &layer, const cc::Matrix4x4 &projMat, const cc::Matrix4x4 &viewMat, const float depth, const bool alphaTest)
+    {
+        const bool gpuCulling = i_gpuSpriteCulling && shaderProgs.spriteCullGLID && layer.spriteBatchCnt > 0;
+
+        if (gpuCulling)
+        {
+            cull_sprite_batches(layer, shaderProgs, projMat, viewMat, stats);
+        }
+
+        // Render sprite batches, using the shader variant matching the features of the layer.
+        const SpriteQuadShaderProg &prog = shaderProgs.spriteQuads[layer.spriteFeatures];
+
+        glUseProgram(prog.glID);
+        ++stats.progSwitchCnt;
+
+        glUniformMatrix4fv(prog.projUniLoc, 1, false, reinterpret_cast<const float *>(projMat.elems));
+        glUniformMatrix4fv(prog.viewUniLoc, 1, false, reinterpret_cast<const float *>(viewMat.elems));
+
+        glUniform1iv(prog.texturesUniLoc, i_texUnitLimit, texUnits);
+        glUniform1f(prog.depthUniLoc, depth);
+        glUniform1i(prog.alphaTestUniLoc, alphaTest);
+
+        if (layer.spriteFeatures & SPRITE_FEATURE_ANIM_BIT)
+        {
+            glUniform1f(prog.animTimeUniLoc, static_cast<float>(renderer.spriteAnimTime));
+        }
+
+        // Consecutive batches in the same vertex arena whose textures do not conflict over units are drawn together in a single multi-draw.
+        static GLsizei drawIndexCnts[RenderLayer::sk_spriteBatchLimit];
+        static const void *drawIndexOffsets[RenderLayer::sk_spriteBatchLimit];
+        static GLint drawBaseVerts[RenderLayer::sk_spriteBatchLimit];
+        int drawCnt = 0;
+        int drawCmdBegin = 0; // When culling on the GPU, the index of the indirect draw command of the first pending draw. Commands are in the same order as the draws.
+        int drawUsage = -1; // The usage of the batches of the pending draws, which determines the vertex array to draw with.
+
+        AssetID drawUnitTexIDs[gk_texUnitLimitCap];
+        bool drawUnitsUsed[gk_texUnitLimitCap] = {};
+
+        int drawUnitPalettes[gk_texUnitLimitCap]; // The palettes of the textures bound to units, passed on to the shader only when they change.
+        std::fill(drawUnitPalettes, drawUnitPalettes + gk_texUnitLimitCap, -1);
+        bool drawUnitPalettesChanged = true;
+
+        const auto flushDraws = [&drawCnt, &drawCmdBegin, &drawUnitPalettes, &drawUnitPalettesChanged, &prog, &stats, gpuCulling]()
+        {
+            if (drawCnt > 0)
+            {
+                if (drawUnitPalettesChanged)
+                {
+                    glUniform1iv(prog.texPalettesUniLoc, i_texUnitLimit, drawUnitPalettes);
+                    drawUnitPalettesChanged = false;
+                }
+
+                if (gpuCulling)
+                {
+                    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<void *>(sizeof(DrawElemsIndirectCmd) * drawCmdBegin), drawCnt, 0);
+                }
+                else
+                {
+                    glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawIndexCnts, GL_UNSIGNED_SHORT, drawIndexOffsets, drawCnt, drawBaseVerts);
+                }
+
+                ++stats.drawCallCnt;
+                drawCmdBegin += drawCnt;
+                drawCnt = 0;
+            }
+        };
+
+        for (int i = 0; i < layer.spriteBatchCnt; ++i)
+        {
+            if (!is_bit_active(layer.spriteBatchActivity, i))
+            {
+                continue;
+            }
+
+            const SpriteBatch &sb = layer.spriteBatches[i];
+
+            // If the batch lies in a different vertex arena than the pending draws, flush those draws and switch vertex arrays.
+            if (sb.usage != drawUsage)
+            {
+                flushDraws();
+
+                glBindVertexArray(gpuCulling ? i_spriteCullBufs[sb.usage].vertArrayGLID : i_quadVertArenas[get_sprite_quad_vert_arena_id(sb.usage)].vertArrayGLID);
+                drawUsage = sb.usage;
+            }
+
+            // If the batch needs a unit bound to a different texture than the pending draws use, flush those draws first.
+            for (int j = 0; j < i_texUnitLimit; ++j)
+            {
+                if (sb.texUnitInfos[j].refCnt && drawUnitsUsed[j] && drawUnitTexIDs[j] != sb.texUnitInfos[j].texID)
+                {
+                    flushDraws();
+                    std::fill(drawUnitsUsed, drawUnitsUsed + gk_texUnitLimitCap, false);
+                    break;
+                }
+            }
+
+            // Bind texture GLIDs to units not already bound.
+            for (int j = 0; j < i_texUnitLimit; ++j)
+            {
+                if (!sb.texUnitInfos[j].refCnt || drawUnitsUsed[j])
+                {
+                    continue;
+                }
+
+                glActiveTexture(GL_TEXTURE0 + j);
+                glBindTexture(GL_TEXTURE_2D, assetGroupManager.get_tex_gl_id(sb.texUnitInfos[j].texID));
+                ++stats.texBindCnt;
+
+                drawUnitTexIDs[j] = sb.texUnitInfos[j].texID;
+                drawUnitsUsed[j] = true;
+
+                const int palette = assetGroupManager.get_tex_palette_index(sb.texUnitInfos[j].texID);
+
+                if (drawUnitPalettes[j] != palette)
+                {
+                    drawUnitPalettes[j] = palette;
+                    drawUnitPalettesChanged = true;
+                }
+            }
+
+            // Add the batch to the pending draws.
+            const int drawnSlotCnt = get_sprite_batch_drawn_slot_cnt(layer, sb);
+
+            drawIndexCnts[drawCnt] = 6 * drawnSlotCnt;
+            drawIndexOffsets[drawCnt] = nullptr;
+            drawBaseVerts[drawCnt] = 4 * sb.quadBuf.quadOffs;
+            ++drawCnt;
+
+            stats.activeQuadCnt += sb.activeSlotCnt;
+            stats.drawnQuadCnt += drawnSlotCnt;
+        }
+
+        flushDraws();
+
+        if (gpuCulling)
+        {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+    };
+
+    auto renderCharBatches = [&shaderProgs, &stats](const RenderLayer &layer, const cc::Matrix4x4 &projMat, const cc::Matrix4x4 &viewMat, const float depth)
+    {
+        glUseProgram(shaderProgs.charQuadGLID);
+        ++stats.progSwitchCnt;
+
+        glUniformMatrix4fv(shaderProgs.charQuadProjUniLoc, 1, false, reinterpret_cast<const float *>(projMat.elems));
+        glUniformMatrix4fv(shaderProgs.charQuadViewUniLoc, 1, false, reinterpret_cast<const float *>(viewMat.elems));
+        glUniform1f(shaderProgs.charQuadDepthUniLoc, depth);
+
+        glBindVertexArray(i_quadVertArenas[CHAR_QUAD_VERT_ARENA].vertArrayGLID);
+
+        // All fonts share the glyph atlas, so it only needs binding once.
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, get_glyph_atlas_tex_gl_id());
+        ++stats.texBindCnt;
+
+        for (int i = 0; i < layer.charBatchCnt; ++i)
+        {
+            if (!is_bit_active(layer.charBatchActivity, i))
+            {
+                continue;
+            }
+
+            const CharBatch &cb = layer.charBatches[i];
+
+            if (!cb.writtenSlotCnt)
+            {
+                continue;
+            }
+
+            glUniform2fv(shaderProgs.charQuadPosUniLoc, 1, reinterpret_cast<const float *>(&cb.pos));
+            glUniform1f(shaderProgs.charQuadRotUniLoc, cb.rot);
+            glUniform4fv(shaderProgs.charQuadBlendUniLoc, 1, reinterpret_cast<const float *>(&cb.blend));
+
+            // Draw the batch.
+            glDrawElementsBaseVertex(GL_TRIANGLES, 6 * cb.writtenSlotCnt, GL_UNSIGNED_SHORT, nullptr, 4 * cb.quadBuf.quadOffs);
+
+            ++stats.drawCallCnt;
+            stats.activeQuadCnt += cb.writtenSlotCnt;
+            stats.drawnQuadCnt += cb.writtenSlotCnt;
+        }
+    };
+
+    // Define functions for drawing the caches of cached layers and for bringing them up to date.
+    auto renderLayerCache = [&shaderProgs, &stats](const RenderLayer &layer, const cc::Matrix4x4 &projMat, const cc::Matrix4x4 &viewMat, const float depth)
+    {
+        const RenderLayerCache &cache = layer.cache;
+
+        // The cache moves with the view from where it was drawn.
+        const float margin = static_cast<float>(cache.margin);
+
+        const float rect[4] = {
+            (viewMat.elems[3][0] - cache.viewMat.elems[3][0]) - margin,
+            (viewMat.elems[3][1] - cache.viewMat.elems[3][1]) - margin,
+            static_cast<float>(cache.size.x * cache.pxScale),
+            static_cast<float>(cache.size.y * cache.pxScale)
+        };
+
+        glUseProgram(shaderProgs.layerCacheGLID);
+        ++stats.progSwitchCnt;
+
+        glUniformMatrix4fv(shaderProgs.layerCacheProjUniLoc, 1, false, reinterpret_cast<const float *>(projMat.elems));
+        glUniform4fv(shaderProgs.layerCacheRectUniLoc, 1, rect);
+        glUniform1f(shaderProgs.layerCacheDepthUniLoc, depth);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, cache.colorTexGLID);
+        ++stats.texBindCnt;
+
+        glBindVertexArray(i_emptyVertArrayGLID);
+
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        ++stats.drawCallCnt;
+    };
+
+    // Each cache covers the view plus the margin, at the pixel density of the target its layer is drawn onto. Colours are stored multiplied by their alpha, so that the cache can be blended as the layer would have been.
+    auto updateLayerCaches = [&renderer, &bgColor, &windowSize, &renderSpriteBatches, &renderCharBatches, &stats](const int begin, const int end, const cc::Vec2DInt viewSize, const int pxScale, const int margin, const cc::Matrix4x4 &viewMat)
+    {
+        const cc::Vec2DInt size = {(viewSize.x + (margin * 2)) / pxScale, (viewSize.y + (margin * 2)) / pxScale};
+        const auto cacheProjMat = cc::make_ortho_matrix_4x4(-margin, (size.x * pxScale) - margin, (size.y * pxScale) - margin, -margin, -1.0f, 1.0f); // Top left at the negated margin.
+
+        bool anyDrawn = false;
+
+        for (int i = begin; i < end; ++i)
+        {
+            RenderLayer &layer = renderer.layers[i];
+
+            if (!layer.cached || is_render_layer_cache_usable(layer.cache, size, pxScale, margin, viewMat))
+            {
+                continue;
+            }
+
+            if (!anyDrawn)
+            {
+                glDisable(GL_DEPTH_TEST);
+                glEnable(GL_BLEND);
+                glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+                glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+
+                anyDrawn = true;
+            }
+
+            ensure_render_layer_cache_size(layer.cache, size);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, layer.cache.fbGLID);
+            glViewport(0, 0, size.x, size.y);
+            glClear(GL_COLOR_BUFFER_BIT);
+
+            // Opaque sprites keep their alpha testing, so that their edges match those drawn in the depth pass.
+            renderSpriteBatches(layer, cacheProjMat, viewMat, 0.0f, layer.opaqueSprites);
+            renderCharBatches(layer, cacheProjMat, viewMat, 0.0f);
+
+            layer.cache.pxScale = pxScale;
+            layer.cache.margin = margin;
+            layer.cache.viewMat = viewMat;
+            layer.cache.dirty = false;
+
+            ++stats.layerCacheDrawCnt;
+        }
+
+        if (anyDrawn)
+        {
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glClearColor(bgColor.r, bgColor.g, bgColor.b, bgColor.a);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, windowSize.x, windowSize.y);
+        }
+    };
+
+    // Define function for rendering a range of layers. Each layer has its own depth, nearer the later it is drawn.
+    // The sprites of opaque layers are drawn first, front to back with depth writes and alpha testing, so that anything they cover is rejected by the depth test before being shaded. Everything else is then drawn back to front with blending as usual, tested against but not writing depth.
+    // The blended pass passes at equal depth, so that the characters of an opaque layer still draw in front of its sprites.
+    auto renderLayers = [&renderer, &renderSpriteBatches, &renderCharBatches, &renderLayerCache](const int begin, const int end, const cc::Matrix4x4 &projMat, const cc::Matrix4x4 &viewMat)
+    {
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LESS);
+
+        glDisable(GL_BLEND);
+
+        for (int i = end - 1; i >= begin; --i)
+        {
+            if (renderer.layers[i].opaqueSprites && !renderer.layers[i].cached)
+            {
+                renderSpriteBatches(renderer.layers[i], projMat, viewMat, calc_render_layer_depth(i, renderer.layerCnt), true);
+            }
+        }
+
+        glEnable(GL_BLEND);
+        glDepthMask(GL_FALSE);
+        glDepthFunc(GL_LEQUAL);
+
+        for (int i = begin; i < end; ++i)
+        {
+            const RenderLayer &layer = renderer.layers[i];
+            const float depth = calc_render_layer_depth(i, renderer.layerCnt);
+
+            if (layer.cached)
+            {
+                renderLayerCache(layer, projMat, viewMat, depth);
+                continue;
+            }
+
+            if (!layer.opaqueSprites)
+            {
+                renderSpriteBatches(layer, projMat, viewMat, depth, false);
+            }
+
+            renderCharBatches(layer, projMat, viewMat, depth);
+        }
+
+        glDepthMask(GL_TRUE);
+        glDisable(GL_DEPTH_TEST);
+    };
+
+    // Render camera layers then non-camera ones.
+    if (renderer.camLayerCnt > 0)
+    {
+        // Collect the camera layer GPU time measured in an earlier frame, and start measuring this one if the query is free. No queries are issued unless something uses the measurements.
+        const GLID timerQueryGLID = i_camLayerTimerQueryGLIDs[i_camLayerTimerQueryIndex];
+        bool &timerQueryIssued = i_camLayerTimerQueriesIssued[i_camLayerTimerQueryIndex];
+
+        if (timerQueryIssued)
+        {
+            GLint available;
+            glGetQueryObjectiv(timerQueryGLID, GL_QUERY_RESULT_AVAILABLE, &available);
+
+            if (available)
+            {
+                GLuint64 dur;
+                glGetQueryObjectui64v(timerQueryGLID, GL_QUERY_RESULT, &dur);
+                renderer.camLayerGPUDur = dur / 1e9;
+
+                timerQueryIssued = false;
+            }
+        }
+
+        const bool timing = renderer.camLayerGPUTiming && !timerQueryIssued;
+
+        if (timing)
+        {
+            glBeginQuery(GL_TIME_ELAPSED, timerQueryGLID);
+        }
+
+        // If rendering at a reduced resolution, draw into the low resolution target instead. The projection is widened so that each target pixel covers exactly the scale in window pixels, with any remainder falling off the bottom and right.
+        const int scale = renderer.lowResScale;
+        const cc::Vec2DInt targSize = {(windowSize.x + scale - 1) / scale, (windowSize.y + scale - 1) / scale};
+        const cc::Matrix4x4 camViewMat = make_camera_view_matrix(*cam);
+        renderer.camViewMatLast = camViewMat;
+
+        updateLayerCaches(0, renderer.camLayerCnt, {targSize.x * scale, targSize.y * scale}, scale, calc_render_layer_cache_margin(scale), camViewMat);
+
+        cc::Matrix4x4 camProjMat = projMat;
+
+        if (scale > 1)
+        {
+            ensure_low_res_target_size(targSize);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, i_lowResTarget.fbGLID);
+            glViewport(0, 0, targSize.x, targSize.y);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            camProjMat = cc::make_ortho_matrix_4x4(0.0f, targSize.x * scale, targSize.y * scale, 0.0f, -1.0f, 1.0f);
+        }
+
+        renderLayers(0, renderer.camLayerCnt, camProjMat, camViewMat);
+
+        // Streamed quads, such as transient text, are in world space too, over the layers but under debug primitives.
+        draw_streamed_vert_batch(renderer.camStreamedQuads, shaderProgs, camProjMat, camViewMat, stats);
+
+        // Debug primitives are in world space and drawn over everything else there.
+        render_debug_draw(shaderProgs, camProjMat, camViewMat, stats);
+
+        // Scale the low resolution target up onto the window, keeping it aligned to the top left.
+        if (scale > 1)
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, i_lowResTarget.fbGLID);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glBlitFramebuffer(0, 0, targSize.x, targSize.y, 0, windowSize.y - (targSize.y * scale), targSize.x * scale, windowSize.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, windowSize.x, windowSize.y);
+        }
+
+        if (timing)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            timerQueryIssued = true;
+            i_camLayerTimerQueryIndex = (i_camLayerTimerQueryIndex + 1) % 2;
+        }
+    }
+
+    const cc::Matrix4x4 defaultViewMat = cc::make_identity_matrix_4x4();
+
+    updateLayerCaches(renderer.camLayerCnt, renderer.layerCnt, windowSize, 1, 0, defaultViewMat); // The view of these layers never moves, so a margin would only add fill.
+    renderLayers(renderer.camLayerCnt, renderer.layerCnt, projMat, defaultViewMat);
+
+    renderer.dirty = false;
+
+    // Finish off the statistics of this frame and start those of the next.
+    stats.liveGLObjCnt = i_liveGLObjCnt;
+    renderer.lastFrameStats = stats;
+    stats = {};
+}
+
+bool take_any_sprite_batch_slot(Renderer &renderer, const int layerIndex, const AssetID texID, SpriteBatchSlotKey &key)
+{
+    return take_sprite_batch_slots(renderer, layerIndex, texID, &key, 1) == 1;
+}
+
+int take_sprite_batch_slots(Renderer &renderer, const int layerIndex, const AssetID texID, SpriteBatchSlotKey *const keys, const int cnt)
+{
+    assert(layerIndex >= 0 && layerIndex < renderer.layerCnt);
+    assert(cnt >= 0);
+
+    RenderLayer &layer = renderer.layers[layerIndex];
+    SpriteBatchTexHint &texHint = get_sprite_batch_tex_hint(layer, texID);
+
+    int takenCnt = 0;
+
+    while (takenCnt < cnt)
+    {
+        int batchIndex;
+        TexUnit texUnit;
+
+        if (is_sprite_batch_tex_hint_usable(layer, texHint, texID))
+        {
+            // Use the batch the texture was last given a slot in, where it already has a texture unit.
+            batchIndex = texHint.batchIndex;
+            texUnit = texHint.texUnit;
+        }
+        else
+        {
+            // The hint was stale or overwritten by a colliding texture, so look for a batch where the texture has a unit and which still has room, only spending another unit if there is none.
+            batchIndex = find_sprite_batch_holding_tex(layer, texID, texUnit);
+
+            if (batchIndex == -1)
+            {
+                const SpriteBatchBreakReason slotBreakReason = i_spriteBatchBreakRecording ? find_sprite_batch_slot_break_reason(layer, texID) : SPRITE_BATCH_BREAK_REASON_CNT;
+
+                // Use any batch with room for another texture, growing the layer by activating a new batch if there are none.
+                batchIndex = first_active_bit_index(layer.spriteBatchOpenness, RenderLayer::sk_spriteBatchLimit);
+
+                if (batchIndex == -1)
+                {
+                    const SpriteBatchBreakReason activationReason = i_spriteBatchBreakRecording ? find_sprite_batch_activation_reason(layer) : SPRITE_BATCH_BREAK_REASON_CNT;
+
+                    batchIndex = activate_any_sprite_batch(renderer, layerIndex);
+
+                    if (batchIndex == -1)
+                    {
+                        assert(false && "The sprite batch limit of the render layer has been reached!");
+                        break;
+                    }
+
+                    if (i_spriteBatchBreakRecording)
+                    {
+                        record_sprite_batch_break({
+                            .reason = activationReason,
+                            .layerIndex = layerIndex,
+                            .batchIndex = batchIndex,
+                            .texID = texID
+                        });
+                    }
+                }
+
+                if (slotBreakReason != SPRITE_BATCH_BREAK_REASON_CNT)
+                {
+                    record_sprite_batch_break({
+                        .reason = slotBreakReason,
+                        .layerIndex = layerIndex,
+                        .batchIndex = batchIndex,
+                        .texID = texID
+                    });
+                }
+
+                texUnit = take_free_sprite_batch_tex_unit(layer.spriteBatches[batchIndex], texID);
+            }
+
+            texHint = {
+                .texID = texID,
+                .batchIndex = batchIndex,
+                .texUnit = texUnit
+            };
+        }
+
+        // Take as many of the slots from this batch as it has room for.
+        SpriteBatch &batch = layer.spriteBatches[batchIndex];
+        const int takenCntBefore = takenCnt;
+
+        while (takenCnt < cnt && batch.freeSlotIndex != -1)
+        {
+            const int slotIndex = take_free_sprite_batch_slot(batch);
+            batch.slotTexUnits[slotIndex] = texUnit;
+
+            // Create a handle referring to the slot.
+            const int handleIndex = take_sprite_batch_slot_handle(layer, {batchIndex, slotIndex});
+            batch.slotHandleIndices[slotIndex] = handleIndex;
+
+            keys[takenCnt] = {
+                .layerIndex = layerIndex,
+                .handleIndex = handleIndex
+            };
+
+            ++takenCnt;
+        }
+
+        batch.texUnitInfos[texUnit].refCnt += takenCnt - takenCntBefore;
+
+        update_sprite_batch_openness(layer, batchIndex);
+    }
+
+    for (int i = takenCnt; i < cnt; ++i)
+    {
+        keys[i] = {
+            .layerIndex = layerIndex,
+            .handleIndex = -1
+        };
+    }
+
+    return takenCnt;
+}
+
+void release_sprite_batch_slot(Renderer &renderer, const SpriteBatchSlotKey &key)
+{
+    // Clear the slot render data.
+    clear_sprite_batch_slot(renderer, key);
+
+    RenderLayer &layer = renderer.layers[key.layerIndex];
+    const SpriteBatchSlotLoc loc = get_sprite_batch_slot_loc(renderer, key);
+    SpriteBatch &batch = layer.spriteBatches[loc.batchIndex];
+
+    // Return the slot to the free list of the batch.
+    release_free_sprite_batch_slot(batch, loc.slotIndex);
+    layer.spriteBatchCompactionStalled = false;
+
+    // Update texture unit information. If the texture keeps its unit, this batch now has room for it, so point the texture here.
+    const TexUnit texUnit = batch.slotTexUnits[loc.slotIndex];
+    const AssetID texID = batch.texUnitInfos[texUnit].texID;
+    unref_sprite_batch_tex_unit(batch, texUnit, 1);
+
+    if (batch.texUnitInfos[texUnit].refCnt)
+    {
+        get_sprite_batch_tex_hint(layer, texID) = {
+            .texID = texID,
+            .batchIndex = loc.batchIndex,
+            .texUnit = texUnit
+        };
+    }
+
+    update_sprite_batch_openness(layer, loc.batchIndex);
+
+    // Release the handle.
+    release_sprite_batch_slot_handle(layer, key.handleIndex);
+}
+
+void write_to_sprite_batch_slot(Renderer &renderer, const SpriteBatchSlotKey &key, const SpriteBatchSlotWriteData &writeData, const AssetGroupManager &assetGroupManager)
+{
+    const RenderLayer &layer = renderer.layers[key.layerIndex];
+
+    assert(((layer.spriteFeatures & SPRITE_FEATURE_ROT_BIT) || writeData.rot == 0.0f) && "The layer of the slot does not have the rotation feature!");
+    assert(((layer.spriteFeatures & SPRITE_FEATURE_ALPHA_BIT) || writeData.alpha == 1.0f) && "The layer of the slot does not have the alpha feature!");
+
+    const SpriteBatchSlotLoc &loc = get_sprite_batch_slot_loc(renderer, key);
+    SpriteBatch &batch = layer.spriteBatches[loc.batchIndex];
+    const int texUnit = batch.slotTexUnits[loc.slotIndex];
+    assert((writeData.palette == -1 || assetGroupManager.get_tex_palette_index(batch.texUnitInfos[texUnit].texID) != -1) && "Palette swaps are only possible for textures stored with a palette!");
+    const cc::Vec2DInt texSize = assetGroupManager.get_tex_size(batch.texUnitInfos[texUnit].texID);
+
+    const cc::Vec2D texCoordsTopLeft = {
+        static_cast<float>(writeData.srcRect.x) / texSize.x,
+        static_cast<float>(writeData.srcRect.y) / texSize.y
+    };
+
+    const cc::Vec2D texCoordsBottomRight = {
+        static_cast<float>(writeData.srcRect.right()) / texSize.x,
+        static_cast<float>(writeData.srcRect.bottom()) / texSize.y
+    };
+
+    SpriteQuadVert newVerts[gk_spriteBatchSlotVertsCnt];
+    ik_spriteQuadVertWriters[layer.spriteFeatures](newVerts, writeData.pos, writeData.srcRect.size, writeData.origin, writeData.scale, writeData.rot, texUnit, texCoordsTopLeft, texCoordsBottomRight, writeData.alpha, writeData.palette, -1);
+
+    write_sprite_batch_slot_verts(batch, loc.slotIndex, newVerts);
+}
+
+// Returns the first animation time after the given one at which the vertex shader could show the sprite of the vertex at a different frame.
+// The frame is picked with floats on the GPU, so a change could land a tick either side of where it falls exactly. Changes are therefore counted from a tick early, and the tick following is counted as well.
+static int calc_sprite_anim_frame_change_time(const SpriteQuadVert &vert, const int time)
+{
+    assert(vert.anim > 0);
+
+    const int frameCnt = i_spriteAnims[vert.anim - 1].frameCnt;
+    const double rate = vert.texCoord[0] / 65535.0;
+
+    if (frameCnt == 1 || rate == 0.0)
+    {
+        return INT_MAX;
+    }
+
+    const double phase = (vert.texCoord[1] / 65535.0) * frameCnt;
+    const double frame = (time * rate) - phase; // Unwrapped, so that every whole number crossed is a frame change.
+    const double margin = 1.0e-4 + (fabs(frame) * 1.0e-6);
+
+    const double nextFrame = floor(frame - margin) + 1.0;
+    const double changeTime = ceil((nextFrame - margin + phase) / rate);
+
+    return static_cast<int>(std::clamp(changeTime, time + 1.0, static_cast<double>(INT_MAX)));
+}
+
+static int find_sprite_anim_frame_change_time(const RenderLayer &layer, const int time)
+{
+    int changeTime = INT_MAX;
+
+    for (int i = 0; i < layer.spriteBatchCnt; ++i)
+    {
+        if (!is_bit_active(layer.spriteBatchActivity, i))
+        {
+            continue;
+        }
+
+        const SpriteBatch &batch = layer.spriteBatches[i];
+
+        for (int j = 0; j < layer.spriteBatchSlotCnt; ++j)
+        {
+            // Every corner of a quad shares its animation, so only the first needs checking.
+            const SpriteQuadVert &vert = batch.quadBufVerts[j * gk_spriteBatchSlotVertsCnt];
+
+            if (vert.anim && vert.alpha)
+            {
+                changeTime = std::min(calc_sprite_anim_frame_change_time(vert, time), changeTime);
+            }
+        }
+    }
+
+    return changeTime;
+}
+
+void write_anim_to_sprite_batch_slot(Renderer &renderer, const SpriteBatchSlotKey &key, const SpriteBatchSlotAnimWriteData &writeData, const AssetGroupManager &assetGroupManager)
+{
+    RenderLayer &layer = renderer.layers[key.layerIndex];
+
+    assert((layer.spriteFeatures & SPRITE_FEATURE_ANIM_BIT) && "The layer of the slot does not have the animation feature!");
+    assert(((layer.spriteFeatures & SPRITE_FEATURE_ROT_BIT) || writeData.rot == 0.0f) && "The layer of the slot does not have the rotation feature!");
+    assert(((layer.spriteFeatures & SPRITE_FEATURE_ALPHA_BIT) || writeData.alpha == 1.0f) && "The layer of the slot does not have the alpha feature!");
+    assert(writeData.animIndex >= 0 && writeData.animIndex < i_spriteAnimCnt);
+    assert(writeData.rate > 0.0f && writeData.rate < 1.0f);
+
+    const SpriteAnim &anim = i_spriteAnims[writeData.animIndex];
+
+    const SpriteBatchSlotLoc &loc = get_sprite_batch_slot_loc(renderer, key);
+    SpriteBatch &batch = layer.spriteBatches[loc.batchIndex];
+    const int texUnit = batch.slotTexUnits[loc.slotIndex];
+    assert(batch.texUnitInfos[texUnit].texID == anim.texID && "The slot was not taken with the texture of the animation!");
+    assert((writeData.palette == -1 || assetGroupManager.get_tex_palette_index(anim.texID) != -1) && "Palette swaps are only possible for textures stored with a palette!");
+
+    // In place of texture coordinates, every corner holds the rate and the phase the animation started at, from which the vertex shader picks the frame.
+    // The phase is worked out from the rate as it will be quantised, and rounded down, so that the first frame is the one shown at the start time.
+    const float rate = to_unorm_16(writeData.rate) / 65535.0f;
+    const double phase = fmod(static_cast<double>(writeData.startTime) * rate, anim.frameCnt) / anim.frameCnt;
+
+    const cc::Vec2D animTexCoords = {
+        rate,
+        static_cast<float>(floor(phase * 65535.0) / 65535.0)
+    };
+
+    SpriteQuadVert newVerts[gk_spriteBatchSlotVertsCnt];
+    ik_spriteQuadVertWriters[layer.spriteFeatures](newVerts, writeData.pos, anim.frameSize, writeData.origin, writeData.scale, writeData.rot, texUnit, animTexCoords, animTexCoords, writeData.alpha, writeData.palette, writeData.animIndex);
+
+    write_sprite_batch_slot_verts(batch, loc.slotIndex, newVerts);
+
+    layer.spriteAnimFrameChangeTime = std::min(calc_sprite_anim_frame_change_time(newVerts[0], renderer.spriteAnimTime), layer.spriteAnimFrameChangeTime);
+}
+
+void clear_sprite_batch_slot(Renderer &renderer, const SpriteBatchSlotKey &key)
+{
+    const SpriteBatchSlotLoc &loc = get_sprite_batch_slot_loc(renderer, key);
+    SpriteBatch &batch = renderer.layers[key.layerIndex].spriteBatches[loc.batchIndex];
+
+    SpriteQuadVert *const verts = batch.quadBufVerts + (loc.slotIndex * gk_spriteBatchSlotVertsCnt);
+    memset(verts, 0, gk_spriteBatchSlotVertsSize);
+
+    mark_sprite_batch_slots_modified(batch, loc.slotIndex, loc.slotIndex + 1);
+}
+
+void advance_sprite_anim_time(Renderer &renderer)
+{
+    ++renderer.spriteAnimTime;
+
+    // Only redraw on ticks where an animated sprite could change frame, finding the next such tick from the sprites which remain.
+    for (int i = 0; i < renderer.layerCnt; ++i)
+    {
+        RenderLayer &layer = renderer.layers[i];
+
+        if (!(layer.spriteFeatures & SPRITE_FEATURE_ANIM_BIT) || renderer.spriteAnimTime < layer.spriteAnimFrameChangeTime)
+        {
+            continue;
+        }
+
+        renderer.dirty = true;
+        layer.cache.dirty = true;
+
+        layer.spriteAnimFrameChangeTime = find_sprite_anim_frame_change_time(layer, renderer.spriteAnimTime);
+    }
+}
+
+void compact_sprite_batches(Renderer &renderer, const double timeBudget)
+{
+    const double timeLimit = glfwGetTime() + timeBudget;
+
+    // Work through the layers from where the previous pass left off, so that every layer eventually gets a share of the budget.
+    for (int i = 0; i < renderer.layerCnt; ++i)
+    {
+        const int layerIndex = (renderer.compactionLayerIndex + i) % renderer.layerCnt;
+        RenderLayer &layer = renderer.layers[layerIndex];
+
+        if (layer.spriteBatchCompactionStalled)
+        {
+            continue;
+        }
+
+        // Determine whether the slots in use would fit into one fewer batch, in which case the last active batch is a candidate to be emptied.
+        int srcBatchIndex = -1;
+        int activeBatchCnt = 0;
+        int activeSlotCnt = 0;
+
+        for (int j = 0; j < layer.spriteBatchCnt; ++j)
+        {
+            if (!is_bit_active(layer.spriteBatchActivity, j) || layer.spriteBatches[j].takenWhole)
+            {
+                continue;
+            }
+
+            SpriteBatch &batch = layer.spriteBatches[j];
+
+            // Retire empty batches once they have stayed empty for long enough.
+            if (!batch.activeSlotCnt)
+            {
+                ++batch.emptyFrameCnt;
+
+                if (batch.emptyFrameCnt >= ik_spriteBatchRetireEmptyFrameCnt)
+                {
+                    retire_sprite_batch(renderer, layer, j);
+                }
+
+                continue;
+            }
+
+            batch.emptyFrameCnt = 0;
+
+            srcBatchIndex = j;
+            ++activeBatchCnt;
+            activeSlotCnt += batch.activeSlotCnt;
+        }
+
+        if (srcBatchIndex == -1)
+        {
+            continue;
+        }
+
+        SpriteBatch &srcBatch = layer.spriteBatches[srcBatchIndex];
+
+        if (activeSlotCnt > (activeBatchCnt - 1) * layer.spriteBatchSlotCnt)
+        {
+            continue;
+        }
+
+        if (glfwGetTime() >= timeLimit)
+        {
+            renderer.compactionLayerIndex = layerIndex;
+            return;
+        }
+
+        // Move slots down into the holes of earlier batches. A slot that fits into none of them (e.g. because their texture units are used up) would not fit on later passes either, so the layer is left alone until a slot of it is released.
+        for (int j = 0; j < layer.spriteBatchSlotCnt; ++j)
+        {
+            if (!is_bit_active(srcBatch.slotActivity, j))
+            {
+                continue;
+            }
+
+            bool moved = false;
+
+            for (int k = 0; k < srcBatchIndex; ++k)
+            {
+                if (!is_bit_active(layer.spriteBatchActivity, k) || layer.spriteBatches[k].takenWhole)
+                {
+                    continue;
+                }
 
-    const int vertCnt = isSprite ? gk_spriteQuadShaderProgVertCnt : gk_charQuadShaderProgVertCnt;
+                if (move_sprite_batch_slot(layer, {srcBatchIndex, j}, k))
+                {
+                    moved = true;
+                    break;
+                }
+            }
 
-    // Generate vertex array.
-    glGenVertexArrays(1, &glIDs.vertArrayGLID);
-    glBindVertexArray(glIDs.vertArrayGLID);
+            if (!moved)
+            {
+                layer.spriteBatchCompactionStalled = true;
+                break;
+            }
+        }
 
-    // Generate vertex buffer.
-    glGenBuffers(1, &glIDs.vertBufGLID);
-    glBindBuffer(GL_ARRAY_BUFFER, glIDs.vertBufGLID);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertCnt * 4 * quadCnt, nullptr, GL_DYNAMIC_DRAW);
+        // A batch this has emptied is left to be retired by later passes like any other, in case its room is soon needed again.
+    }
 
-    // Generate element buffer.
-    glGenBuffers(1, &glIDs.elemBufGLID);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, glIDs.elemBufGLID);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned short) * 6 * quadCnt, i_quadIndices, GL_STATIC_DRAW);
+    renderer.compactionLayerIndex = (renderer.compactionLayerIndex + 1) % renderer.layerCnt;
+}
 
-    // Set vertex attribute pointers.
-    const int vertsStride = sizeof(float) * vertCnt;
+void submit_sprite_batch_slots(Renderer &renderer)
+{
+    GLID boundVertBufGLID = 0;
 
-    if (isSprite)
+    for (int i = 0; i < renderer.layerCnt; ++i)
     {
-        glVertexAttribPointer(0, 2, GL_FLOAT, false, vertsStride, reinterpret_cast<void *>(sizeof(float) * 0));
-        glEnableVertexAttribArray(0);
+        RenderLayer &layer = renderer.layers[i];
 
-        glVertexAttribPointer(1, 2, GL_FLOAT, false, vertsStride, reinterpret_cast<void *>(sizeof(float) * 2));
-        glEnableVertexAttribArray(1);
+        for (int j = 0; j < layer.spriteBatchCnt; ++j)
+        {
+            SpriteBatch &batch = layer.spriteBatches[j];
 
-        glVertexAttribPointer(2, 2, GL_FLOAT, false, vertsStride, reinterpret_cast<void *>(sizeof(float) * 4));
-        glEnableVertexAttribArray(2);
+            if (!is_bit_active(layer.spriteBatchActivity, j))
+            {
+                continue;
+            }
 
-        glVertexAttribPointer(3, 1, GL_FLOAT, false, vertsStride, reinterpret_cast<void *>(sizeof(float) * 6));
-        glEnableVertexAttribArray(3);
+            update_sprite_batch_usage(batch, layer);
 
-        glVertexAttribPointer(4, 1, GL_FLOAT, false, vertsStride, reinterpret_cast<void *>(sizeof(float) * 7));
-        glEnableVertexAttribArray(4);
+            if (batch.modifiedSlotRange.end - batch.modifiedSlotRange.begin == 0)
+            {
+                // No slots have been modified, so no need to write.
+                continue;
+            }
 
-        glVertexAttribPointer(5, 2, GL_FLOAT, false, vertsStride, reinterpret_cast<void *>(sizeof(float) * 8));
-        glEnableVertexAttribArray(5);
+            const GLID vertBufGLID = i_quadVertArenas[batch.quadBuf.arenaID].vertBufGLID;
 
-        glVertexAttribPointer(6, 1, GL_FLOAT, false, vertsStride, reinterpret_cast<void *>(sizeof(float) * 10));
-        glEnableVertexAttribArray(6);
-    }
-    else
-    {
-        glVertexAttribPointer(0, 2, GL_FLOAT, false, vertsStride, reinterpret_cast<void *>(sizeof(float) * 0));
-        glEnableVertexAttribArray(0);
+            if (vertBufGLID != boundVertBufGLID)
+            {
+                glBindBuffer(GL_ARRAY_BUFFER, vertBufGLID);
+                boundVertBufGLID = vertBufGLID;
+            }
 
-        glVertexAttribPointer(1, 2, GL_FLOAT, false, vertsStride, reinterpret_cast<void *>(sizeof(float) * 2));
-        glEnableVertexAttribArray(1);
-    }
+            // Submit the modified range of vertex data to where the batch lies in its arena.
+            const int offs = gk_spriteBatchSlotVertsSize * (batch.quadBuf.quadOffs + batch.modifiedSlotRange.begin);
+            const int size = gk_spriteBatchSlotVertsSize * (batch.modifiedSlotRange.end - batch.modifiedSlotRange.begin);
+            glBufferSubData(GL_ARRAY_BUFFER, offs, size, batch.quadBufVerts + (gk_spriteBatchSlotVertsCnt * batch.modifiedSlotRange.begin));
+            renderer.frameStats.uploadedByteCnt += size;
 
-    // Unbind.
-    glBindVertexArray(0);
+            renderer.dirty = true;
+            layer.cache.dirty = true;
 
-    return glIDs;
+            // Reset the modified slot range for next time.
+            batch.modifiedSlotRange = {};
+        }
+    }
 }
 
-void clean_quad_buf(QuadBufGLIDs &glIDs)
+const RenderStats &get_render_stats(const Renderer &renderer)
 {
-    glDeleteBuffers(1, &glIDs.vertBufGLID);
-    glDeleteBuffers(1, &glIDs.elemBufGLID);
-    glDeleteVertexArrays(1, &glIDs.vertArrayGLID);
-
-    glIDs = {};
+    return renderer.lastFrameStats;
 }
 
-void init_renderer(Renderer &renderer, cc::MemArena &permMemArena, const int layerCnt, const int camLayerCnt, const RenderLayerInitInfoFactory layerInitInfoFactory)
+void log_render_stats(const RenderStats &stats)
 {
-    assert(layerCnt > 0);
-    assert(camLayerCnt >= 0 && camLayerCnt <= layerCnt);
-    assert(layerInitInfoFactory);
+    cc::log("Render stats: %d draw calls, %d texture binds, %d program switches, %d/%d active/drawn quads, %d bytes uploaded, %d live GL objects, %d layer caches drawn.", stats.drawCallCnt, stats.texBindCnt, stats.progSwitchCnt, stats.activeQuadCnt, stats.drawnQuadCnt, stats.uploadedByteCnt, stats.liveGLObjCnt, stats.layerCacheDrawCnt);
+}
 
-    renderer.layerCnt = layerCnt;
-    renderer.camLayerCnt = camLayerCnt;
+void init_streamed_vert_batch(StreamedVertBatch &batch, StreamedVert *const verts, const int vertLimit, const GLenum drawMode)
+{
+    assert(vertLimit > 0);
+    assert(drawMode == GL_LINES || drawMode == GL_TRIANGLES);
+
+    batch = {
+        .verts = verts,
+        .vertLimit = vertLimit,
+        .vertCnt = 0,
+        .drawMode = drawMode,
+        .changed = false
+    };
+}
 
-    renderer.layers = cc::push_to_mem_arena<RenderLayer>(permMemArena, layerCnt);
+bool add_streamed_line(StreamedVertBatch &batch, const cc::Vec2D a, const cc::Vec2D b, const Color &color)
+{
+    assert(batch.drawMode == GL_LINES);
 
-    for (int i = 0; i < layerCnt; ++i)
+    if (batch.vertCnt + 2 > batch.vertLimit)
     {
-        init_render_layer(renderer.layers[i], permMemArena, layerInitInfoFactory(i));
+        return false;
     }
+
+    StreamedVert *const verts = batch.verts + batch.vertCnt;
+    verts[0] = {a, {-1.0f, -1.0f}, color};
+    verts[1] = {b, {-1.0f, -1.0f}, color};
+
+    batch.vertCnt += 2;
+    batch.changed = true;
+
+    return true;
 }
 
-void clean_renderer(Renderer &renderer)
+bool add_streamed_quad(StreamedVertBatch &batch, const cc::Vec2D topLeft, const cc::Vec2D bottomRight, const cc::Vec2D texCoordsTopLeft, const cc::Vec2D texCoordsBottomRight, const Color &color)
 {
-    for (int i = 0; i < renderer.layerCnt; ++i)
+    assert(batch.drawMode == GL_TRIANGLES);
+
+    if (batch.vertCnt + 6 > batch.vertLimit)
     {
-        clean_render_layer(renderer.layers[i]);
+        return false;
     }
 
-    renderer = {};
+    StreamedVert *const verts = batch.verts + batch.vertCnt;
+    verts[0] = {topLeft, texCoordsTopLeft, color};
+    verts[1] = {{bottomRight.x, topLeft.y}, {texCoordsBottomRight.x, texCoordsTopLeft.y}, color};
+    verts[2] = {bottomRight, texCoordsBottomRight, color};
+    verts[3] = verts[2];
+    verts[4] = {{topLeft.x, bottomRight.y}, {texCoordsTopLeft.x, texCoordsBottomRight.y}, color};
+    verts[5] = verts[0];
+
+    batch.vertCnt += 6;
+    batch.changed = true;
+
+    return true;
 }
 
-void render(const Renderer &renderer, const Color &bgColor, const AssetGroupManager &assetGroupManager, const ShaderProgs &shaderProgs, const Camera *const cam)
+void clear_streamed_vert_batch(StreamedVertBatch &batch)
 {
-    assert((renderer.camLayerCnt > 0) == (cam != nullptr));
-
-    // Clear the screen with the background colour.
-    glClearColor(bgColor.r, bgColor.g, bgColor.b, bgColor.a);
-    glClear(GL_COLOR_BUFFER_BIT);
+    if (batch.vertCnt)
+    {
+        batch.vertCnt = 0;
+        batch.changed = true;
+    }
+}
 
-    // Set up texture units.
-    static int texUnits[gk_texUnitLimitCap];
-    static bool texUnitsInitialized;
+void draw_streamed_vert_batch(StreamedVertBatch &batch, const ShaderProgs &shaderProgs, const cc::Matrix4x4 &projMat, const cc::Matrix4x4 &viewMat, RenderStats &stats)
+{
+    batch.changed = false;
 
-    if (!texUnitsInitialized)
+    if (!batch.vertCnt)
     {
-        std::iota(texUnits, texUnits + i_texUnitLimit, 0);
-        texUnitsInitialized = true;
+        return;
     }
 
-    // Create the projection matrices.
-    const auto projMat = cc::make_ortho_matrix_4x4(0.0f, get_window_size().x, get_window_size().y, 0.0f, -1.0f, 1.0f);
+    // Upload the vertices into fresh storage, so that this does not wait on the draws of the previous frame.
+    const int vertsSize = sizeof(StreamedVert) * batch.vertCnt;
 
-    // Define function for rendering a layer.
-    auto renderLayer = [&assetGroupManager, &shaderProgs, &projMat](const RenderLayer &layer, const cc::Matrix4x4 &viewMat)
-    {
-        // Render sprite batches.
-        glUseProgram(shaderProgs.spriteQuadGLID);
+    glBindBuffer(GL_ARRAY_BUFFER, i_streamedVertBufGLID);
+    glBufferData(GL_ARRAY_BUFFER, vertsSize, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertsSize, batch.verts);
+    stats.uploadedByteCnt += vertsSize;
 
-        glUniformMatrix4fv(shaderProgs.spriteQuadProjUniLoc, 1, false, reinterpret_cast<const float *>(projMat.elems));
-        glUniformMatrix4fv(shaderProgs.spriteQuadViewUniLoc, 1, false, reinterpret_cast<const float *>(viewMat.elems));
+    glUseProgram(shaderProgs.streamedVertGLID);
+    ++stats.progSwitchCnt;
 
-        glUniform1iv(shaderProgs.spriteQuadTexturesUniLoc, i_texUnitLimit, texUnits);
+    glUniformMatrix4fv(shaderProgs.streamedVertProjUniLoc, 1, false, reinterpret_cast<const float *>(projMat.elems));
+    glUniformMatrix4fv(shaderProgs.streamedVertViewUniLoc, 1, false, reinterpret_cast<const float *>(viewMat.elems));
 
-        for (int i = 0; i < layer.spriteBatchCnt; ++i)
-        {
-            if (!is_bit_active(layer.spriteBatchActivity, i))
-            {
-                continue;
-            }
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, get_glyph_atlas_tex_gl_id());
+    ++stats.texBindCnt;
 
-            const SpriteBatch &sb = layer.spriteBatches[i];
+    glBindVertexArray(i_streamedVertArrayGLID);
+    glDrawArrays(batch.drawMode, 0, batch.vertCnt);
+    ++stats.drawCallCnt;
 
-            // Bind texture GLIDs to units.
-            for (int j = 0; j < i_texUnitLimit; ++j)
-            {
-                if (!sb.texUnitInfos[j].refCnt)
-                {
-                    continue;
-                }
+    if (batch.drawMode == GL_TRIANGLES)
+    {
+        stats.activeQuadCnt += batch.vertCnt / 6;
+        stats.drawnQuadCnt += batch.vertCnt / 6;
+    }
+}
 
-                glActiveTexture(GL_TEXTURE0 + j);
-                glBindTexture(GL_TEXTURE_2D, assetGroupManager.get_tex_gl_id(sb.texUnitInfos[j].texID));
-            }
+void set_sprite_batch_break_recording(const bool enabled)
+{
+    i_spriteBatchBreakRecording = enabled;
+}
 
-            // Draw the batch.
-            glBindVertexArray(sb.quadBufGLIDs.vertArrayGLID);
-            glDrawElements(GL_TRIANGLES, 6 * layer.spriteBatchSlotCnt, GL_UNSIGNED_SHORT, nullptr);
-        }
+void clear_sprite_batch_breaks()
+{
+    i_spriteBatchBreakCnt = 0;
+    memset(i_spriteBatchBreakReasonCnts, 0, sizeof(i_spriteBatchBreakReasonCnts));
+    i_spriteBatchBreakTexTallyCnt = 0;
+    i_spriteBatchBreakUntalliedCnt = 0;
+}
 
-        // Render character batches.
-        glUseProgram(shaderProgs.charQuadGLID);
+void log_sprite_batch_break_report(const int texLimit)
+{
+    assert(texLimit >= 0);
 
-        glUniformMatrix4fv(shaderProgs.charQuadProjUniLoc, 1, false, reinterpret_cast<const float *>(projMat.elems));
-        glUniformMatrix4fv(shaderProgs.charQuadViewUniLoc, 1, false, reinterpret_cast<const float *>(viewMat.elems));
+    cc::log("Sprite batch breaks: %d in total.", i_spriteBatchBreakCnt);
 
-        for (int i = 0; i < layer.charBatchCnt; ++i)
+    for (int i = 0; i < SPRITE_BATCH_BREAK_REASON_CNT; ++i)
+    {
+        if (i_spriteBatchBreakReasonCnts[i])
         {
-            if (!is_bit_active(layer.charBatchActivity, i))
-            {
-                continue;
-            }
-
-            CharBatch &cb = layer.charBatches[i];
+            cc::log("    %s: %d", ik_spriteBatchBreakReasonNames[i], i_spriteBatchBreakReasonCnts[i]);
+        }
+    }
 
-            glUniform2fv(shaderProgs.charQuadPosUniLoc, 1, reinterpret_cast<const float *>(&cb.pos));
-            glUniform1f(shaderProgs.charQuadRotUniLoc, cb.rot);
-            glUniform4fv(shaderProgs.charQuadBlendUniLoc, 1, reinterpret_cast<const float *>(&cb.blend));
+    // Log the textures with the most breaks, most first.
+    static int texTallyOrder[ik_spriteBatchBreakTexTallyLimit];
+    std::iota(texTallyOrder, texTallyOrder + i_spriteBatchBreakTexTallyCnt, 0);
 
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, assetGroupManager.get_font_tex_gl_id(cb.fontID));
+    const int texCnt = std::min(texLimit, i_spriteBatchBreakTexTallyCnt);
 
-            // Draw the batch.
-            glBindVertexArray(cb.quadBufGLIDs.vertArrayGLID);
-            glDrawElements(GL_TRIANGLES, 6 * cb.slotCnt, GL_UNSIGNED_SHORT, nullptr);
+    std::partial_sort(texTallyOrder, texTallyOrder + texCnt, texTallyOrder + i_spriteBatchBreakTexTallyCnt,
+        [](const int a, const int b)
+        {
+            return i_spriteBatchBreakTexTallies[a].total > i_spriteBatchBreakTexTallies[b].total;
         }
-    };
+    );
 
-    // Render camera layers then non-camera ones.
-    if (renderer.camLayerCnt > 0)
+    for (int i = 0; i < texCnt; ++i)
     {
-        const cc::Matrix4x4 camViewMat = make_camera_view_matrix(*cam);
+        const SpriteBatchBreakTexTally &tally = i_spriteBatchBreakTexTallies[texTallyOrder[i]];
 
-        int i = 0;
+        // List the reasons behind the breaks of the texture.
+        char reasonsStr[256] = {};
+        int reasonsStrLen = 0;
 
-        do
+        for (int j = 0; j < SPRITE_BATCH_BREAK_REASON_CNT && reasonsStrLen < static_cast<int>(sizeof(reasonsStr)); ++j)
         {
-            renderLayer(renderer.layers[i], camViewMat);
-            ++i;
+            if (tally.reasonCnts[j])
+            {
+                reasonsStrLen += snprintf(reasonsStr + reasonsStrLen, sizeof(reasonsStr) - reasonsStrLen, "%s%s %d", reasonsStrLen ? ", " : "", ik_spriteBatchBreakReasonNames[j], tally.reasonCnts[j]);
+            }
         }
-        while (i < renderer.camLayerCnt);
+
+        cc::log("    Texture %d of group %d: %d (%s)", tally.texID.index, tally.texID.groupIndex, tally.total, reasonsStr);
     }
 
-    const cc::Matrix4x4 defaultViewMat = cc::make_identity_matrix_4x4();
+    if (i_spriteBatchBreakUntalliedCnt)
+    {
+        cc::log("    %d breaks of further textures were not tallied.", i_spriteBatchBreakUntalliedCnt);
+    }
 
-    for (int i = renderer.camLayerCnt; i < renderer.layerCnt; ++i)
+    // Log the latest breaks, oldest first.
+    const int historyCnt = std::min(i_spriteBatchBreakCnt, ik_spriteBatchBreakHistoryLen);
+
+    for (int i = i_spriteBatchBreakCnt - historyCnt; i < i_spriteBatchBreakCnt; ++i)
     {
-        renderLayer(renderer.layers[i], defaultViewMat);
+        const SpriteBatchBreak &brk = i_spriteBatchBreaks[i % ik_spriteBatchBreakHistoryLen];
+
+        cc::log("    #%d: layer %d, batch %d, texture %d of group %d, %s", i, brk.layerIndex, brk.batchIndex, brk.texID.index, brk.texID.groupIndex, ik_spriteBatchBreakReasonNames[brk.reason]);
     }
 }
 
-SpriteBatchSlotKey take_any_sprite_batch_slot(Renderer &renderer, const int layerIndex, const AssetID texID)
+int take_whole_sprite_batch(Renderer &renderer, const int layerIndex, const AssetID texID)
 {
-    assert(layerIndex >= 0 && layerIndex < renderer.layerCnt);
-
-    RenderLayer &layer = renderer.layers[layerIndex];
+    const int batchIndex = activate_any_sprite_batch(renderer, layerIndex);
 
-    for (int i = 0; i < layer.spriteBatchCnt; ++i)
+    if (batchIndex == -1)
     {
-        if (!is_bit_active(layer.spriteBatchActivity, i))
-        {
-            continue;
-        }
-
-        SpriteBatch &sb = layer.spriteBatches[i];
+        return -1;
+    }
 
-        // Continue if no slot is available.
-        if (are_all_bits_active(sb.slotActivity, layer.spriteBatchSlotCnt))
-        {
-            continue;
-        }
+    if (i_spriteBatchBreakRecording)
+    {
+        record_sprite_batch_break({
+            .reason = SPRITE_BATCH_BREAK_TAKEN_WHOLE,
+            .layerIndex = layerIndex,
+            .batchIndex = batchIndex,
+            .texID = texID
+        });
+    }
 
-        // Find a texture unit to use, continue if none are suitable.
-        const TexUnit texUnit = find_sprite_batch_tex_unit_to_use(layer, i, texID);
+    RenderLayer &layer = renderer.layers[layerIndex];
+    SpriteBatch &batch = layer.spriteBatches[batchIndex];
 
-        if (texUnit == -1)
-        {
-            continue;
-        }
+    // Mark every slot as active so that no other owner is given one, with all of them using the first texture unit.
+    memset(batch.slotActivity, 0xFF, bits_to_bytes(layer.spriteBatchSlotCnt));
 
-        // Use the first inactive slot.
-        const int slotIndex = first_inactive_bit_index(sb.slotActivity, layer.spriteBatchSlotCnt);
-        activate_bit(sb.slotActivity, slotIndex);
+    batch.activeSlotCnt = layer.spriteBatchSlotCnt;
+    batch.freeSlotIndex = -1;
 
-        // Update texture unit information.
-        SpriteBatchTexUnitInfo &texUnitInfo = sb.texUnitInfos[texUnit];
-        texUnitInfo.texID = texID;
-        ++texUnitInfo.refCnt;
+    const TexUnit texUnit = take_free_sprite_batch_tex_unit(batch, texID);
+    assert(texUnit == 0);
+    batch.texUnitInfos[texUnit].refCnt = layer.spriteBatchSlotCnt;
 
-        sb.slotTexUnits[slotIndex] = texUnit;
+    batch.takenWhole = true;
 
-        return {
-            .layerIndex = layerIndex,
-            .batchIndex = i,
-            .slotIndex = slotIndex
-        };
-    }
+    update_sprite_batch_openness(layer, batchIndex);
 
-    // Failed to find a batch to use in the layer, so activate a new one and try this all again.
-    activate_any_sprite_batch(renderer, layerIndex);
-    return take_any_sprite_batch_slot(renderer, layerIndex, texID); // FIXME: Way more work is done here than necessary.
+    return batchIndex;
 }
 
-void release_sprite_batch_slot(Renderer &renderer, const SpriteBatchSlotKey &key)
+void release_whole_sprite_batch(Renderer &renderer, const int layerIndex, const int batchIndex)
 {
-    RenderLayer &layer = renderer.layers[key.layerIndex];
-    SpriteBatch &batch = layer.spriteBatches[key.batchIndex];
+    assert(layerIndex >= 0 && layerIndex < renderer.layerCnt);
 
-    // Mark the slot as inactive.
-    deactivate_bit(batch.slotActivity, layer.spriteBatchSlotCnt);
+    RenderLayer &layer = renderer.layers[layerIndex];
+    SpriteBatch &batch = layer.spriteBatches[batchIndex];
+    assert(is_bit_active(layer.spriteBatchActivity, batchIndex) && batch.takenWhole);
 
-    // Update texture unit information.
-    const TexUnit texUnit = batch.slotTexUnits[key.slotIndex];
-    --batch.texUnitInfos[texUnit].refCnt;
+    clear_bits(batch.slotActivity, layer.spriteBatchSlotCnt);
+    batch.activeSlotCnt = 0;
+    unref_sprite_batch_tex_unit(batch, 0, layer.spriteBatchSlotCnt);
 
-    // Clear the slot render data.
-    clear_sprite_batch_slot(renderer, key);
+    retire_sprite_batch(renderer, layer, batchIndex);
 }
 
-void write_to_sprite_batch_slot(Renderer &renderer, const SpriteBatchSlotKey &key, const SpriteBatchSlotWriteData &writeData, const AssetGroupManager &assetGroupManager)
+void set_whole_sprite_batch_active_slot_cnt(Renderer &renderer, const int layerIndex, const int batchIndex, const int cnt)
 {
-    RenderLayer &layer = renderer.layers[key.layerIndex];
-    SpriteBatch &batch = layer.spriteBatches[key.batchIndex];
-    const int texUnit = batch.slotTexUnits[key.slotIndex];
-    const cc::Vec2DInt texSize = assetGroupManager.get_tex_size(batch.texUnitInfos[texUnit].texID);
+    assert(layerIndex >= 0 && layerIndex < renderer.layerCnt);
 
-    float *const verts = batch.quadBufVerts + (key.slotIndex * gk_spriteBatchSlotVertsCnt);
-
-    verts[0] = (0.0f - writeData.origin.x) * writeData.scale.x;
-    verts[1] = (0.0f - writeData.origin.y) * writeData.scale.y;
-    verts[2] = writeData.pos.x;
-    verts[3] = writeData.pos.y;
-    verts[4] = static_cast<float>(writeData.srcRect.width);
-    verts[5] = static_cast<float>(writeData.srcRect.height);
-    verts[6] = writeData.rot;
-    verts[7] = static_cast<float>(texUnit);
-    verts[8] = static_cast<float>(writeData.srcRect.x) / texSize.x;
-    verts[9] = static_cast<float>(writeData.srcRect.y) / texSize.y;
-    verts[10] = writeData.alpha;
-
-    verts[11] = (1.0f - writeData.origin.x) * writeData.scale.x;
-    verts[12] = (0.0f - writeData.origin.y) * writeData.scale.y;
-    verts[13] = writeData.pos.x;
-    verts[14] = writeData.pos.y;
-    verts[15] = static_cast<float>(writeData.srcRect.width);
-    verts[16] = static_cast<float>(writeData.srcRect.height);
-    verts[17] = writeData.rot;
-    verts[18] = static_cast<float>(texUnit);
-    verts[19] = static_cast<float>(writeData.srcRect.x + writeData.srcRect.width) / texSize.x;
-    verts[20] = static_cast<float>(writeData.srcRect.y) / texSize.y;
-    verts[21] = writeData.alpha;
-
-    verts[22] = (1.0f - writeData.origin.x) * writeData.scale.x;
-    verts[23] = (1.0f - writeData.origin.y) * writeData.scale.y;
-    verts[24] = writeData.pos.x;
-    verts[25] = writeData.pos.y;
-    verts[26] = static_cast<float>(writeData.srcRect.width);
-    verts[27] = static_cast<float>(writeData.srcRect.height);
-    verts[28] = writeData.rot;
-    verts[29] = static_cast<float>(texUnit);
-    verts[30] = static_cast<float>(writeData.srcRect.x + writeData.srcRect.width) / texSize.x;
-    verts[31] = static_cast<float>(writeData.srcRect.y + writeData.srcRect.height) / texSize.y;
-    verts[32] = writeData.alpha;
-
-    verts[33] = (0.0f - writeData.origin.x) * writeData.scale.x;
-    verts[34] = (1.0f - writeData.origin.y) * writeData.scale.y;
-    verts[35] = writeData.pos.x;
-    verts[36] = writeData.pos.y;
-    verts[37] = static_cast<float>(writeData.srcRect.width);
-    verts[38] = static_cast<float>(writeData.srcRect.height);
-    verts[39] = writeData.rot;
-    verts[40] = static_cast<float>(texUnit);
-    verts[41] = static_cast<float>(writeData.srcRect.x) / texSize.x;
-    verts[42] = static_cast<float>(writeData.srcRect.y + writeData.srcRect.height) / texSize.y;
-    verts[43] = writeData.alpha;
-
-    batch.modifiedSlotRange.begin = std::min(batch.modifiedSlotRange.begin, key.slotIndex);
-    batch.modifiedSlotRange.end = std::max(batch.modifiedSlotRange.end, key.slotIndex + 1);
-}
+    RenderLayer &layer = renderer.layers[layerIndex];
 
-void clear_sprite_batch_slot(Renderer &renderer, const SpriteBatchSlotKey &key)
-{
-    const RenderLayer &layer = renderer.layers[key.layerIndex];
-    SpriteBatch &batch = layer.spriteBatches[key.batchIndex];
+    assert(is_bit_active(layer.spriteBatchActivity, batchIndex));
+    assert(cnt >= 0 && cnt <= layer.spriteBatchSlotCnt);
 
-    float *const verts = batch.quadBufVerts + (key.slotIndex * gk_spriteBatchSlotVertsCnt);
-    memset(verts, 0, gk_spriteBatchSlotVertsSize);
+    SpriteBatch &batch = layer.spriteBatches[batchIndex];
+    assert(batch.takenWhole);
 
-    batch.modifiedSlotRange.begin = std::min(batch.modifiedSlotRange.begin, key.slotIndex);
-    batch.modifiedSlotRange.end = std::max(batch.modifiedSlotRange.end, key.slotIndex + 1);
+    if (batch.activeSlotCnt != cnt)
+    {
+        batch.activeSlotCnt = cnt;
+        renderer.dirty = true;
+        layer.cache.dirty = true;
+    }
 }
 
-void submit_sprite_batch_slots(Renderer &renderer)
+SpriteQuadVert *get_sprite_batch_slot_verts_for_write(Renderer &renderer, const int layerIndex, const int batchIndex, const int slotBegin, const int slotEnd)
 {
-    for (int i = 0; i < renderer.layerCnt; ++i)
-    {
-        const RenderLayer &layer = renderer.layers[i];
-
-        for (int j = 0; j < layer.spriteBatchCnt; ++j)
-        {
-            SpriteBatch &batch = layer.spriteBatches[j];
+    assert(layerIndex >= 0 && layerIndex < renderer.layerCnt);
 
-            if (!is_bit_active(layer.spriteBatchActivity, j))
-            {
-                continue;
-            }
+    RenderLayer &layer = renderer.layers[layerIndex];
 
-            if (batch.modifiedSlotRange.end - batch.modifiedSlotRange.begin == 0)
-            {
-                // No slots have been modified, so no need to write.
-                continue;
-            }
+    assert(is_bit_active(layer.spriteBatchActivity, batchIndex));
+    assert(slotBegin >= 0 && slotBegin < slotEnd && slotEnd <= layer.spriteBatchSlotCnt);
 
-            // Submit the modified range of vertex data.
-            glBindVertexArray(batch.quadBufGLIDs.vertArrayGLID);
-            glBindBuffer(GL_ARRAY_BUFFER, batch.quadBufGLIDs.vertBufGLID);
+    SpriteBatch &batch = layer.spriteBatches[batchIndex];
+    assert(batch.takenWhole);
 
-            const int offs = gk_spriteBatchSlotVertsSize * batch.modifiedSlotRange.begin;
-            const int size = gk_spriteBatchSlotVertsSize * (batch.modifiedSlotRange.end - batch.modifiedSlotRange.begin);
-            glBufferSubData(GL_ARRAY_BUFFER, offs, size, batch.quadBufVerts);
+    mark_sprite_batch_slots_modified(batch, slotBegin, slotEnd);
 
-            // Reset the modified slot range for next time.
-            batch.modifiedSlotRange = {};
-        }
-    }
+    return batch.quadBufVerts + (slotBegin * gk_spriteBatchSlotVertsCnt);
 }
 
 CharBatchKey activate_any_char_batch(Renderer &renderer, const int layerIndex, const int slotCnt, const AssetID fontID, const cc::Vec2D pos, const AssetGroupManager &assetGroupManager)
 {
     assert(layerIndex >= 0 && layerIndex < renderer.layerCnt);
-    assert(slotCnt > 0);
+    assert(slotCnt > 0 && slotCnt <= CharBatch::sk_slotLimit);
 
     RenderLayer &layer = renderer.layers[layerIndex];
 
-    const int batchIndex = first_inactive_bit_index(layer.charBatchActivity, layer.charBatchCnt);
-    assert(batchIndex != -1);
+    const int batchIndex = first_inactive_bit_index(layer.charBatchActivity, RenderLayer::sk_charBatchLimit);
+
+    if (batchIndex == -1)
+    {
+        assert(false && "The character batch limit of the render layer has been reached!");
+
+        return {
+            .layerIndex = layerIndex,
+            .batchIndex = -1
+        };
+    }
 
     activate_bit(layer.charBatchActivity, batchIndex);
+    layer.charBatchCnt = std::max(layer.charBatchCnt, batchIndex + 1);
 
     CharBatch &batch = layer.charBatches[batchIndex];
 
-    batch.quadBufGLIDs = make_quad_buf(slotCnt, false);
+    if (!batch.glyphHandles)
+    {
+        batch.glyphHandles = cc::push_to_mem_arena<int>(*renderer.permMemArena, CharBatch::sk_slotLimit);
+    }
+
+    batch.quadBuf = make_quad_buf(slotCnt, CHAR_QUAD_VERT_ARENA);
     batch.slotCnt = slotCnt;
+    batch.writtenSlotCnt = 0;
     batch.fontID = fontID;
     batch.pos = pos;
     batch.rot = 0.0f;
@@ -545,8 +2717,13 @@ CharBatchKey activate_any_char_batch(Renderer &renderer, const int layerIndex, c
 void deactivate_char_batch(Renderer &renderer, const CharBatchKey &key)
 {
     RenderLayer &layer = renderer.layers[key.layerIndex];
-    deactivate_bit(layer.charBatchActivity, key.batchIndex);
+    CharBatch &batch = layer.charBatches[key.batchIndex];
+
     clear_char_batch(renderer, key);
+    clean_quad_buf(batch.quadBuf);
+
+    deactivate_bit(layer.charBatchActivity, key.batchIndex);
+    update_render_layer_batch_cnts(layer);
 }
 
 void write_to_char_batch(Renderer &renderer, cc::MemArena &tempMemArena, const CharBatchKey &key, const char *const text, const FontHorAlign horAlign, const FontVerAlign verAlign, const AssetGroupManager &assetGroupManager)
@@ -554,10 +2731,27 @@ void write_to_char_batch(Renderer &renderer, cc::MemArena &tempMemArena, const C
     RenderLayer &layer = renderer.layers[key.layerIndex];
     CharBatch &batch = layer.charBatches[key.batchIndex];
 
-    const int textLen = strlen(text);
-    assert(textLen > 0 && textLen <= batch.slotCnt);
+    // Decode the text and get the glyphs of its characters from the glyph cache, before those of the old text are released so that glyphs shared by both stay cached.
+    const auto textCodepoints = cc::push_to_mem_arena<unsigned int>(tempMemArena, batch.slotCnt);
+    const auto textGlyphHandles = cc::push_to_mem_arena<int>(tempMemArena, batch.slotCnt);
+    int textLen = 0;
+
+    for (const char *textPtr = text; *textPtr; ++textLen)
+    {
+        assert(textLen < batch.slotCnt);
+
+        textCodepoints[textLen] = decode_utf8_char(textPtr);
+        textGlyphHandles[textLen] = textCodepoints[textLen] == '\n' ? -1 : acquire_glyph(batch.fontID, textCodepoints[textLen], assetGroupManager);
+    }
+
+    assert(textLen > 0);
 
-    const cc::FontDisplayInfo &fontDisplayInfo = assetGroupManager.get_font_display_info(batch.fontID);
+    const FT_Face fontFace = assetGroupManager.get_font_face(batch.fontID);
+    const int fontLineHeight = assetGroupManager.get_font_line_height(batch.fontID);
+
+    // The space glyph is used for the dimensions of empty lines.
+    const int spaceGlyphHandle = acquire_glyph(batch.fontID, ' ', assetGroupManager);
+    const GlyphInfo spaceGlyphInfo = spaceGlyphHandle != -1 ? get_glyph_info(spaceGlyphHandle) : GlyphInfo {};
 
     // Determine the positions of text characters based on font information, alongside the overall dimensions of the text to be used when applying alignment.
     const auto charDrawPositions = cc::push_to_mem_arena<cc::Vec2D>(tempMemArena, batch.slotCnt);
@@ -572,19 +2766,19 @@ void write_to_char_batch(Renderer &renderer, cc::MemArena &tempMemArena, const C
 
     for (int i = 0; i < textLen; i++)
     {
-        if (text[i] == '\n')
+        if (textCodepoints[i] == '\n')
         {
             textLineWidths[textLineCnter] = charDrawPosPen.x;
 
             if (!textFirstLineMinOffsUpdated)
             {
                 // Set the first line minimum offset to the vertical offset of the space character.
-                textFirstLineMinOffs = fontDisplayInfo.chars.verOffsets[0];
+                textFirstLineMinOffs = spaceGlyphInfo.verOffs;
                 textFirstLineMinOffsUpdated = true;
             }
 
             // Set the last line maximum height to the height of a space.
-            textLastLineMaxHeight = fontDisplayInfo.chars.verOffsets[0] + fontDisplayInfo.chars.srcRects[0].height;
+            textLastLineMaxHeight = spaceGlyphInfo.verOffs + spaceGlyphInfo.srcRect.height;
 
             textLastLineMaxHeightUpdated = false;
 
@@ -592,48 +2786,57 @@ void write_to_char_batch(Renderer &renderer, cc::MemArena &tempMemArena, const C
 
             // Move the pen to a new line.
             charDrawPosPen.x = 0.0f;
-            charDrawPosPen.y += fontDisplayInfo.lineHeight;
+            charDrawPosPen.y += fontLineHeight;
+
+            continue;
+        }
 
+        // Skip characters whose glyphs could not be had.
+        if (textGlyphHandles[i] == -1)
+        {
+            charDrawPositions[i] = charDrawPosPen;
             continue;
         }
 
-        const int textCharIndex = text[i] - cc::gk_fontCharRangeBegin;
+        const GlyphInfo &glyphInfo = get_glyph_info(textGlyphHandles[i]);
 
         // If we are on the first line, update the first line minimum offset.
         if (textLineCnter == 0)
         {
             if (!textFirstLineMinOffsUpdated)
             {
-                textFirstLineMinOffs = fontDisplayInfo.chars.verOffsets[textCharIndex];
+                textFirstLineMinOffs = glyphInfo.verOffs;
                 textFirstLineMinOffsUpdated = true;
             }
             else
             {
-                textFirstLineMinOffs = std::min(fontDisplayInfo.chars.verOffsets[textCharIndex], textFirstLineMinOffs);
+                textFirstLineMinOffs = std::min(glyphInfo.verOffs, textFirstLineMinOffs);
             }
         }
 
         if (!textLastLineMaxHeightUpdated)
         {
-            textLastLineMaxHeight = fontDisplayInfo.chars.verOffsets[textCharIndex] + fontDisplayInfo.chars.srcRects[textCharIndex].height;
+            textLastLineMaxHeight = glyphInfo.verOffs + glyphInfo.srcRect.height;
             textLastLineMaxHeightUpdated = true;
         }
         else
         {
-            textLastLineMaxHeight = std::max(fontDisplayInfo.chars.verOffsets[textCharIndex] + fontDisplayInfo.chars.srcRects[textCharIndex].height, textLastLineMaxHeight);
+            textLastLineMaxHeight = std::max(glyphInfo.verOffs + glyphInfo.srcRect.height, textLastLineMaxHeight);
         }
 
-        if (i > 0)
+        if (i > 0 && textGlyphHandles[i - 1] != -1 && FT_HAS_KERNING(fontFace))
         {
             // Apply kerning based on the previous character.
-            const int textCharIndexLast = text[i - 1] - cc::gk_fontCharRangeBegin;
-            charDrawPosPen.x += fontDisplayInfo.chars.kernings[(textCharIndex * cc::gk_fontCharRangeSize) + textCharIndexLast];
+            FT_Vector ftKerning;
+            FT_Get_Kerning(fontFace, get_glyph_info(textGlyphHandles[i - 1]).ftIndex, glyphInfo.ftIndex, FT_KERNING_DEFAULT, &ftKerning);
+
+            charDrawPosPen.x += ftKerning.x >> 6;
         }
 
-        charDrawPositions[i].x = charDrawPosPen.x + fontDisplayInfo.chars.horOffsets[textCharIndex];
-        charDrawPositions[i].y = charDrawPosPen.y + fontDisplayInfo.chars.verOffsets[textCharIndex];
+        charDrawPositions[i].x = charDrawPosPen.x + glyphInfo.horOffs;
+        charDrawPositions[i].y = charDrawPosPen.y + glyphInfo.verOffs;
 
-        charDrawPosPen.x += fontDisplayInfo.chars.horAdvances[textCharIndex];
+        charDrawPosPen.x += glyphInfo.horAdvance;
     }
 
     textLineWidths[textLineCnter] = charDrawPosPen.x;
@@ -641,8 +2844,14 @@ void write_to_char_batch(Renderer &renderer, cc::MemArena &tempMemArena, const C
 
     const int textHeight = textFirstLineMinOffs + charDrawPosPen.y + textLastLineMaxHeight;
 
-    // Clear the batch so it can have only the new characters.
+    if (spaceGlyphHandle != -1)
+    {
+        release_glyph(spaceGlyphHandle);
+    }
+
+    // Clear the batch so it can have only the new characters, then have it hold on to the glyphs of these.
     clear_char_batch(renderer, key);
+    memcpy(batch.glyphHandles, textGlyphHandles, textLen * sizeof(textGlyphHandles[0]));
 
     // Reserve memory to hold the vertex data for the characters.
     const int vertsLen = gk_charBatchSlotVertsCnt * textLen;
@@ -652,18 +2861,24 @@ void write_to_char_batch(Renderer &renderer, cc::MemArena &tempMemArena, const C
     // Write the vertex data.
     for (int i = 0; i < textLen; i++)
     {
-        if (text[i] == '\n')
+        if (textCodepoints[i] == '\n')
         {
             textLineCnter++;
             continue;
         }
 
-        if (text[i] == ' ')
+        if (textGlyphHandles[i] == -1)
         {
             continue;
         }
 
-        const int charIndex = text[i] - cc::gk_fontCharRangeBegin;
+        const GlyphInfo &glyphInfo = get_glyph_info(textGlyphHandles[i]);
+
+        // Glyphs with nothing to draw, such as spaces, have no quad.
+        if (!glyphInfo.srcRect.width)
+        {
+            continue;
+        }
 
         const cc::Vec2D charDrawPos = {
             charDrawPositions[i].x - (textLineWidths[textLineCnter] * horAlign * 0.5f),
@@ -671,13 +2886,13 @@ void write_to_char_batch(Renderer &renderer, cc::MemArena &tempMemArena, const C
         };
 
         const cc::Vec2D charTexCoordsTopLeft = {
-            static_cast<float>(fontDisplayInfo.chars.srcRects[charIndex].x) / fontDisplayInfo.texSize.x,
-            static_cast<float>(fontDisplayInfo.chars.srcRects[charIndex].y) / fontDisplayInfo.texSize.y
+            static_cast<float>(glyphInfo.srcRect.x) / gk_glyphAtlasSize.x,
+            static_cast<float>(glyphInfo.srcRect.y) / gk_glyphAtlasSize.y
         };
 
         const cc::Vec2D charTexCoordsBottomRight = {
-            static_cast<float>(fontDisplayInfo.chars.srcRects[charIndex].right() + 1.0f) / fontDisplayInfo.texSize.x, // FIXME: The +1.0f is a hack to fix the text being cut off. Still need to figure out why it's actually happening.
-            static_cast<float>(fontDisplayInfo.chars.srcRects[charIndex].bottom()) / fontDisplayInfo.texSize.y
+            static_cast<float>(glyphInfo.srcRect.right() + 1.0f) / gk_glyphAtlasSize.x, // FIXME: The +1.0f is a hack to fix the text being cut off. Still need to figure out why it's actually happening.
+            static_cast<float>(glyphInfo.srcRect.bottom()) / gk_glyphAtlasSize.y
         };
 
         float *const slotVerts = verts + (i * gk_charBatchSlotVertsCnt);
@@ -687,34 +2902,40 @@ void write_to_char_batch(Renderer &renderer, cc::MemArena &tempMemArena, const C
         slotVerts[2] = charTexCoordsTopLeft.x;
         slotVerts[3] = charTexCoordsTopLeft.y;
 
-        slotVerts[4] = charDrawPos.x + fontDisplayInfo.chars.srcRects[charIndex].width + 1;
+        slotVerts[4] = charDrawPos.x + glyphInfo.srcRect.width + 1;
         slotVerts[5] = charDrawPos.y;
         slotVerts[6] = charTexCoordsBottomRight.x;
         slotVerts[7] = charTexCoordsTopLeft.y;
 
-        slotVerts[8] = charDrawPos.x + fontDisplayInfo.chars.srcRects[charIndex].width + 1;
-        slotVerts[9] = charDrawPos.y + fontDisplayInfo.chars.srcRects[charIndex].height;
+        slotVerts[8] = charDrawPos.x + glyphInfo.srcRect.width + 1;
+        slotVerts[9] = charDrawPos.y + glyphInfo.srcRect.height;
         slotVerts[10] = charTexCoordsBottomRight.x;
         slotVerts[11] = charTexCoordsBottomRight.y;
 
         slotVerts[12] = charDrawPos.x;
-        slotVerts[13] = charDrawPos.y + fontDisplayInfo.chars.srcRects[charIndex].height;
+        slotVerts[13] = charDrawPos.y + glyphInfo.srcRect.height;
         slotVerts[14] = charTexCoordsTopLeft.x;
         slotVerts[15] = charTexCoordsBottomRight.y;
     }
 
     // Submit the vertex data.
-    glBindVertexArray(batch.quadBufGLIDs.vertArrayGLID);
-    glBindBuffer(GL_ARRAY_BUFFER, batch.quadBufGLIDs.vertBufGLID);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, vertsLen * sizeof(verts[0]), verts);
+    glBindBuffer(GL_ARRAY_BUFFER, i_quadVertArenas[CHAR_QUAD_VERT_ARENA].vertBufGLID);
+    glBufferSubData(GL_ARRAY_BUFFER, gk_charBatchSlotVertsSize * batch.quadBuf.quadOffs, vertsLen * sizeof(verts[0]), verts);
+    renderer.frameStats.uploadedByteCnt += vertsLen * sizeof(verts[0]);
+
+    batch.writtenSlotCnt = textLen;
+
+    renderer.dirty = true;
+    layer.cache.dirty = true;
 }
 
-void clear_char_batch(const Renderer &renderer, const CharBatchKey &key)
+void clear_char_batch(Renderer &renderer, const CharBatchKey &key)
 {
-    const RenderLayer &layer = renderer.layers[key.layerIndex];
-    const CharBatch &batch = layer.charBatches[key.batchIndex];
+    RenderLayer &layer = renderer.layers[key.layerIndex];
+
+    // Only the written slots are drawn, so nothing needs to be submitted.
+    release_char_batch_glyphs(layer.charBatches[key.batchIndex]);
 
-    glBindVertexArray(batch.quadBufGLIDs.vertArrayGLID);
-    glBindBuffer(GL_ARRAY_BUFFER, batch.quadBufGLIDs.vertBufGLID);
-    glBufferData(GL_ARRAY_BUFFER, gk_charBatchSlotVertsSize * batch.slotCnt, nullptr, GL_DYNAMIC_DRAW);
+    renderer.dirty = true;
+    layer.cache.dirty = true;
 }
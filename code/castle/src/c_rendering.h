@@ -1,14 +1,33 @@
 #pragma once
 
+#include <string.h>
+#include <algorithm>
 #include <castle_common/cc_math.h>
 #include "c_utils.h"
 #include "c_assets.h"
 #include "c_camera.h"
 
 constexpr int gk_texUnitLimitCap = 32;
+constexpr int gk_camStreamedQuadLimit = 8192;
 
-constexpr int gk_spriteBatchSlotVertsCnt = gk_spriteQuadShaderProgVertCnt * 4;
-constexpr int gk_spriteBatchSlotVertsSize = sizeof(float) * gk_spriteBatchSlotVertsCnt;
+// A vertex of a sprite quad, quantised to keep vertex bandwidth and the copies of batches held for writing small. Must match the vertex attributes of the sprite quad shader program and the reads of the sprite culling compute shader.
+struct SpriteQuadVert
+{
+    cc::Vec2D pos;
+    unsigned short offs[2]; // The offset of the corner from the position before rotation, already scaled by the size, as half floats.
+    unsigned short texCoord[2]; // Normalised to the full range. For a sprite animated on the GPU, its rate in frames per tick followed by its phase as a fraction of the frame count, both also normalised.
+    unsigned short rot; // A half float.
+    unsigned char alpha; // Normalised to the full range. Zero for cleared slots, which culling relies on.
+    unsigned char texUnit;
+    unsigned char palette; // One above the index of the palette to use in place of that of the texture, or zero to use that of the texture.
+    unsigned char anim; // One above the index of the animation the sprite is animated by on the GPU, or zero if it is not animated.
+    unsigned char padding[2];
+};
+
+static_assert(sizeof(SpriteQuadVert) == 24, "The sprite quad vertex must stay packed, with the size the sprite culling compute shader expects.");
+
+constexpr int gk_spriteBatchSlotVertsCnt = 4;
+constexpr int gk_spriteBatchSlotVertsSize = sizeof(SpriteQuadVert) * gk_spriteBatchSlotVertsCnt;
 
 constexpr int gk_charBatchSlotVertsCnt = gk_charQuadShaderProgVertCnt * 4;
 constexpr int gk_charBatchSlotVertsSize = sizeof(float) * gk_charBatchSlotVertsCnt;
@@ -43,11 +62,35 @@ constexpr Color gk_yellow = {1.0f, 1.0f, 0.0f, 1.0f};
 constexpr Color gk_cyan = {0.0f, 1.0f, 1.0f, 1.0f};
 constexpr Color gk_magenta = {1.0f, 0.0f, 1.0f, 1.0f};
 
-struct QuadBufGLIDs
+enum SpriteBatchUsage
+{
+    SPRITE_BATCH_USAGE_DYNAMIC, // For slots rewritten often, such as those of moving entities.
+    SPRITE_BATCH_USAGE_STATIC, // For slots written once and rarely changed, such as those of scenery.
+
+    SPRITE_BATCH_USAGE_CNT
+};
+
+// The vertex arenas quad buffers are sub-allocated from. The sprite arenas come first and are in the same order as the sprite batch usages they serve.
+enum QuadVertArenaID
 {
-    GLID vertArrayGLID;
-    GLID vertBufGLID;
-    GLID elemBufGLID;
+    DYNAMIC_SPRITE_QUAD_VERT_ARENA,
+    STATIC_SPRITE_QUAD_VERT_ARENA,
+    CHAR_QUAD_VERT_ARENA,
+
+    QUAD_VERT_ARENA_CNT
+};
+
+inline QuadVertArenaID get_sprite_quad_vert_arena_id(const SpriteBatchUsage usage)
+{
+    return static_cast<QuadVertArenaID>(usage);
+}
+
+// A range of quads sub-allocated from a vertex arena. All quads are drawn using a single shared index buffer, with the offset of the range given as the base vertex.
+struct QuadBuf
+{
+    QuadVertArenaID arenaID;
+    int quadOffs;
+    int quadCnt;
 };
 
 struct SpriteBatchTexUnitInfo
@@ -56,23 +99,56 @@ struct SpriteBatchTexUnitInfo
     int refCnt; // The number of slots in the batch using this texture unit.
 };
 
+struct SpriteBatchSlotLoc
+{
+    int batchIndex;
+    int slotIndex;
+};
+
 struct SpriteBatch
 {
-    QuadBufGLIDs quadBufGLIDs;
-    float *quadBufVerts; // The vertex data of the batch. The modified range of this buffer is submitted at the end of each frame in a single call.
+    QuadBuf quadBuf;
+    SpriteQuadVert *quadBufVerts; // The vertex data of the batch. The modified range of this buffer is submitted at the end of each frame in a single call.
 
     cc::Byte *slotActivity;
     TexUnit *slotTexUnits;
+    int *slotHandleIndices; // Maps each active slot back to the handle referring to it, so the handle can be updated if the slot is moved. For inactive slots this instead holds the next slot of the free list.
+    int freeSlotIndex; // The head of the free slot list, or -1 if the batch is full.
+
+    // Storage for the handles whose indices fall within the range of this batch. The slot a handle refers to can be in any batch of the layer.
+    SpriteBatchSlotLoc *handleLocs; // For free handles the batch index instead holds the next handle of the free list of the layer.
+    cc::Byte *handleActivity;
+
+    int activeSlotCnt; // For a batch taken whole, the slots from the first that its owner has in use. Only those are drawn.
     cc::Range modifiedSlotRange;
 
     SpriteBatchTexUnitInfo *texUnitInfos;
+    TexUnit *freeTexUnits; // A stack of the texture units with no references.
+    int freeTexUnitCnt;
+
+    bool takenWhole; // Whether the batch was taken in full by a single owner, in which case it has no slot handles and is never compacted.
+
+    // The batch starts with the usage of its layer, but is moved between arenas if it is used otherwise.
+    SpriteBatchUsage usage;
+    int modifiedFrameCnt;
+    int unmodifiedFrameCnt;
+
+    int emptyFrameCnt; // Compaction passes in a row that found the batch with no active slots.
+};
+
+// An entry of the index a layer keeps from textures to the batch they were last given a slot in, letting further slots of the same texture share its texture unit without a search.
+struct SpriteBatchTexHint
+{
+    AssetID texID;
+    int batchIndex; // -1 if unused.
+    TexUnit texUnit;
 };
 
+// A handle to a sprite batch slot. Owners never see the batch and slot indices directly, as these can change when the layer is compacted.
 struct SpriteBatchSlotKey
 {
     int layerIndex;
-    int batchIndex;
-    int slotIndex;
+    int handleIndex;
 };
 
 struct SpriteBatchSlotWriteData
@@ -83,6 +159,7 @@ struct SpriteBatchSlotWriteData
     float rot;
     cc::Vec2D scale;
     float alpha;
+    int palette; // A palette to draw an indexed texture with in place of its own, or -1 to use its own.
 
     static inline SpriteBatchSlotWriteData make(const cc::Vec2D pos, const cc::Rect &srcRect)
     {
@@ -92,20 +169,120 @@ struct SpriteBatchSlotWriteData
             .origin = {0.5f, 0.5f},
             .rot = 0.0f,
             .scale = {1.0f, 1.0f},
-            .alpha = 1.0f
+            .alpha = 1.0f,
+            .palette = -1
         };
     }
 };
 
+// For a slot animated on the GPU, in a layer with the animation feature. The size of the sprite is that of the frames of the animation.
+struct SpriteBatchSlotAnimWriteData
+{
+    cc::Vec2D pos;
+    int animIndex; // As returned by add_sprite_anim.
+    int startTime; // The animation time of the renderer the first frame starts at.
+    float rate; // In frames per tick. Must be above zero and below one.
+    cc::Vec2D origin;
+    float rot;
+    cc::Vec2D scale;
+    float alpha;
+    int palette; // As in SpriteBatchSlotWriteData.
+};
+
+// Returns the bits of the half float nearest the value. Values too small for a normal half float are flushed to zero, and those too large are clamped to the largest.
+inline unsigned short to_half_float(const float val)
+{
+    unsigned int bits;
+    memcpy(&bits, &val, sizeof(bits));
+
+    const unsigned int sign = (bits >> 16) & 0x8000;
+    const int exp = static_cast<int>((bits >> 23) & 0xFF) - 127 + 15;
+
+    if (exp <= 0)
+    {
+        return static_cast<unsigned short>(sign);
+    }
+
+    if (exp >= 31)
+    {
+        return static_cast<unsigned short>(sign | 0x7BFF);
+    }
+
+    // Round the mantissa to nearest, letting any carry roll into the exponent.
+    const unsigned int mag = std::min((static_cast<unsigned int>(exp) << 10) + (((bits & 0x7FFFFF) + 0x1000) >> 13), 0x7BFFu);
+    return static_cast<unsigned short>(sign | mag);
+}
+
+// Values are clamped to between zero and one.
+inline unsigned short to_unorm_16(const float val)
+{
+    return static_cast<unsigned short>((std::clamp(val, 0.0f, 1.0f) * 65535.0f) + 0.5f);
+}
+
+inline unsigned char to_unorm_8(const float val)
+{
+    return static_cast<unsigned char>((std::clamp(val, 0.0f, 1.0f) * 255.0f) + 0.5f);
+}
+
+// Writes the vertex data of a single sprite quad. Shared by the slot writer and by owners which write many quads in bulk.
+// The components of features left out are written as neutral values, so that culling, which reads every component, agrees with the shader variant that ignores them.
+// For a sprite animated on the GPU, the texture coordinates are instead its rate and phase as described in SpriteQuadVert.
+template<SpriteFeatures tk_features = gk_allSpriteFeatures>
+inline void write_sprite_quad_verts(SpriteQuadVert *const verts, const cc::Vec2D pos, const cc::Vec2D size, const cc::Vec2D origin, const cc::Vec2D scale, const float rotIn, const TexUnit texUnit, const cc::Vec2D texCoordsTopLeft, const cc::Vec2D texCoordsBottomRight, const float alphaIn, const int palette = -1, const int anim = -1)
+{
+    assert(texUnit >= 0 && texUnit < gk_texUnitLimitCap);
+    assert(palette >= -1 && palette < gk_texPaletteLimit);
+    assert(anim >= -1 && anim < gk_spriteAnimLimit);
+
+    const unsigned short left = to_half_float((0.0f - origin.x) * scale.x * size.x);
+    const unsigned short right = to_half_float((1.0f - origin.x) * scale.x * size.x);
+    const unsigned short top = to_half_float((0.0f - origin.y) * scale.y * size.y);
+    const unsigned short bottom = to_half_float((1.0f - origin.y) * scale.y * size.y);
+
+    const unsigned short texCoordLeft = to_unorm_16(texCoordsTopLeft.x);
+    const unsigned short texCoordRight = to_unorm_16(texCoordsBottomRight.x);
+    const unsigned short texCoordTop = to_unorm_16(texCoordsTopLeft.y);
+    const unsigned short texCoordBottom = to_unorm_16(texCoordsBottomRight.y);
+
+    // Start from the top left corner, then change only the components which differ for each of the others.
+    SpriteQuadVert vert = {
+        .pos = pos,
+        .offs = {left, top},
+        .texCoord = {texCoordLeft, texCoordTop},
+        .rot = (tk_features & SPRITE_FEATURE_ROT_BIT) ? to_half_float(rotIn) : static_cast<unsigned short>(0),
+        .alpha = (tk_features & SPRITE_FEATURE_ALPHA_BIT) ? to_unorm_8(alphaIn) : static_cast<unsigned char>(255),
+        .texUnit = static_cast<unsigned char>(texUnit),
+        .palette = static_cast<unsigned char>(palette + 1),
+        .anim = static_cast<unsigned char>(anim + 1),
+        .padding = {0, 0}
+    };
+
+    verts[0] = vert;
+
+    vert.offs[0] = right;
+    vert.texCoord[0] = texCoordRight;
+    verts[1] = vert;
+
+    vert.offs[1] = bottom;
+    vert.texCoord[1] = texCoordBottom;
+    verts[2] = vert;
+
+    vert.offs[0] = left;
+    vert.texCoord[0] = texCoordLeft;
+    verts[3] = vert;
+}
+
 struct CharBatch
 {
     static constexpr int sk_slotLimit = 1024;
 
-    QuadBufGLIDs quadBufGLIDs;
+    QuadBuf quadBuf;
 
     int slotCnt;
+    int writtenSlotCnt; // The number of slots written to last, which is all that needs to be drawn.
 
     AssetID fontID;
+    int *glyphHandles; // The glyph cache handles of the written slots, -1 for those without one, keeping their glyphs in the atlas. Room for the slot limit, allocated the first time the batch is activated.
 
     cc::Vec2D pos;
     float rot;
@@ -118,57 +295,197 @@ struct CharBatchKey
     int batchIndex;
 };
 
+// An offscreen texture a cached layer is drawn into. It is drawn in place of the layer, moved along with the view, until the layer changes or the view moves further than the margin drawn around it.
+struct RenderLayerCache
+{
+    GLID fbGLID;
+    GLID colorTexGLID;
+    cc::Vec2DInt size;
+    int pxScale; // The units of the view covered by each pixel of the texture, matching the target the layer is drawn onto.
+    int margin; // In units of the view, around each side. Zero for layers drawn with a view that never moves.
+    cc::Matrix4x4 viewMat; // The view the layer was drawn with.
+    bool dirty; // Whether the layer has changed since it was drawn.
+};
+
 // A render layer is fundamentally a set of sprite batches and character batches.
 // The implication of drawing things on the same layer is that you don't care about the order in which those things are drawn.
 // Note however that the character batches in a layer are always drawn after (and therefore in front of) the sprite batches.
+// Sprites in opaque layers are drawn before everything else, alpha tested and front to back, so that what they cover is not shaded. Their sprite alpha is not blended.
+// Layers grow on demand, activating batches as they are needed and retiring them once they are empty, up to the batch limits.
+// Cached layers are drawn into an offscreen texture only when they change, then drawn as a single quad. Their sprites are blended rather than drawn in the depth pass, whether or not they are opaque.
 struct RenderLayer
 {
+    static constexpr int sk_spriteBatchLimit = 128;
     static constexpr int sk_spriteBatchSlotLimit = 2048;
+    static constexpr int sk_charBatchLimit = 32;
+    static constexpr int sk_spriteBatchTexHintCnt = 64; // Must be a power of two.
 
-    SpriteBatch *spriteBatches;
-    int spriteBatchCnt;
+    SpriteBatch *spriteBatches; // Room for the batch limit, though the memory of a batch is only allocated the first time it is needed.
+    int spriteBatchCnt; // One past the index of the last active batch.
+    int spriteBatchMemCnt; // The number of batches, from the first, whose memory has been allocated.
     int spriteBatchSlotCnt; // All sprite batches in the same layer have the same slot count.
+    SpriteBatchUsage spriteBatchUsage; // The usage sprite batches of this layer start with.
+    bool opaqueSprites; // Whether the sprites of this layer are fully opaque wherever they are not fully transparent, letting them be drawn front to back in the depth pass.
+    SpriteFeatures spriteFeatures; // Determines the shader variant the sprites of this layer are drawn with.
+    int spriteAnimFrameChangeTime; // The next animation time at which a sprite animated on the GPU could change frame, and so the layer be redrawn. INT_MAX if none could.
     cc::Byte *spriteBatchActivity;
+    cc::Byte *spriteBatchOpenness; // Batches with both a free slot and a free texture unit, so that they can take a slot of any texture.
+    SpriteBatchTexHint *spriteBatchTexHints; // Hashed by texture. These are only hints, checked before use, so colliding textures simply overwrite each other.
+    int spriteBatchFreeHandleIndex; // The head of the free handle list, or -1 if every handle of the allocated batches is in use.
+    bool spriteBatchCompactionStalled; // Set when compaction finds a slot it cannot move, and cleared when a slot of the layer is released, as only that can make room.
 
     CharBatch *charBatches;
-    int charBatchCnt;
+    int charBatchCnt; // One past the index of the last active batch.
     cc::Byte *charBatchActivity;
+
+    bool cached;
+    RenderLayerCache cache; // Only created for cached layers, when they are first drawn.
 };
 
 struct RenderLayerInitInfo
 {
-    int spriteBatchCnt;
     int spriteBatchSlotCnt;
-    int charBatchCnt;
+    SpriteBatchUsage spriteBatchUsage;
+    bool opaqueSprites;
+    SpriteFeatures spriteFeatures;
+    bool cached; // For layers which rarely change. Every redraw of the cache costs a full-view fill on top of drawing the layer, so only worth it if the layer cache draw count of the render stats stays well below the frame count.
 };
 
 using RenderLayerInitInfoFactory = RenderLayerInitInfo(*)(const int index);
 
+// Why a sprite batch was activated, or why a slot was given outside the batches its texture already has a texture unit in. Each costs the sprites involved the chance of sharing a draw.
+enum SpriteBatchBreakReason
+{
+    SPRITE_BATCH_BREAK_FIRST_IN_LAYER, // The layer had no active batch, and batches are never shared between layers.
+    SPRITE_BATCH_BREAK_TEX_UNITS_EXHAUSTED, // Batches had free slots, but none had a free texture unit.
+    SPRITE_BATCH_BREAK_SLOTS_FULL, // Every batch of the layer was full.
+    SPRITE_BATCH_BREAK_TAKEN_WHOLE, // The batch was taken whole by a single owner.
+    SPRITE_BATCH_BREAK_TEX_BATCHES_FULL, // Every batch the texture has a unit in was full.
+
+    SPRITE_BATCH_BREAK_REASON_CNT
+};
+
+struct SpriteBatchBreak
+{
+    SpriteBatchBreakReason reason;
+    int layerIndex;
+    int batchIndex; // The batch the slot or batch was taken from.
+    AssetID texID;
+};
+
+// Counts of what the renderer did over a single frame.
+struct RenderStats
+{
+    int drawCallCnt;
+    int texBindCnt;
+    int progSwitchCnt;
+    int activeQuadCnt; // Quads in use by sprite slots and written characters.
+    int drawnQuadCnt; // Quads actually submitted for drawing, including those of unused slots in drawn batches.
+    int uploadedByteCnt; // Vertex data uploaded by sprite batch submission and character batch writes.
+    int liveGLObjCnt; // Buffers and vertex arrays owned by the rendering internals.
+    int layerCacheDrawCnt; // Cached layers drawn into their caches.
+};
+
+// A vertex of geometry written afresh for every frame it is drawn in, with a colour of its own. Negative texture coordinates mark it as untextured, otherwise the glyph atlas is sampled for coverage.
+struct StreamedVert
+{
+    cc::Vec2D pos;
+    cc::Vec2D texCoord;
+    Color color;
+};
+
+// Geometry held client-side and uploaded each time it is drawn into orphaned storage of a vertex buffer shared by every such batch, so that drawing never waits on the draws of the previous frame and nothing coming or going creates GL objects.
+struct StreamedVertBatch
+{
+    StreamedVert *verts;
+    int vertLimit;
+    int vertCnt;
+    GLenum drawMode; // GL_LINES, or GL_TRIANGLES with each quad as two separate triangles so that no element buffer is needed.
+    bool changed; // Whether vertices have been added or cleared since the batch was last drawn.
+};
+
 struct Renderer
 {
     int layerCnt;
     int camLayerCnt; // Layers 0 through to this number exclusive are drawn with a camera view matrix.
 
     RenderLayer *layers;
+
+    cc::MemArena *permMemArena; // Used to allocate the memory of batches as layers grow.
+
+    int compactionLayerIndex; // The layer the incremental compaction pass will resume from.
+
+    bool dirty; // Whether anything drawn has changed since the last render.
+    int spriteAnimTime; // In ticks. Sprites animated on the GPU pick their frame from this, so advancing it costs no vertex writes.
+    cc::Matrix4x4 camViewMatLast; // The camera view of the last render, for detecting camera moves and scale changes.
+
+    StreamedVertBatch camStreamedQuads; // Drawn over the camera layers, in world space. Its owners clear and rewrite it every tick.
+
+    int lowResScale; // Camera layers are drawn at the window resolution divided by this, then scaled back up with nearest-neighbour filtering. At one they are drawn directly.
+    int lowResScaleCooldown;
+    double camLayerGPUDur; // The GPU time taken to draw the camera layers, as last measured, in seconds.
+    bool camLayerGPUTiming; // Whether the GPU time of the camera layers is measured. Only dynamic scaling needs it, so it is turned on the first time that adapts the scale.
+
+    RenderStats frameStats; // Accumulated over the frame in progress.
+    RenderStats lastFrameStats;
 };
 
 void init_rendering_internals();
+void clean_rendering_internals();
+bool set_gpu_sprite_culling(const bool enabled); // Switches between culling sprites with a compute shader and drawing every sprite batch in full. Returns false if compute shaders are unsupported.
+int add_sprite_anim(const AssetID texID, const cc::Rect *const frameSrcRects, const int frameCnt, const AssetGroupManager &assetGroupManager); // Uploads the frames of an animation for sprites to be animated with on the GPU. Every frame must be the same size. Returns -1 if the animation or frame limit has been reached.
 
-QuadBufGLIDs make_quad_buf(const int quadCnt, const bool isSprite);
-void clean_quad_buf(QuadBufGLIDs &glIDs);
+QuadBuf make_quad_buf(const int quadCnt, const QuadVertArenaID arenaID);
+void clean_quad_buf(QuadBuf &buf);
 
 void init_renderer(Renderer &renderer, cc::MemArena &permMemArena, const int layerCnt, const int camLayerCnt, const RenderLayerInitInfoFactory layerInitInfoFactory);
 void clean_renderer(Renderer &renderer);
 
-void render(const Renderer &renderer, const Color &bgColor, const AssetGroupManager &assetGroupManager, const ShaderProgs &shaderProgs, const Camera *const cam);
+void set_low_res_scale(Renderer &renderer, const int scale);
+void adapt_low_res_scale(Renderer &renderer, const double gpuBudget, const int scaleMax); // Raises the low resolution scale when drawing the camera layers takes longer than the budget, and lowers it again once there is room.
+bool is_render_needed(const Renderer &renderer, const Camera *const cam);
+void render(Renderer &renderer, const Color &bgColor, const AssetGroupManager &assetGroupManager, const ShaderProgs &shaderProgs, const Camera *const cam);
 
-SpriteBatchSlotKey take_any_sprite_batch_slot(Renderer &renderer, const int layerIndex, const AssetID texID);
+bool take_any_sprite_batch_slot(Renderer &renderer, const int layerIndex, const AssetID texID, SpriteBatchSlotKey &key); // Returns false if the layer is at its batch limit, in which case the key is left with a handle index of -1.
+int take_sprite_batch_slots(Renderer &renderer, const int layerIndex, const AssetID texID, SpriteBatchSlotKey *const keys, const int cnt); // Takes the slots a batch at a time. Returns how many were taken, which is fewer than requested only if the layer reached its batch limit, with the remaining keys given a handle index of -1.
 void release_sprite_batch_slot(Renderer &renderer, const SpriteBatchSlotKey &key);
 void write_to_sprite_batch_slot(Renderer &renderer, const SpriteBatchSlotKey &key, const SpriteBatchSlotWriteData &writeData, const AssetGroupManager &assetGroupManager);
+void write_anim_to_sprite_batch_slot(Renderer &renderer, const SpriteBatchSlotKey &key, const SpriteBatchSlotAnimWriteData &writeData, const AssetGroupManager &assetGroupManager); // The slot must have been taken with the texture of the animation.
 void clear_sprite_batch_slot(Renderer &renderer, const SpriteBatchSlotKey &key);
 void submit_sprite_batch_slots(Renderer &renderer);
+void compact_sprite_batches(Renderer &renderer, const double timeBudget);
+void advance_sprite_anim_time(Renderer &renderer); // Called once per tick.
+
+inline void mark_renderer_dirty(Renderer &renderer) // For changes made directly to batch state, such as character batch positions, and for anything else affecting the whole frame, like window resizes.
+{
+    renderer.dirty = true;
+
+    // Any layer could have changed.
+    for (int i = 0; i < renderer.layerCnt; ++i)
+    {
+        renderer.layers[i].cache.dirty = true;
+    }
+}
+
+const RenderStats &get_render_stats(const Renderer &renderer); // Returns the statistics of the last rendered frame.
+void log_render_stats(const RenderStats &stats);
+
+void init_streamed_vert_batch(StreamedVertBatch &batch, StreamedVert *const verts, const int vertLimit, const GLenum drawMode);
+bool add_streamed_line(StreamedVertBatch &batch, const cc::Vec2D a, const cc::Vec2D b, const Color &color); // The batch must draw lines. Returns false if it is full.
+bool add_streamed_quad(StreamedVertBatch &batch, const cc::Vec2D topLeft, const cc::Vec2D bottomRight, const cc::Vec2D texCoordsTopLeft, const cc::Vec2D texCoordsBottomRight, const Color &color); // The batch must draw triangles. Returns false if it is full.
+void clear_streamed_vert_batch(StreamedVertBatch &batch);
+void draw_streamed_vert_batch(StreamedVertBatch &batch, const ShaderProgs &shaderProgs, const cc::Matrix4x4 &projMat, const cc::Matrix4x4 &viewMat, RenderStats &stats);
+
+void set_sprite_batch_break_recording(const bool enabled); // Off by default, since finding the reason for a break searches the batches of the layer.
+void clear_sprite_batch_breaks();
+void log_sprite_batch_break_report(const int texLimit); // Logs the break counts of each reason, the textures with the most breaks, and the latest breaks, all since the breaks were last cleared.
+
+int take_whole_sprite_batch(Renderer &renderer, const int layerIndex, const AssetID texID);
+void release_whole_sprite_batch(Renderer &renderer, const int layerIndex, const int batchIndex);
+void set_whole_sprite_batch_active_slot_cnt(Renderer &renderer, const int layerIndex, const int batchIndex, const int cnt); // Slots from the count on are left undrawn. All are active when the batch is taken.
+SpriteQuadVert *get_sprite_batch_slot_verts_for_write(Renderer &renderer, const int layerIndex, const int batchIndex, const int slotBegin, const int slotEnd);
 
 CharBatchKey activate_any_char_batch(Renderer &renderer, const int layerIndex, const int slotCnt, const AssetID fontID, const cc::Vec2D pos, const AssetGroupManager &assetGroupManager);
 void deactivate_char_batch(Renderer &renderer, const CharBatchKey &key);
 void write_to_char_batch(Renderer &renderer, cc::MemArena &tempMemArena, const CharBatchKey &key, const char *const text, const FontHorAlign horAlign, const FontVerAlign verAlign, const AssetGroupManager &assetGroupManager);
-void clear_char_batch(const Renderer &renderer, const CharBatchKey &key);
+void clear_char_batch(Renderer &renderer, const CharBatchKey &key);
@@ -0,0 +1,231 @@
+#include "c_transforms.h"
+
+#include <math.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define TRANSFORMS_USE_SSE
+#endif
+
+static_assert(gk_transformSIMDWidth == 4, "The SIMD kernels assume 4-wide float vectors.");
+
+static constexpr int ik_levelNodeAlignment = 8; // A multiple of the SIMD width, so kernels can process levels in whole chunks, and of the bits in a byte, so the activity of each level starts on a whole byte.
+
+static_assert(ik_levelNodeAlignment % gk_transformSIMDWidth == 0, "Levels must be aligned to the SIMD width.");
+
+static inline int round_up_to_level_node_alignment(const int cnt)
+{
+    return (cnt + ik_levelNodeAlignment - 1) & ~(ik_levelNodeAlignment - 1);
+}
+
+static int get_transform_level(const TransformHierarchy &hierarchy, const int index)
+{
+    assert(index >= 0 && index < hierarchy.nodeCnt);
+
+    int level = 0;
+
+    while (index >= hierarchy.levelBegins[level + 1])
+    {
+        ++level;
+    }
+
+    return level;
+}
+
+static void resolve_root_transforms(TransformHierarchy &hierarchy)
+{
+    const int end = hierarchy.levelBegins[1];
+
+    memcpy(hierarchy.worldPosXs, hierarchy.localPosXs, sizeof(float) * end);
+    memcpy(hierarchy.worldPosYs, hierarchy.localPosYs, sizeof(float) * end);
+    memcpy(hierarchy.worldRots, hierarchy.localRots, sizeof(float) * end);
+    memcpy(hierarchy.worldRotCoss, hierarchy.localRotCoss, sizeof(float) * end);
+    memcpy(hierarchy.worldRotSins, hierarchy.localRotSins, sizeof(float) * end);
+    memcpy(hierarchy.worldScaleXs, hierarchy.localScaleXs, sizeof(float) * end);
+    memcpy(hierarchy.worldScaleYs, hierarchy.localScaleYs, sizeof(float) * end);
+}
+
+// Resolves the nodes of a level below the first from their parents, which have already been resolved. The local position is scaled and rotated by the parent, and the rotations are combined through the angle sum identities, which hold as well for the negated sines.
+// Inactive nodes are resolved too, from whatever they hold, which is harmless as they are never read.
+static void resolve_child_transforms(TransformHierarchy &hierarchy, const int level)
+{
+    assert(level > 0);
+
+    const int begin = hierarchy.levelBegins[level];
+    const int end = hierarchy.levelBegins[level + 1];
+
+#ifdef TRANSFORMS_USE_SSE
+    for (int i = begin; i < end; i += gk_transformSIMDWidth)
+    {
+        const int *const parents = hierarchy.parentIndices + i;
+
+        const auto gather = [parents](const float *const vals)
+        {
+            return _mm_set_ps(vals[parents[3]], vals[parents[2]], vals[parents[1]], vals[parents[0]]);
+        };
+
+        const __m128 parentPosXs = gather(hierarchy.worldPosXs);
+        const __m128 parentPosYs = gather(hierarchy.worldPosYs);
+        const __m128 parentRots = gather(hierarchy.worldRots);
+        const __m128 parentRotCoss = gather(hierarchy.worldRotCoss);
+        const __m128 parentRotSins = gather(hierarchy.worldRotSins);
+        const __m128 parentScaleXs = gather(hierarchy.worldScaleXs);
+        const __m128 parentScaleYs = gather(hierarchy.worldScaleYs);
+
+        const __m128 localRotCoss = _mm_loadu_ps(hierarchy.localRotCoss + i);
+        const __m128 localRotSins = _mm_loadu_ps(hierarchy.localRotSins + i);
+
+        const __m128 scaledXs = _mm_mul_ps(_mm_loadu_ps(hierarchy.localPosXs + i), parentScaleXs);
+        const __m128 scaledYs = _mm_mul_ps(_mm_loadu_ps(hierarchy.localPosYs + i), parentScaleYs);
+
+        _mm_storeu_ps(hierarchy.worldPosXs + i, _mm_add_ps(parentPosXs, _mm_sub_ps(_mm_mul_ps(scaledXs, parentRotCoss), _mm_mul_ps(scaledYs, parentRotSins))));
+        _mm_storeu_ps(hierarchy.worldPosYs + i, _mm_add_ps(parentPosYs, _mm_add_ps(_mm_mul_ps(scaledXs, parentRotSins), _mm_mul_ps(scaledYs, parentRotCoss))));
+        _mm_storeu_ps(hierarchy.worldRots + i, _mm_add_ps(parentRots, _mm_loadu_ps(hierarchy.localRots + i)));
+        _mm_storeu_ps(hierarchy.worldRotCoss + i, _mm_sub_ps(_mm_mul_ps(parentRotCoss, localRotCoss), _mm_mul_ps(parentRotSins, localRotSins)));
+        _mm_storeu_ps(hierarchy.worldRotSins + i, _mm_add_ps(_mm_mul_ps(parentRotSins, localRotCoss), _mm_mul_ps(parentRotCoss, localRotSins)));
+        _mm_storeu_ps(hierarchy.worldScaleXs + i, _mm_mul_ps(parentScaleXs, _mm_loadu_ps(hierarchy.localScaleXs + i)));
+        _mm_storeu_ps(hierarchy.worldScaleYs + i, _mm_mul_ps(parentScaleYs, _mm_loadu_ps(hierarchy.localScaleYs + i)));
+    }
+#else
+    for (int i = begin; i < end; ++i)
+    {
+        const int parent = hierarchy.parentIndices[i];
+
+        const float scaledX = hierarchy.localPosXs[i] * hierarchy.worldScaleXs[parent];
+        const float scaledY = hierarchy.localPosYs[i] * hierarchy.worldScaleYs[parent];
+
+        hierarchy.worldPosXs[i] = hierarchy.worldPosXs[parent] + (scaledX * hierarchy.worldRotCoss[parent]) - (scaledY * hierarchy.worldRotSins[parent]);
+        hierarchy.worldPosYs[i] = hierarchy.worldPosYs[parent] + (scaledX * hierarchy.worldRotSins[parent]) + (scaledY * hierarchy.worldRotCoss[parent]);
+        hierarchy.worldRots[i] = hierarchy.worldRots[parent] + hierarchy.localRots[i];
+        hierarchy.worldRotCoss[i] = (hierarchy.worldRotCoss[parent] * hierarchy.localRotCoss[i]) - (hierarchy.worldRotSins[parent] * hierarchy.localRotSins[i]);
+        hierarchy.worldRotSins[i] = (hierarchy.worldRotSins[parent] * hierarchy.localRotCoss[i]) + (hierarchy.worldRotCoss[parent] * hierarchy.localRotSins[i]);
+        hierarchy.worldScaleXs[i] = hierarchy.worldScaleXs[parent] * hierarchy.localScaleXs[i];
+        hierarchy.worldScaleYs[i] = hierarchy.worldScaleYs[parent] * hierarchy.localScaleYs[i];
+    }
+#endif
+}
+
+void init_transform_hierarchy(TransformHierarchy &hierarchy, cc::MemArena &permMemArena, const int *const levelNodeLimits, const int levelCnt)
+{
+    assert(levelCnt > 0 && levelCnt <= gk_transformLevelLimit);
+
+    hierarchy = {};
+    hierarchy.levelCnt = levelCnt;
+
+    for (int i = 0; i < levelCnt; ++i)
+    {
+        assert(levelNodeLimits[i] > 0);
+        hierarchy.levelBegins[i + 1] = hierarchy.levelBegins[i] + round_up_to_level_node_alignment(levelNodeLimits[i]);
+    }
+
+    // Levels past the last are empty, so that level lookups stop at the last.
+    for (int i = levelCnt + 1; i <= gk_transformLevelLimit; ++i)
+    {
+        hierarchy.levelBegins[i] = hierarchy.levelBegins[levelCnt];
+    }
+
+    const int nodeCnt = hierarchy.levelBegins[levelCnt];
+    hierarchy.nodeCnt = nodeCnt;
+
+    hierarchy.activity = cc::push_to_mem_arena<cc::Byte>(permMemArena, bits_to_bytes(nodeCnt));
+    hierarchy.parentIndices = cc::push_to_mem_arena<int>(permMemArena, nodeCnt); // Zero, the first root, until set, so inactive nodes always gather from a valid parent.
+
+    hierarchy.localPosXs = cc::push_to_mem_arena<float>(permMemArena, nodeCnt);
+    hierarchy.localPosYs = cc::push_to_mem_arena<float>(permMemArena, nodeCnt);
+    hierarchy.localRots = cc::push_to_mem_arena<float>(permMemArena, nodeCnt);
+    hierarchy.localRotCoss = cc::push_to_mem_arena<float>(permMemArena, nodeCnt);
+    hierarchy.localRotSins = cc::push_to_mem_arena<float>(permMemArena, nodeCnt);
+    hierarchy.localScaleXs = cc::push_to_mem_arena<float>(permMemArena, nodeCnt);
+    hierarchy.localScaleYs = cc::push_to_mem_arena<float>(permMemArena, nodeCnt);
+
+    hierarchy.worldPosXs = cc::push_to_mem_arena<float>(permMemArena, nodeCnt);
+    hierarchy.worldPosYs = cc::push_to_mem_arena<float>(permMemArena, nodeCnt);
+    hierarchy.worldRots = cc::push_to_mem_arena<float>(permMemArena, nodeCnt);
+    hierarchy.worldRotCoss = cc::push_to_mem_arena<float>(permMemArena, nodeCnt);
+    hierarchy.worldRotSins = cc::push_to_mem_arena<float>(permMemArena, nodeCnt);
+    hierarchy.worldScaleXs = cc::push_to_mem_arena<float>(permMemArena, nodeCnt);
+    hierarchy.worldScaleYs = cc::push_to_mem_arena<float>(permMemArena, nodeCnt);
+}
+
+int add_transform(TransformHierarchy &hierarchy, const int parentIndex, const cc::Vec2D localPos, const float localRot)
+{
+    assert(parentIndex == -1 || is_bit_active(hierarchy.activity, parentIndex));
+
+    const int level = parentIndex == -1 ? 0 : get_transform_level(hierarchy, parentIndex) + 1;
+    assert(level < hierarchy.levelCnt && "The transform hierarchy is not deep enough for a child of the given parent!");
+
+    const int levelBegin = hierarchy.levelBegins[level];
+    const int levelInactiveIndex = first_inactive_bit_index(hierarchy.activity + (levelBegin / 8), hierarchy.levelBegins[level + 1] - levelBegin);
+
+    if (levelInactiveIndex == -1)
+    {
+        return -1;
+    }
+
+    const int index = levelBegin + levelInactiveIndex;
+
+    activate_bit(hierarchy.activity, index);
+
+    hierarchy.parentIndices[index] = parentIndex == -1 ? 0 : parentIndex;
+    hierarchy.localScaleXs[index] = 1.0f;
+    hierarchy.localScaleYs[index] = 1.0f;
+
+    set_transform_local_pos(hierarchy, index, localPos);
+    set_transform_local_rot(hierarchy, index, localRot);
+
+    return index;
+}
+
+void remove_transform(TransformHierarchy &hierarchy, const int index)
+{
+    assert(is_bit_active(hierarchy.activity, index));
+
+#ifndef NDEBUG
+    const int level = get_transform_level(hierarchy, index);
+
+    if (level + 1 < hierarchy.levelCnt)
+    {
+        for (int i = hierarchy.levelBegins[level + 1]; i < hierarchy.levelBegins[level + 2]; ++i)
+        {
+            assert((!is_bit_active(hierarchy.activity, i) || hierarchy.parentIndices[i] != index) && "A transform cannot be removed while it has children!");
+        }
+    }
+#endif
+
+    deactivate_bit(hierarchy.activity, index);
+}
+
+void update_transforms(TransformHierarchy &hierarchy)
+{
+    resolve_root_transforms(hierarchy);
+
+    for (int i = 1; i < hierarchy.levelCnt; ++i)
+    {
+        resolve_child_transforms(hierarchy, i);
+    }
+}
+
+void set_transform_local_pos(TransformHierarchy &hierarchy, const int index, const cc::Vec2D pos)
+{
+    assert(is_bit_active(hierarchy.activity, index));
+
+    hierarchy.localPosXs[index] = pos.x;
+    hierarchy.localPosYs[index] = pos.y;
+}
+
+void set_transform_local_rot(TransformHierarchy &hierarchy, const int index, const float rot)
+{
+    assert(is_bit_active(hierarchy.activity, index));
+
+    hierarchy.localRots[index] = rot;
+    hierarchy.localRotCoss[index] = cosf(rot);
+    hierarchy.localRotSins[index] = -sinf(rot);
+}
+
+void set_transform_local_scale(TransformHierarchy &hierarchy, const int index, const cc::Vec2D scale)
+{
+    assert(is_bit_active(hierarchy.activity, index));
+
+    hierarchy.localScaleXs[index] = scale.x;
+    hierarchy.localScaleYs[index] = scale.y;
+}
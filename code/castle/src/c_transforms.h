@@ -0,0 +1,64 @@
+// A hierarchy of transforms for things attached to other things, such as weapons to the entities holding them. Transforms are stored as structure-of-arrays, grouped into levels by depth, so every node comes after its parent.
+// Each level only depends on the one above it, so world transforms are resolved in one linear sweep, several nodes at a time with SIMD, with no per-node branching or recursion.
+
+#pragma once
+
+#include <castle_common/cc_math.h>
+#include <castle_common/cc_mem.h>
+#include "c_utils.h"
+
+constexpr int gk_transformSIMDWidth = 4;
+constexpr int gk_transformLevelLimit = 4;
+
+struct TransformHierarchy
+{
+    int levelCnt;
+    int levelBegins[gk_transformLevelLimit + 1]; // The nodes of a level lie from its begin up to the begin of the next.
+    int nodeCnt; // Including inactive nodes.
+
+    cc::Byte *activity;
+    int *parentIndices; // Those of the first level are unused.
+
+    // Relative to the parent. The cosine and sine of the rotation are kept alongside it so that the sweep needs no trigonometry. The sine is negated, matching the direction sprites are rotated in, as with cc::make_dir_vec_2d.
+    float *localPosXs;
+    float *localPosYs;
+    float *localRots;
+    float *localRotCoss;
+    float *localRotSins;
+    float *localScaleXs;
+    float *localScaleYs;
+
+    // Resolved by the sweep.
+    float *worldPosXs;
+    float *worldPosYs;
+    float *worldRots;
+    float *worldRotCoss;
+    float *worldRotSins;
+    float *worldScaleXs;
+    float *worldScaleYs;
+};
+
+// The node limits are given per level, from the roots down.
+void init_transform_hierarchy(TransformHierarchy &hierarchy, cc::MemArena &permMemArena, const int *const levelNodeLimits, const int levelCnt);
+int add_transform(TransformHierarchy &hierarchy, const int parentIndex, const cc::Vec2D localPos, const float localRot); // A parent index of -1 adds a root. Returns -1 if the level is full.
+void remove_transform(TransformHierarchy &hierarchy, const int index); // The children of the node must have been removed first.
+void update_transforms(TransformHierarchy &hierarchy); // Resolves the world transforms of every node from the local ones.
+
+void set_transform_local_pos(TransformHierarchy &hierarchy, const int index, const cc::Vec2D pos);
+void set_transform_local_rot(TransformHierarchy &hierarchy, const int index, const float rot);
+void set_transform_local_scale(TransformHierarchy &hierarchy, const int index, const cc::Vec2D scale);
+
+inline cc::Vec2D get_transform_world_pos(const TransformHierarchy &hierarchy, const int index)
+{
+    return {hierarchy.worldPosXs[index], hierarchy.worldPosYs[index]};
+}
+
+inline float get_transform_world_rot(const TransformHierarchy &hierarchy, const int index)
+{
+    return hierarchy.worldRots[index];
+}
+
+inline cc::Vec2D get_transform_world_scale(const TransformHierarchy &hierarchy, const int index)
+{
+    return {hierarchy.worldScaleXs[index], hierarchy.worldScaleYs[index]};
+}
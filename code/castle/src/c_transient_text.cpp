@@ -0,0 +1,164 @@
+#include "c_transient_text.h"
+
+#include <castle_common/cc_debugging.h>
+#include "c_glyph_cache.h"
+
+static void release_label_glyphs(TransientTextLabel &label)
+{
+    for (int i = 0; i < label.glyphCnt; ++i)
+    {
+        release_glyph(label.glyphHandles[i]);
+    }
+
+    label.glyphCnt = 0;
+}
+
+void init_transient_text_system(TransientTextSystem &sys, cc::MemArena &permMemArena, const int labelLimit)
+{
+    assert(labelLimit > 0);
+
+    sys = {};
+
+    sys.labels = cc::push_to_mem_arena<TransientTextLabel>(permMemArena, labelLimit);
+    sys.labelLimit = labelLimit;
+}
+
+bool spawn_transient_text(TransientTextSystem &sys, const char *const text, const AssetID fontID, const TransientTextSpawnInfo &info, const AssetGroupManager &assetGroupManager)
+{
+    assert(info.life > 0);
+
+    if (sys.labelCnt == sys.labelLimit)
+    {
+        if (!sys.limitWarned)
+        {
+            cc::log_warning("The transient text label limit has been reached, so further labels are being dropped.");
+            sys.limitWarned = true;
+        }
+
+        return false;
+    }
+
+    TransientTextLabel &label = sys.labels[sys.labelCnt];
+    label.pos = info.pos;
+    label.vel = info.vel;
+    label.color = info.color;
+    label.life = info.life;
+    label.lifeInv = 1.0f / info.life;
+    label.glyphCnt = 0;
+    label.quadCnt = 0;
+
+    // Lay out the glyphs on a single line starting from zero, acquiring them as we go.
+    const FT_Face fontFace = assetGroupManager.get_font_face(fontID);
+    const bool kerning = FT_HAS_KERNING(fontFace);
+
+    float penX = 0.0f;
+    FT_UInt ftIndexLast = 0;
+
+    for (const char *textPtr = text; *textPtr && label.glyphCnt < gk_transientTextLabelCharLimit;)
+    {
+        const unsigned int codepoint = decode_utf8_char(textPtr);
+        const int glyphHandle = acquire_glyph(fontID, codepoint, assetGroupManager);
+
+        if (glyphHandle == -1)
+        {
+            continue;
+        }
+
+        label.glyphHandles[label.glyphCnt] = glyphHandle;
+        ++label.glyphCnt;
+
+        const GlyphInfo &glyphInfo = get_glyph_info(glyphHandle);
+
+        if (kerning && ftIndexLast)
+        {
+            FT_Vector kern;
+            FT_Get_Kerning(fontFace, ftIndexLast, glyphInfo.ftIndex, FT_KERNING_DEFAULT, &kern);
+            penX += kern.x >> 6;
+        }
+
+        ftIndexLast = glyphInfo.ftIndex;
+
+        if (glyphInfo.srcRect.width)
+        {
+            TransientTextQuad &quad = label.quads[label.quadCnt];
+            quad.topLeft = {penX + glyphInfo.horOffs, static_cast<float>(glyphInfo.verOffs)};
+            quad.bottomRight = {quad.topLeft.x + glyphInfo.srcRect.width, quad.topLeft.y + glyphInfo.srcRect.height};
+            quad.texCoordsTopLeft = {static_cast<float>(glyphInfo.srcRect.x) / gk_glyphAtlasSize.x, static_cast<float>(glyphInfo.srcRect.y) / gk_glyphAtlasSize.y};
+            quad.texCoordsBottomRight = {static_cast<float>(glyphInfo.srcRect.right()) / gk_glyphAtlasSize.x, static_cast<float>(glyphInfo.srcRect.bottom()) / gk_glyphAtlasSize.y};
+            ++label.quadCnt;
+        }
+
+        penX += glyphInfo.horAdvance;
+    }
+
+    // Centre the quads on the label position.
+    const cc::Vec2D centerOffs = {-penX / 2.0f, -assetGroupManager.get_font_line_height(fontID) / 2.0f};
+
+    for (int i = 0; i < label.quadCnt; ++i)
+    {
+        label.quads[i].topLeft += centerOffs;
+        label.quads[i].bottomRight += centerOffs;
+    }
+
+    ++sys.labelCnt;
+
+    return true;
+}
+
+void transient_text_tick(TransientTextSystem &sys)
+{
+    // Iterating backwards means the label moved into the place of a removed one has always already been ticked.
+    for (int i = sys.labelCnt - 1; i >= 0; --i)
+    {
+        TransientTextLabel &label = sys.labels[i];
+
+        label.pos += label.vel;
+        --label.life;
+
+        if (label.life > 0)
+        {
+            continue;
+        }
+
+        release_label_glyphs(label);
+
+        --sys.labelCnt;
+
+        if (i != sys.labelCnt)
+        {
+            label = sys.labels[sys.labelCnt];
+        }
+    }
+}
+
+void clear_transient_text(TransientTextSystem &sys)
+{
+    for (int i = 0; i < sys.labelCnt; ++i)
+    {
+        release_label_glyphs(sys.labels[i]);
+    }
+
+    sys.labelCnt = 0;
+}
+
+void write_transient_text_render_data(const TransientTextSystem &sys, Renderer &renderer)
+{
+    StreamedVertBatch &batch = renderer.camStreamedQuads;
+    clear_streamed_vert_batch(batch);
+
+    for (int i = 0; i < sys.labelCnt; ++i)
+    {
+        const TransientTextLabel &label = sys.labels[i];
+        const Color color = {label.color.r, label.color.g, label.color.b, label.color.a * label.life * label.lifeInv};
+
+        for (int j = 0; j < label.quadCnt; ++j)
+        {
+            const TransientTextQuad &quad = label.quads[j];
+
+            if (!add_streamed_quad(batch, label.pos + quad.topLeft, label.pos + quad.bottomRight, quad.texCoordsTopLeft, quad.texCoordsBottomRight, color))
+            {
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,58 @@
+// Short-lived world-space text, such as damage numbers. A label lays out its glyphs once, when spawned, and holds them in the glyph cache until its life runs out.
+// Every tick the quads of all live labels are written into the streamed quad batch of the renderer, which draws them over the camera layers in a single call.
+
+#pragma once
+
+#include <castle_common/cc_math.h>
+#include <castle_common/cc_mem.h>
+#include "c_assets.h"
+#include "c_rendering.h"
+
+constexpr int gk_transientTextLabelCharLimit = 16;
+
+struct TransientTextSpawnInfo
+{
+    cc::Vec2D pos; // The centre of the text.
+    cc::Vec2D vel; // Per tick.
+    Color color; // The alpha fades out to zero over the life of the label.
+    int life; // In ticks.
+};
+
+// A glyph quad, relative to the position of its label.
+struct TransientTextQuad
+{
+    cc::Vec2D topLeft;
+    cc::Vec2D bottomRight;
+    cc::Vec2D texCoordsTopLeft;
+    cc::Vec2D texCoordsBottomRight;
+};
+
+struct TransientTextLabel
+{
+    cc::Vec2D pos;
+    cc::Vec2D vel;
+    Color color;
+    int life;
+    float lifeInv; // The reciprocal of the starting life, used to determine alpha.
+
+    int glyphHandles[gk_transientTextLabelCharLimit];
+    int glyphCnt;
+
+    TransientTextQuad quads[gk_transientTextLabelCharLimit]; // Only for glyphs with something to draw.
+    int quadCnt;
+};
+
+struct TransientTextSystem
+{
+    TransientTextLabel *labels; // Live labels are kept packed at the front.
+    int labelLimit;
+    int labelCnt;
+
+    bool limitWarned;
+};
+
+void init_transient_text_system(TransientTextSystem &sys, cc::MemArena &permMemArena, const int labelLimit);
+bool spawn_transient_text(TransientTextSystem &sys, const char *const text, const AssetID fontID, const TransientTextSpawnInfo &info, const AssetGroupManager &assetGroupManager); // Returns false if the label limit has been reached. Text beyond the per-label character limit is dropped.
+void transient_text_tick(TransientTextSystem &sys); // Moves labels and removes those whose life has run out.
+void clear_transient_text(TransientTextSystem &sys);
+void write_transient_text_render_data(const TransientTextSystem &sys, Renderer &renderer);
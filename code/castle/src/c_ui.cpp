@@ -0,0 +1,248 @@
+#include "c_ui.h"
+
+#include <castle_common/cc_debugging.h>
+
+static void mark_ui_node_dirty(UITree &tree, const int index)
+{
+    assert(index >= 0 && index < tree.nodeCnt);
+
+    activate_bit(tree.nodeDirtiness, index);
+    tree.dirty = true;
+}
+
+static bool has_dirty_ancestor(const UITree &tree, const int index)
+{
+    for (int i = tree.nodes[index].parentIndex; i != -1; i = tree.nodes[i].parentIndex)
+    {
+        if (is_bit_active(tree.nodeDirtiness, i))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static cc::Vec2D calc_ui_node_pos(const UITree &tree, const UINode &node)
+{
+    if (node.parentIndex == -1)
+    {
+        return node.info.pos;
+    }
+
+    const UINode &parent = tree.nodes[node.parentIndex];
+
+    if (parent.info.childLayout == UI_CHILD_LAYOUT_GRID)
+    {
+        assert(parent.info.gridColCnt > 0);
+
+        const int col = node.siblingIndex % parent.info.gridColCnt;
+        const int row = node.siblingIndex / parent.info.gridColCnt;
+
+        return {
+            parent.rect.x + (col * (node.info.size.x + parent.info.gridSpacing.x)),
+            parent.rect.y + (row * (node.info.size.y + parent.info.gridSpacing.y))
+        };
+    }
+
+    return {
+        parent.rect.x + (parent.rect.width * node.info.anchor.x) + node.info.pos.x - (node.info.size.x * node.info.pivot.x),
+        parent.rect.y + (parent.rect.height * node.info.anchor.y) + node.info.pos.y - (node.info.size.y * node.info.pivot.y)
+    };
+}
+
+// Lays out the node and its descendants, which depend on it, writing the slots of those that are textured.
+static void layout_ui_subtree(UITree &tree, Renderer &renderer, const int index, const AssetGroupManager &assetGroupManager)
+{
+    UINode &node = tree.nodes[index];
+
+    node.rect = {calc_ui_node_pos(tree, node), node.info.size};
+    node.shown = !node.info.hidden && (node.parentIndex == -1 || tree.nodes[node.parentIndex].shown);
+
+    if (node.info.textured)
+    {
+        if (node.shown)
+        {
+            const SpriteBatchSlotWriteData writeData = {
+                .pos = node.rect.pos,
+                .srcRect = node.info.srcRect,
+                .origin = {},
+                .rot = 0.0f,
+                .scale = {node.rect.width / node.info.srcRect.width, node.rect.height / node.info.srcRect.height},
+                .alpha = node.info.alpha,
+                .palette = -1
+            };
+
+            // This skips the write if the slot already holds the same data, so that only nodes which actually changed have their vertices resubmitted.
+            write_to_sprite_batch_slot(renderer, node.sbSlotKey, writeData, assetGroupManager);
+            node.slotWritten = true;
+        }
+        else if (node.slotWritten)
+        {
+            clear_sprite_batch_slot(renderer, node.sbSlotKey);
+            node.slotWritten = false;
+        }
+    }
+
+    deactivate_bit(tree.nodeDirtiness, index);
+
+    for (int i = node.firstChildIndex; i != -1; i = tree.nodes[i].nextSiblingIndex)
+    {
+        layout_ui_subtree(tree, renderer, i, assetGroupManager);
+    }
+}
+
+void init_ui_tree(UITree &tree, cc::MemArena &permMemArena, const int nodeLimit, const int layerIndex, const cc::Vec2D rootSize)
+{
+    assert(nodeLimit > 0);
+
+    tree = {};
+
+    tree.nodes = cc::push_to_mem_arena<UINode>(permMemArena, nodeLimit);
+    tree.nodeLimit = nodeLimit;
+
+    tree.nodeDirtiness = {
+        .bytes = cc::push_to_mem_arena<cc::Byte>(permMemArena, bits_to_bytes(nodeLimit)),
+        .bitCnt = nodeLimit
+    };
+
+    tree.layerIndex = layerIndex;
+
+    // Add the root.
+    UINode &root = tree.nodes[0];
+    root = {};
+    root.info.size = rootSize;
+    root.parentIndex = -1;
+    root.firstChildIndex = -1;
+    root.lastChildIndex = -1;
+    root.nextSiblingIndex = -1;
+
+    tree.nodeCnt = 1;
+
+    mark_ui_node_dirty(tree, 0);
+}
+
+void clean_ui_tree(UITree &tree, Renderer &renderer)
+{
+    for (int i = 0; i < tree.nodeCnt; ++i)
+    {
+        if (tree.nodes[i].info.textured)
+        {
+            release_sprite_batch_slot(renderer, tree.nodes[i].sbSlotKey);
+        }
+    }
+
+    tree = {};
+}
+
+int add_ui_node(UITree &tree, Renderer &renderer, const int parentIndex, const UINodeInfo &info)
+{
+    assert(parentIndex >= 0 && parentIndex < tree.nodeCnt);
+
+    if (tree.nodeCnt == tree.nodeLimit)
+    {
+        assert(false && "The node limit of the UI tree has been reached!");
+        return -1;
+    }
+
+    const int index = tree.nodeCnt;
+    UINode &node = tree.nodes[index];
+    UINode &parent = tree.nodes[parentIndex];
+
+    node = {};
+
+    if (info.textured && !take_any_sprite_batch_slot(renderer, tree.layerIndex, info.texID, node.sbSlotKey))
+    {
+        cc::log_error("Failed to take a sprite batch slot for a UI node.");
+        return -1;
+    }
+
+    node.info = info;
+    node.parentIndex = parentIndex;
+    node.firstChildIndex = -1;
+    node.lastChildIndex = -1;
+    node.nextSiblingIndex = -1;
+
+    // Append the node to the children of the parent.
+    if (parent.lastChildIndex != -1)
+    {
+        node.siblingIndex = tree.nodes[parent.lastChildIndex].siblingIndex + 1;
+        tree.nodes[parent.lastChildIndex].nextSiblingIndex = index;
+    }
+    else
+    {
+        parent.firstChildIndex = index;
+    }
+
+    parent.lastChildIndex = index;
+
+    ++tree.nodeCnt;
+
+    mark_ui_node_dirty(tree, index);
+
+    return index;
+}
+
+void update_ui_tree(UITree &tree, Renderer &renderer, const AssetGroupManager &assetGroupManager)
+{
+    if (!tree.dirty)
+    {
+        return;
+    }
+
+    // Lay out each dirty subtree, starting from its topmost dirty node so that nodes are not laid out more than once.
+    for (int i = 0; i < tree.nodeCnt; ++i)
+    {
+        if (is_bit_active(tree.nodeDirtiness, i) && !has_dirty_ancestor(tree, i))
+        {
+            layout_ui_subtree(tree, renderer, i, assetGroupManager);
+        }
+    }
+
+    tree.dirty = false;
+}
+
+void set_ui_node_pos(UITree &tree, const int index, const cc::Vec2D pos)
+{
+    if (tree.nodes[index].info.pos != pos)
+    {
+        tree.nodes[index].info.pos = pos;
+        mark_ui_node_dirty(tree, index);
+    }
+}
+
+void set_ui_node_size(UITree &tree, const int index, const cc::Vec2D size)
+{
+    if (tree.nodes[index].info.size != size)
+    {
+        tree.nodes[index].info.size = size;
+        mark_ui_node_dirty(tree, index);
+    }
+}
+
+void set_ui_node_src_rect(UITree &tree, const int index, const cc::Rect &srcRect)
+{
+    if (tree.nodes[index].info.srcRect != srcRect)
+    {
+        tree.nodes[index].info.srcRect = srcRect;
+        mark_ui_node_dirty(tree, index);
+    }
+}
+
+void set_ui_node_alpha(UITree &tree, const int index, const float alpha)
+{
+    if (tree.nodes[index].info.alpha != alpha)
+    {
+        tree.nodes[index].info.alpha = alpha;
+        mark_ui_node_dirty(tree, index);
+    }
+}
+
+void set_ui_node_hidden(UITree &tree, const int index, const bool hidden)
+{
+    if (tree.nodes[index].info.hidden != hidden)
+    {
+        tree.nodes[index].info.hidden = hidden;
+        mark_ui_node_dirty(tree, index);
+    }
+}
@@ -0,0 +1,93 @@
+// A retained tree of UI nodes drawn into a render layer. Each textured node owns a sprite batch slot for as long as it exists.
+// Changing a node marks it dirty, and only dirty subtrees are laid out again, when the tree is next updated. Slots are only rewritten if what they show actually changed, so a tree that is not changing costs nothing to update.
+
+#pragma once
+
+#include <castle_common/cc_math.h>
+#include <castle_common/cc_mem.h>
+#include "c_assets.h"
+#include "c_rendering.h"
+
+enum UIChildLayout
+{
+    UI_CHILD_LAYOUT_FREE, // Children are placed by their anchors, pivots and positions.
+    UI_CHILD_LAYOUT_GRID // Children are placed in rows of cells, in the order they were added, and their own positions are ignored.
+};
+
+struct UINodeInfo
+{
+    cc::Vec2D pos; // An offset from the anchor point.
+    cc::Vec2D anchor; // The point in the parent the node is placed relative to, as a fraction of the parent size.
+    cc::Vec2D pivot; // The point in the node which is placed there, as a fraction of its size.
+    cc::Vec2D size;
+
+    UIChildLayout childLayout;
+    int gridColCnt;
+    cc::Vec2D gridSpacing;
+
+    bool textured;
+    AssetID texID;
+    cc::Rect srcRect; // Stretched to the node size.
+    float alpha;
+
+    bool hidden; // Also hides all descendants.
+};
+
+struct UINode
+{
+    UINodeInfo info;
+
+    int parentIndex; // -1 for the root.
+    int firstChildIndex;
+    int lastChildIndex;
+    int nextSiblingIndex;
+    int siblingIndex; // The position of the node among the children of its parent, used by grid layouts.
+
+    cc::RectFloat rect; // Computed by layout.
+    bool shown; // Whether the node and all its ancestors are not hidden, computed by layout.
+
+    SpriteBatchSlotKey sbSlotKey; // Only for textured nodes.
+    bool slotWritten;
+};
+
+struct UITree
+{
+    UINode *nodes;
+    int nodeCnt;
+    int nodeLimit;
+
+    Bitset nodeDirtiness;
+    bool dirty; // Whether any node is dirty.
+
+    int layerIndex;
+};
+
+void init_ui_tree(UITree &tree, cc::MemArena &permMemArena, const int nodeLimit, const int layerIndex, const cc::Vec2D rootSize); // The root is added as node 0, with free child layout.
+void clean_ui_tree(UITree &tree, Renderer &renderer);
+int add_ui_node(UITree &tree, Renderer &renderer, const int parentIndex, const UINodeInfo &info); // Returns -1 if the node limit has been reached or a textured node could not take a sprite batch slot.
+void update_ui_tree(UITree &tree, Renderer &renderer, const AssetGroupManager &assetGroupManager);
+
+// These only mark the node dirty if the value actually changes.
+void set_ui_node_pos(UITree &tree, const int index, const cc::Vec2D pos);
+void set_ui_node_size(UITree &tree, const int index, const cc::Vec2D size);
+void set_ui_node_src_rect(UITree &tree, const int index, const cc::Rect &srcRect);
+void set_ui_node_alpha(UITree &tree, const int index, const float alpha);
+void set_ui_node_hidden(UITree &tree, const int index, const bool hidden);
+
+inline UINodeInfo make_ui_tex_node_info(const AssetID texID, const cc::Vec2DInt texSize)
+{
+    return {
+        .pos = {},
+        .anchor = {},
+        .pivot = {},
+        .size = {static_cast<float>(texSize.x), static_cast<float>(texSize.y)},
+        .childLayout = UI_CHILD_LAYOUT_FREE,
+        .gridColCnt = 0,
+        .gridSpacing = {},
+        .textured = true,
+        .texID = texID,
+        .srcRect = {0, 0, texSize.x, texSize.y},
+        .alpha = 1.0f,
+        .hidden = false
+    };
+}
@@ -93,3 +93,52 @@ int first_inactive_bit_index(const cc::Byte *const bytes, const int bitCnt)
 
     return -1;
 }
+
+unsigned int decode_utf8_char(const char *&str)
+{
+    const auto bytes = reinterpret_cast<const unsigned char *>(str);
+
+    int len;
+    unsigned int codepoint;
+
+    if (bytes[0] < 0x80)
+    {
+        len = 1;
+        codepoint = bytes[0];
+    }
+    else if ((bytes[0] & 0xE0) == 0xC0)
+    {
+        len = 2;
+        codepoint = bytes[0] & 0x1F;
+    }
+    else if ((bytes[0] & 0xF0) == 0xE0)
+    {
+        len = 3;
+        codepoint = bytes[0] & 0x0F;
+    }
+    else if ((bytes[0] & 0xF8) == 0xF0)
+    {
+        len = 4;
+        codepoint = bytes[0] & 0x07;
+    }
+    else
+    {
+        ++str;
+        return 0xFFFD;
+    }
+
+    for (int i = 1; i < len; ++i)
+    {
+        if ((bytes[i] & 0xC0) != 0x80)
+        {
+            str += i;
+            return 0xFFFD;
+        }
+
+        codepoint = (codepoint << 6) | (bytes[i] & 0x3F);
+    }
+
+    str += len;
+
+    return codepoint;
+}
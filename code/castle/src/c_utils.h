@@ -166,3 +166,5 @@ inline int first_inactive_bit_index(const Bitset &bitset)
 {
     return first_inactive_bit_index(bitset.bytes, bitset.bitCnt);
 }
+
+unsigned int decode_utf8_char(const char *&str); // Decodes the UTF-8 character at the start of the string, advancing past it. Malformed sequences decode to the replacement character.
@@ -1,6 +1,11 @@
 #include "c_world.h"
 
+#include <castle_common/cc_debugging.h>
+#include "c_game.h"
 #include "c_rand.h"
+#include "c_debug_draw.h"
+
+static constexpr int ik_transformLevelNodeLimits[] = {1, 1}; // The player, then the sword it holds.
 
 static RenderLayerInitInfo render_layer_factory(const int index)
 {
@@ -8,30 +13,47 @@ static RenderLayerInitInfo render_layer_factory(const int index)
     {
         case WORLD_ENEMY_ENT_LAYER:
             return {
-                .spriteBatchCnt = 1,
                 .spriteBatchSlotCnt = gk_enemyEntLimit,
-                .charBatchCnt = 0
+                .spriteBatchUsage = SPRITE_BATCH_USAGE_DYNAMIC,
+                .opaqueSprites = true,
+                .spriteFeatures = SPRITE_FEATURE_ROT_BIT,
+                .cached = false
             };
 
         case WORLD_PLAYER_ENT_LAYER:
             return {
-                .spriteBatchCnt = 1,
                 .spriteBatchSlotCnt = 2,
-                .charBatchCnt = 0
+                .spriteBatchUsage = SPRITE_BATCH_USAGE_DYNAMIC,
+                .opaqueSprites = true,
+                .spriteFeatures = SPRITE_FEATURE_ROT_BIT | SPRITE_FEATURE_ANIM_BIT,
+                .cached = false
+            };
+
+        case WORLD_PARTICLE_LAYER:
+            return {
+                .spriteBatchSlotCnt = RenderLayer::sk_spriteBatchSlotLimit,
+                .spriteBatchUsage = SPRITE_BATCH_USAGE_DYNAMIC,
+                .opaqueSprites = false,
+                .spriteFeatures = SPRITE_FEATURE_ROT_BIT | SPRITE_FEATURE_ALPHA_BIT,
+                .cached = false
             };
 
-        case WORLD_HITBOX_LAYER:
+        case WORLD_UI_LAYER:
             return {
-                .spriteBatchCnt = 1,
-                .spriteBatchSlotCnt = gk_hitboxLimit,
-                .charBatchCnt = 0
+                .spriteBatchSlotCnt = gk_invSlotCnt,
+                .spriteBatchUsage = SPRITE_BATCH_USAGE_STATIC,
+                .opaqueSprites = false,
+                .spriteFeatures = SPRITE_FEATURE_ALPHA_BIT,
+                .cached = false
             };
 
         case WORLD_CURSOR_LAYER:
             return {
-                .spriteBatchCnt = 1,
                 .spriteBatchSlotCnt = 1,
-                .charBatchCnt = 0
+                .spriteBatchUsage = SPRITE_BATCH_USAGE_DYNAMIC,
+                .opaqueSprites = false,
+                .spriteFeatures = 0,
+                .cached = false
             };
 
         default:
@@ -40,6 +62,52 @@ static RenderLayerInitInfo render_layer_factory(const int index)
     }
 }
 
+static bool init_ui(World &world, cc::MemArena &permMemArena, const AssetGroupManager &assetGroupManager)
+{
+    const cc::Vec2DInt windowSize = get_window_size();
+    init_ui_tree(world.ui, permMemArena, 2 + gk_invSlotCnt, WORLD_UI_LAYER, {static_cast<float>(windowSize.x), static_cast<float>(windowSize.y)});
+
+    // Add the inventory, a grid of slots in the centre of the screen, hidden until opened.
+    const AssetID invSlotTexID = make_core_asset_id(cc::INV_SLOT_TEX);
+    const cc::Vec2DInt invSlotTexSize = assetGroupManager.get_tex_size(invSlotTexID);
+    const cc::Vec2D invSlotSpacing = {4.0f, 4.0f};
+
+    const UINodeInfo invPanelInfo = {
+        .pos = {},
+        .anchor = {0.5f, 0.5f},
+        .pivot = {0.5f, 0.5f},
+        .size = {
+            (gk_invColCnt * (invSlotTexSize.x + invSlotSpacing.x)) - invSlotSpacing.x,
+            (gk_invRowCnt * (invSlotTexSize.y + invSlotSpacing.y)) - invSlotSpacing.y
+        },
+        .childLayout = UI_CHILD_LAYOUT_GRID,
+        .gridColCnt = gk_invColCnt,
+        .gridSpacing = invSlotSpacing,
+        .textured = false,
+        .texID = {},
+        .srcRect = {},
+        .alpha = 1.0f,
+        .hidden = true
+    };
+
+    world.invPanelUINodeIndex = add_ui_node(world.ui, world.renderer, 0, invPanelInfo);
+
+    if (world.invPanelUINodeIndex == -1)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < gk_invSlotCnt; ++i)
+    {
+        if (add_ui_node(world.ui, world.renderer, world.invPanelUINodeIndex, make_ui_tex_node_info(invSlotTexID, invSlotTexSize)) == -1)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 static void write_cursor_render_data(World &world, const InputManager &inputManager, const AssetGroupManager &assetGroupManager)
 {
     const cc::Vec2DInt texSize = assetGroupManager.get_tex_size(make_core_asset_id(cc::CURSOR_TEX));
@@ -50,52 +118,59 @@ static void write_cursor_render_data(World &world, const InputManager &inputMana
         .origin = {0.5f, 0.5f},
         .rot = 0.0f,
         .scale = {1.0f, 1.0f},
-        .alpha = 1.0f
+        .alpha = 1.0f,
+        .palette = -1
     };
 
     write_to_sprite_batch_slot(world.renderer, world.cursorSBSlotKey, writeData, assetGroupManager);
 }
 
-void init_world(World &world, MusicManager &musicManager, cc::MemArena &permMemArena, cc::MemArena &tempMemArena, const AssetGroupManager &assetGroupManager)
+bool init_world(World &world, MusicManager &musicManager, cc::MemArena &permMemArena, cc::MemArena &tempMemArena, const AssetGroupManager &assetGroupManager)
 {
-    init_renderer(world.renderer, permMemArena, WORLD_LAYER_CNT, WORLD_HITBOX_LAYER + 1, render_layer_factory);
+    world = {}; // So that cleaning is safe should initialisation fail part of the way through.
 
-    init_player_ent(world, assetGroupManager);
+    init_renderer(world.renderer, permMemArena, WORLD_LAYER_CNT, WORLD_PARTICLE_LAYER + 1, render_layer_factory);
 
-    for (int i = 0; i < gk_hitboxLimit; ++i)
+    init_transform_hierarchy(world.transforms, permMemArena, ik_transformLevelNodeLimits, sizeof(ik_transformLevelNodeLimits) / sizeof(*ik_transformLevelNodeLimits));
+
+    if (!init_player_ent(world, assetGroupManager))
     {
-        world.hitboxes[i].sbSlotKey = take_any_sprite_batch_slot(world.renderer, WORLD_HITBOX_LAYER, make_core_asset_id(cc::PIXEL_TEX));
+        return false;
     }
 
-    cc::RectFloat hitboxes[gk_hitboxLimit];
-    SpriteBatchSlotKey hitboxSBSlotKeys[gk_hitboxLimit];
-    StaticBitset<gk_hitboxLimit> hitboxActivity;
+    init_particle_system(world.particleSys, permMemArena, gk_particleLimit, make_core_asset_id(cc::PIXEL_TEX), WORLD_PARTICLE_LAYER, RenderLayer::sk_spriteBatchSlotLimit, 0.88f);
 
-    world.cursorSBSlotKey = take_any_sprite_batch_slot(world.renderer, WORLD_CURSOR_LAYER, make_core_asset_id(cc::CURSOR_TEX));
+    init_transient_text_system(world.transientText, permMemArena, gk_transientTextLabelLimit);
+
+    if (!init_ui(world, permMemArena, assetGroupManager))
+    {
+        return false;
+    }
+
+    if (!take_any_sprite_batch_slot(world.renderer, WORLD_CURSOR_LAYER, make_core_asset_id(cc::CURSOR_TEX), world.cursorSBSlotKey))
+    {
+        cc::log_error("Failed to take the sprite batch slot of the cursor.");
+        return false;
+    }
 
     // Start combat music.
     const MusicSrcID combatMusicSrcID = musicManager.add_src(make_core_asset_id(cc::COMBAT_MUSIC), assetGroupManager);
     musicManager.play_src(tempMemArena, combatMusicSrcID, assetGroupManager);
+
+    return true;
 }
 
 void clean_world(World &world)
 {
+    clear_transient_text(world.transientText);
+    clean_ui_tree(world.ui, world.renderer);
     clean_renderer(world.renderer);
 }
 
 void world_tick(World &world, SoundManager &soundManager, const InputManager &inputManager, const AssetGroupManager &assetGroupManager)
 {
     // Reset hitboxes.
-    for (int i = 0; i < gk_hitboxLimit; ++i)
-    {
-        if (!is_bit_active(world.hitboxActivity, i))
-        {
-            continue;
-        }
-
-        clear_sprite_batch_slot(world.renderer, world.hitboxes[i].sbSlotKey);
-        deactivate_bit(world.hitboxActivity, i);
-    }
+    world.hitboxActivity = {};
 
     // Handle enemy spawning.
     if (world.enemyEntSpawnTime > 0)
@@ -106,12 +181,17 @@ void world_tick(World &world, SoundManager &soundManager, const InputManager &in
     {
         const float spawnRange = 240.0f;
 
-        const cc::Vec2D spawnPos = {
-            gen_rand_float(-spawnRange, spawnRange),
-            gen_rand_float(-spawnRange, spawnRange)
-        };
+        cc::Vec2D spawnPositions[gk_enemyEntSpawnWaveSize];
+
+        for (int i = 0; i < gk_enemyEntSpawnWaveSize; ++i)
+        {
+            spawnPositions[i] = {
+                gen_rand_float(-spawnRange, spawnRange),
+                gen_rand_float(-spawnRange, spawnRange)
+            };
+        }
 
-        spawn_enemy_ent(world, spawnPos, assetGroupManager);
+        spawn_enemy_ents(world, spawnPositions, gk_enemyEntSpawnWaveSize, assetGroupManager);
 
         world.enemyEntSpawnTime = gk_enemyEntSpawnInterval;
     }
@@ -133,6 +213,19 @@ void world_tick(World &world, SoundManager &soundManager, const InputManager &in
         enemy_ent_tick(world, i, assetGroupManager);
     }
 
+    // Resolve the transforms of everything attached to something else, now that everything has moved, then write the render data placed by them.
+    update_transforms(world.transforms);
+    write_player_ent_render_data(world, assetGroupManager);
+
+    // Update particles.
+    particle_system_tick(world.particleSys);
+
+    // Update transient text, such as damage numbers.
+    transient_text_tick(world.transientText);
+
+    // Move sprites animated on the GPU along.
+    advance_sprite_anim_time(world.renderer);
+
     // Update hitboxes.
     for (int i = 0; i < gk_hitboxLimit; ++i)
     {
@@ -156,23 +249,30 @@ void world_tick(World &world, SoundManager &soundManager, const InputManager &in
 
             if (cc::do_rects_intersect(hitbox.rect, enemyEntCollider))
             {
-                hurt_enemy_ent(world, j, 1, hitbox.force);
+                hurt_enemy_ent(world, j, 1, hitbox.force, assetGroupManager);
             }
         }
 
-        // Write hitbox render data.
-        const SpriteBatchSlotWriteData writeData = {
-            .pos = hitbox.rect.pos,
-            .srcRect = {0, 0, 1, 1},
-            .origin = {},
-            .rot = 0.0f,
-            .scale = hitbox.rect.size,
-            .alpha = 1.0f
-        };
+        debug_draw_rect(hitbox.rect, gk_red);
+    }
+
+    // Write particle render data.
+    write_particle_system_render_data(world.particleSys, world.renderer, assetGroupManager);
+
+    // Write transient text render data.
+    write_transient_text_render_data(world.transientText, world.renderer);
 
-        write_to_sprite_batch_slot(world.renderer, world.hitboxes[i].sbSlotKey, writeData, assetGroupManager);
+    // Update the UI, which only does anything if some part of it has changed.
+    if (inputManager.is_key_pressed(KEY_TAB))
+    {
+        set_ui_node_hidden(world.ui, world.invPanelUINodeIndex, !world.ui.nodes[world.invPanelUINodeIndex].info.hidden);
     }
 
+    const cc::Vec2DInt windowSize = get_window_size();
+    set_ui_node_size(world.ui, 0, {static_cast<float>(windowSize.x), static_cast<float>(windowSize.y)});
+
+    update_ui_tree(world.ui, world.renderer, assetGroupManager);
+
     // Write cursor render data.
     {
         const SpriteBatchSlotWriteData writeData = {
@@ -181,7 +281,8 @@ void world_tick(World &world, SoundManager &soundManager, const InputManager &in
             .origin = {0.5f, 0.5f},
             .rot = 0.0f,
             .scale = {1.0f, 1.0f},
-            .alpha = 1.0f
+            .alpha = 1.0f,
+            .palette = -1
         };
 
         write_to_sprite_batch_slot(world.renderer, world.cursorSBSlotKey, writeData, assetGroupManager);
@@ -6,19 +6,30 @@
 #include "c_rendering.h"
 #include "c_animation.h"
 #include "c_audio.h"
+#include "c_particles.h"
+#include "c_transient_text.h"
+#include "c_ui.h"
+#include "c_transforms.h"
 
 constexpr int gk_enemyEntLimit = 64;
 constexpr int gk_enemyEntSpawnInterval = 180;
+constexpr int gk_enemyEntSpawnWaveSize = 4;
 constexpr int gk_hitboxLimit = 16;
+constexpr int gk_particleLimit = 1 << 17;
+constexpr int gk_transientTextLabelLimit = 512;
+constexpr int gk_invColCnt = 10;
+constexpr int gk_invRowCnt = 6;
+constexpr int gk_invSlotCnt = gk_invColCnt * gk_invRowCnt;
 
 enum WorldRenderLayer
 {
     // Camera Layers
     WORLD_ENEMY_ENT_LAYER,
     WORLD_PLAYER_ENT_LAYER,
-    WORLD_HITBOX_LAYER, // TEMP: Only for debugging.
+    WORLD_PARTICLE_LAYER,
 
     // Non-Camera Layers
+    WORLD_UI_LAYER,
     WORLD_CURSOR_LAYER,
 
     WORLD_LAYER_CNT
@@ -27,6 +38,7 @@ enum WorldRenderLayer
 struct PlayerEntSword
 {
     SpriteBatchSlotKey sbSlotKey;
+    int transformIndex; // A child of that of the player, rotated by the offset.
     bool rotNeg;
     float rotOffs;
 };
@@ -40,6 +52,7 @@ struct PlayerEnt
     cc::Vec2D pos;
     float rot;
     cc::Vec2D vel;
+    int transformIndex;
 
     PlayerEntSword sword;
 };
@@ -58,7 +71,6 @@ struct Hitbox
 {
     cc::RectFloat rect;
     cc::Vec2D force; // Generally used for knockback.
-    SpriteBatchSlotKey sbSlotKey; // For debug display.
 };
 
 struct World
@@ -66,6 +78,8 @@ struct World
     Renderer renderer;
     Camera cam;
 
+    TransformHierarchy transforms;
+
     PlayerEnt playerEnt;
 
     EnemyEnt enemyEnts[gk_enemyEntLimit];
@@ -75,20 +89,27 @@ struct World
     Hitbox hitboxes[gk_hitboxLimit];
     StaticBitset<gk_hitboxLimit> hitboxActivity;
 
+    ParticleSystem particleSys;
+    TransientTextSystem transientText;
+
+    UITree ui;
+    int invPanelUINodeIndex;
+
     SpriteBatchSlotKey cursorSBSlotKey;
 };
 
-void init_world(World &world, MusicManager &musicManager, cc::MemArena &permMemArena, cc::MemArena &tempMemArena, const AssetGroupManager &assetGroupManager);
+bool init_world(World &world, MusicManager &musicManager, cc::MemArena &permMemArena, cc::MemArena &tempMemArena, const AssetGroupManager &assetGroupManager);
 void clean_world(World &world);
 void world_tick(World &world, SoundManager &soundManager, const InputManager &inputManager, const AssetGroupManager &assetGroupManager);
 
-void init_player_ent(World &world, const AssetGroupManager &assetGroupManager);
+bool init_player_ent(World &world, const AssetGroupManager &assetGroupManager);
 void player_ent_tick(World &world, SoundManager &soundManager, const InputManager &inputManager, const AssetGroupManager &assetGroupManager);
+void write_player_ent_render_data(World &world, const AssetGroupManager &assetGroupManager); // Must follow the transform update of the tick.
 cc::RectFloat make_player_ent_collider(PlayerEnt &ent, const AssetGroupManager &assetGroupManager);
 
-int spawn_enemy_ent(World &world, const cc::Vec2D pos, const AssetGroupManager &assetGroupManager);
+int spawn_enemy_ents(World &world, const cc::Vec2D *const positions, const int cnt, const AssetGroupManager &assetGroupManager); // Returns how many were spawned, which is fewer than requested if the entity limit is reached.
 void enemy_ent_tick(World &world, const int entIndex, const AssetGroupManager &assetGroupManager);
-void hurt_enemy_ent(World &world, const int entIndex, const int dmg, const cc::Vec2D force);
+void hurt_enemy_ent(World &world, const int entIndex, const int dmg, const cc::Vec2D force, const AssetGroupManager &assetGroupManager);
 cc::RectFloat make_enemy_ent_collider(EnemyEnt &ent, const AssetGroupManager &assetGroupManager);
 
 int add_hitbox(World &world, const cc::RectFloat rect, const cc::Vec2D force);
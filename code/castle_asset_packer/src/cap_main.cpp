@@ -49,7 +49,7 @@ int main(const int argCnt, const char *const *const args)
     cc::init_mem_arena(memArena, ik_memArenaSize);
 
     // Pack assets.
-    const bool packingSuccessful = pack_textures(assetsFileStream, assetsDir)
+    const bool packingSuccessful = pack_textures(assetsFileStream, assetsDir, memArena)
         && pack_fonts(assetsFileStream, assetsDir, memArena)
         && pack_sounds(assetsFileStream, assetsDir, memArena)
         && pack_music(assetsFileStream, assetsDir, memArena);
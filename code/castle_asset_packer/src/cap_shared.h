@@ -10,7 +10,7 @@
 
 constexpr int gk_assetFilePathMaxLen = 255;
 
-bool pack_textures(FILE *const assetFileStream, const char *const assetsDir);
+bool pack_textures(FILE *const assetFileStream, const char *const assetsDir, cc::MemArena &memArena);
 bool pack_fonts(FILE *const assetFileStream, const char *const assetsDir, cc::MemArena &memArena);
 bool pack_sounds(FILE *const assetFileStream, const char *const assetsDir, cc::MemArena &memArena);
 bool pack_music(FILE *const assetFileStream, const char *const assetsDir, cc::MemArena &memArena);
@@ -14,8 +14,59 @@ static const char *const ik_texFilePathEnds[] = {
 
 static_assert(cc::CORE_TEX_CNT == CC_STATIC_ARRAY_LEN(ik_texFilePathEnds));
 
-bool pack_textures(FILE *const assetFileStream, const char *const assetsDir)
+static constexpr int ik_paletteColorHashTableSize = cc::gk_texPaletteColorLimit * 2; // Must be a power of two.
+
+// Writes a palette index for every pixel and returns the palette colour count, or 0 if the pixels have more colours than a palette can hold. Fully transparent pixels all share one colour.
+static int build_tex_palette(unsigned int (&paletteColors)[cc::gk_texPaletteColorLimit], cc::Byte *const pxPaletteIndexes, const stbi_uc *const pxData, const int pxCnt)
+{
+    // Map colours to palette indexes through an open-addressing hash table.
+    unsigned int hashTableColors[ik_paletteColorHashTableSize];
+    int hashTablePaletteIndexes[ik_paletteColorHashTableSize];
+    memset(hashTablePaletteIndexes, -1, sizeof(hashTablePaletteIndexes));
+
+    int colorCnt = 0;
+
+    for (int i = 0; i < pxCnt; ++i)
+    {
+        unsigned int color;
+        memcpy(&color, pxData + (i * cc::gk_texChannelCnt), sizeof(color));
+
+        if (!pxData[(i * cc::gk_texChannelCnt) + 3])
+        {
+            color = 0;
+        }
+
+        int hashIndex = ((color * 2654435761u) >> 16) & (ik_paletteColorHashTableSize - 1);
+
+        while (hashTablePaletteIndexes[hashIndex] != -1 && hashTableColors[hashIndex] != color)
+        {
+            hashIndex = (hashIndex + 1) & (ik_paletteColorHashTableSize - 1);
+        }
+
+        if (hashTablePaletteIndexes[hashIndex] == -1)
+        {
+            if (colorCnt == cc::gk_texPaletteColorLimit)
+            {
+                return 0;
+            }
+
+            hashTableColors[hashIndex] = color;
+            hashTablePaletteIndexes[hashIndex] = colorCnt;
+            paletteColors[colorCnt] = color;
+            ++colorCnt;
+        }
+
+        pxPaletteIndexes[i] = static_cast<cc::Byte>(hashTablePaletteIndexes[hashIndex]);
+    }
+
+    return colorCnt;
+}
+
+bool pack_textures(FILE *const assetFileStream, const char *const assetsDir, cc::MemArena &memArena)
 {
+    // Reserve memory for palette indexes (reused for every texture).
+    const auto pxPaletteIndexesBuf = cc::push_to_mem_arena<cc::Byte>(memArena, cc::gk_texSizeLimit.x * cc::gk_texSizeLimit.y);
+
     for (const char *const texFilePathEnd : ik_texFilePathEnds)
     {
         // Determine the texture file path.
@@ -39,12 +90,33 @@ bool pack_textures(FILE *const assetFileStream, const char *const assetsDir)
             return false;
         }
 
+        // Write the texture as palette indexes if its colours fit in a palette, otherwise as RGBA.
+        unsigned int paletteColors[cc::gk_texPaletteColorLimit];
+        const int paletteColorCnt = build_tex_palette(paletteColors, pxPaletteIndexesBuf, pxData, texSize.x * texSize.y);
+
         fwrite(&texSize, sizeof(texSize), 1, assetFileStream);
-        fwrite(pxData, texSize.x * texSize.y * cc::gk_texChannelCnt, 1, assetFileStream);
+        fwrite(&paletteColorCnt, sizeof(paletteColorCnt), 1, assetFileStream);
+
+        if (paletteColorCnt)
+        {
+            fwrite(paletteColors, sizeof(paletteColors[0]), paletteColorCnt, assetFileStream);
+            fwrite(pxPaletteIndexesBuf, 1, texSize.x * texSize.y, assetFileStream);
+        }
+        else
+        {
+            fwrite(pxData, texSize.x * texSize.y * cc::gk_texChannelCnt, 1, assetFileStream);
+        }
 
         stbi_image_free(pxData);
 
-        cc::log("Successfully packed texture with file path \"%s\".", texFilePath);
+        if (paletteColorCnt)
+        {
+            cc::log("Successfully packed texture with file path \"%s\" as palette indexes with %d colours.", texFilePath, paletteColorCnt);
+        }
+        else
+        {
+            cc::log("Successfully packed texture with file path \"%s\".", texFilePath);
+        }
     }
 
     return true;
@@ -10,8 +10,10 @@ const char *const gk_assetsFileName = "assets.dat";
 constexpr Vec2DInt gk_texSizeLimit = {2048, 2048};
 constexpr int gk_texChannelCnt = 4;
 
-constexpr int gk_fontCharRangeBegin = 32;
-constexpr int gk_fontCharRangeSize = 95;
+// Textures are packed as their size, followed by their palette colour count. If the count is zero, the RGBA pixel data follows. Otherwise the palette follows, as packed RGBA colours with red in the lowest byte, and then a palette index byte for every pixel.
+constexpr int gk_texPaletteColorLimit = 256;
+
+constexpr int gk_fontFileSizeLimit = 1 << 22;
 
 constexpr int gk_musicFileNameMaxLen = 127;
 
@@ -55,22 +57,11 @@ enum CoreMusicIndex
     CORE_MUSIC_CNT
 };
 
-struct FontCharsDisplayInfo
-{
-    int horOffsets[gk_fontCharRangeSize];
-    int verOffsets[gk_fontCharRangeSize];
-    int horAdvances[gk_fontCharRangeSize];
-
-    Rect srcRects[gk_fontCharRangeSize];
-
-    int kernings[gk_fontCharRangeSize * gk_fontCharRangeSize];
-};
-
-struct FontDisplayInfo
+// Fonts are packed as their font file data, following this, so that glyphs can be rasterised as they are needed at runtime.
+struct FontInfo
 {
-    int lineHeight;
-    FontCharsDisplayInfo chars;
-    Vec2DInt texSize;
+    int ptSize;
+    int fileSize;
 };
 
 struct AudioInfo
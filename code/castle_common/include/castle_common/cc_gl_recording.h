@@ -0,0 +1,99 @@
+// The format of GL recordings, written by the game and executed by castle_gl_replay.
+// A recording starts with a header, followed by definitions of every GL object in existence and of the GL state when recording began, followed by the commands of each frame in the order they were issued.
+// Each definition and command is a single opcode byte followed by its arguments, with integers and floats as 4 bytes each and data inline after its size. GL objects are referred to by the names they had when recorded, and enums by their GL values.
+
+#pragma once
+
+namespace cc
+{
+
+constexpr int gk_glRecordingMagic = 0x524C4743; // "CGLR" when read as bytes.
+constexpr int gk_glRecordingVersion = 3;
+
+constexpr int gk_glRecordingNameLimit = 4096; // Recorded GL object names must be below this.
+constexpr int gk_glRecordingUniformLocLimit = 1024; // Recorded uniform locations must be below this.
+constexpr int gk_glRecordingTexUnitLimit = 32;
+constexpr int gk_glRecordingBufBindingPointLimit = 4; // Of each of the uniform and shader storage buffer binding points.
+
+// Follows the header, which is the magic number, the version and the width and height of the default framebuffer.
+enum GLRecordingOpcode
+{
+    //
+    // Definitions
+    //
+    GL_REC_DEF_BUF, // Name, size, usage, data of the size.
+    GL_REC_DEF_ASSET_TEX, // Name, core texture index, minification filter, magnification filter, wrap S, wrap T. The pixels are loaded from the assets file.
+    GL_REC_DEF_TEX, // Name, internal format, width, height, minification filter, magnification filter, wrap S, wrap T, pixel format, pixel type, pixel data size, pixels. A pixel data size of zero leaves the texture without contents.
+    GL_REC_DEF_RENDERBUF, // Name, internal format, width, height.
+    GL_REC_DEF_FRAMEBUF, // Name, attachment count, then per attachment the attachment point, whether it is a renderbuffer and the name of the texture or renderbuffer.
+    GL_REC_DEF_VERT_ARRAY, // Name, element buffer, attribute count, then per attribute its index, whether it is enabled, size, type, normalised, integer, stride, offset and buffer.
+    GL_REC_DEF_PROG, // Name, whether it is compute, vertex or compute source size and source, fragment source size and source, uniform count, then per uniform its location, name size and name.
+    GL_REC_DEF_STATE, // Viewport, clear colour, blend enabled, blend factors, depth test enabled, depth function, depth mask, unpack alignment, program, vertex array, draw framebuffer, read framebuffer, renderbuffer, array buffer, draw indirect buffer, active texture unit, the 2D texture bound to each unit, then the buffer bound to each uniform and each shader storage binding point.
+
+    //
+    // Frame Commands
+    //
+    GL_REC_GEN_BUFS, // Count then names, as are the other generation and deletion commands.
+    GL_REC_DELETE_BUFS,
+    GL_REC_GEN_TEXS,
+    GL_REC_DELETE_TEXS,
+    GL_REC_GEN_VERT_ARRAYS,
+    GL_REC_DELETE_VERT_ARRAYS,
+    GL_REC_GEN_FRAMEBUFS,
+    GL_REC_DELETE_FRAMEBUFS,
+    GL_REC_GEN_RENDERBUFS,
+    GL_REC_DELETE_RENDERBUFS,
+
+    GL_REC_BIND_BUF,
+    GL_REC_BIND_BUF_BASE,
+    GL_REC_BIND_VERT_ARRAY,
+    GL_REC_BIND_TEX,
+    GL_REC_ACTIVE_TEX,
+    GL_REC_BIND_FRAMEBUF,
+    GL_REC_BIND_RENDERBUF,
+    GL_REC_USE_PROG,
+
+    GL_REC_ENABLE,
+    GL_REC_DISABLE,
+    GL_REC_DEPTH_FUNC,
+    GL_REC_DEPTH_MASK,
+    GL_REC_BLEND_FUNC,
+    GL_REC_BLEND_FUNC_SEPARATE, // Source colour factor, destination colour factor, source alpha factor, destination alpha factor.
+    GL_REC_VIEWPORT,
+    GL_REC_CLEAR_COLOR,
+    GL_REC_CLEAR,
+    GL_REC_PIXEL_STORE,
+    GL_REC_MEM_BARRIER,
+
+    GL_REC_BUF_DATA, // Target, size, usage, whether there is data, then data of the size if so.
+    GL_REC_BUF_SUB_DATA, // Target, offset, size, data.
+    GL_REC_COPY_BUF_SUB_DATA,
+    GL_REC_TEX_IMAGE_2D, // Target, level, internal format, width, height, format, type, data size, data.
+    GL_REC_TEX_SUB_IMAGE_2D, // Target, level, x, y, width, height, format, type, data size, data.
+    GL_REC_TEX_PARAM,
+    GL_REC_RENDERBUF_STORAGE,
+    GL_REC_FRAMEBUF_TEX_2D,
+    GL_REC_FRAMEBUF_RENDERBUF,
+    GL_REC_VERT_ATTRIB_POINTER,
+    GL_REC_VERT_ATTRIB_I_POINTER, // Index, size, type, stride, offset.
+    GL_REC_ENABLE_VERT_ATTRIB_ARRAY,
+
+    GL_REC_UNIFORM_1I, // Uniforms are given by their recorded location in the program in use.
+    GL_REC_UNIFORM_1F,
+    GL_REC_UNIFORM_1IV, // Location, count, values.
+    GL_REC_UNIFORM_2FV,
+    GL_REC_UNIFORM_4FV,
+    GL_REC_UNIFORM_MATRIX_4FV, // Location, count, transpose, values.
+
+    GL_REC_DRAW_ARRAYS,
+    GL_REC_DRAW_ELEMS_BASE_VERT, // Mode, count, type, index offset, base vertex.
+    GL_REC_MULTI_DRAW_ELEMS_BASE_VERT, // Mode, type, draw count, then per draw the count, index offset and base vertex.
+    GL_REC_MULTI_DRAW_ELEMS_INDIRECT, // Mode, type, indirect buffer offset, draw count, stride.
+    GL_REC_DISPATCH_COMPUTE,
+    GL_REC_BLIT_FRAMEBUF,
+
+    GL_REC_FRAME_END, // Where the buffers were swapped.
+    GL_REC_END
+};
+
+}
@@ -0,0 +1,240 @@
+#include <stdlib.h>
+#include <limits.h>
+#include <algorithm>
+#include <GLFW/glfw3.h>
+#include "cgr_shared.h"
+
+static constexpr int ik_glVersionMajor = 4;
+static constexpr int ik_glVersionMinor = 3;
+
+static constexpr int ik_defaultPassCnt = 5;
+static constexpr int ik_memArenaSize = (1 << 20) * 32; // In addition to the size of the recording.
+
+// Times of a run of frames, in milliseconds.
+struct FrameTimeStats
+{
+    double min;
+    double max;
+    double total;
+    int cnt;
+};
+
+static void add_frame_time(FrameTimeStats &stats, const double time)
+{
+    stats.min = stats.cnt ? std::min(stats.min, time) : time;
+    stats.max = stats.cnt ? std::max(stats.max, time) : time;
+    stats.total += time;
+    ++stats.cnt;
+}
+
+static void merge_frame_time_stats(FrameTimeStats &stats, const FrameTimeStats &other)
+{
+    if (!other.cnt)
+    {
+        return;
+    }
+
+    stats.min = stats.cnt ? std::min(stats.min, other.min) : other.min;
+    stats.max = stats.cnt ? std::max(stats.max, other.max) : other.max;
+    stats.total += other.total;
+    stats.cnt += other.cnt;
+}
+
+static void log_frame_time_stats(const char *const label, const FrameTimeStats &stats)
+{
+    if (!stats.cnt)
+    {
+        return;
+    }
+
+    cc::log("%s: min %.3f ms, avg %.3f ms, max %.3f ms", label, stats.min, stats.total / stats.cnt, stats.max);
+}
+
+// Returns false if the replay failed partway through.
+static bool replay_pass(GLRecordingReader &reader, const ReplayAssetTexs &assetTexs, const GLID timerQueryGLID, FrameTimeStats &cpuStats, FrameTimeStats &gpuStats)
+{
+    if (!begin_replay_pass(reader, assetTexs))
+    {
+        end_replay_pass();
+        return false;
+    }
+
+    // Let the definitions settle before timing anything.
+    glFinish();
+
+    while (true)
+    {
+        const double frameBeginTime = glfwGetTime();
+        glBeginQuery(GL_TIME_ELAPSED, timerQueryGLID);
+
+        const ReplayStatus status = replay_frame(reader);
+
+        glEndQuery(GL_TIME_ELAPSED);
+        glFinish();
+        const double frameEndTime = glfwGetTime();
+
+        if (status != REPLAY_FRAME_ENDED)
+        {
+            end_replay_pass();
+            return status == REPLAY_ENDED;
+        }
+
+        GLuint64 gpuTime;
+        glGetQueryObjectui64v(timerQueryGLID, GL_QUERY_RESULT, &gpuTime);
+
+        add_frame_time(cpuStats, (frameEndTime - frameBeginTime) * 1000.0);
+        add_frame_time(gpuStats, gpuTime / 1000000.0);
+    }
+}
+
+int main(const int argCnt, const char *const *const args)
+{
+    if (argCnt != 3 && argCnt != 4)
+    {
+        cc::log_error("A GL recording file path and an assets file path must both be provided as command-line arguments, optionally followed by a pass count!");
+        return EXIT_FAILURE;
+    }
+
+    const char *const recordingFilePath = args[1];
+    const char *const assetsFilePath = args[2];
+    const int passCnt = argCnt == 4 ? atoi(args[3]) : ik_defaultPassCnt;
+
+    if (passCnt <= 0)
+    {
+        cc::log_error("The pass count must be above zero!");
+        return EXIT_FAILURE;
+    }
+
+    // Open the recording and find its size.
+    FILE *const recordingFS = fopen(recordingFilePath, "rb");
+
+    if (!recordingFS)
+    {
+        cc::log_error("Failed to open GL recording file with path \"%s\"!", recordingFilePath);
+        return EXIT_FAILURE;
+    }
+
+    fseek(recordingFS, 0, SEEK_END);
+    const long recordingSize = ftell(recordingFS);
+    fseek(recordingFS, 0, SEEK_SET);
+
+    if (recordingSize <= 0 || recordingSize > INT_MAX - ik_memArenaSize)
+    {
+        cc::log_error("The GL recording is empty or too large!");
+        fclose(recordingFS);
+        return EXIT_FAILURE;
+    }
+
+    // Create the memory arena and read in the whole recording, so that replaying it reads no files.
+    cc::MemArena memArena = {};
+
+    if (!cc::init_mem_arena(memArena, ik_memArenaSize + static_cast<int>(recordingSize)))
+    {
+        cc::log_error("Failed to initialise the memory arena!");
+        fclose(recordingFS);
+        return EXIT_FAILURE;
+    }
+
+    cc::Byte *const recordingData = cc::push_to_mem_arena<cc::Byte>(memArena, recordingSize);
+    const bool recordingRead = fread(recordingData, 1, recordingSize, recordingFS) == static_cast<size_t>(recordingSize);
+    fclose(recordingFS);
+
+    GLRecordingReader reader = {
+        .data = recordingData,
+        .size = static_cast<int>(recordingSize),
+        .offs = 0,
+        .failed = false
+    };
+
+    cc::Vec2DInt windowSize;
+
+    if (!recordingRead || !read_gl_recording_header(reader, windowSize))
+    {
+        cc::log_error("The file with path \"%s\" is not a GL recording of a supported version!", recordingFilePath);
+        cc::clean_mem_arena(memArena);
+        return EXIT_FAILURE;
+    }
+
+    // Set up a hidden window, just for its GL context.
+    if (!glfwInit())
+    {
+        cc::log_error("Failed to initialise GLFW!");
+        cc::clean_mem_arena(memArena);
+        return EXIT_FAILURE;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, ik_glVersionMajor);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, ik_glVersionMinor);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, false);
+
+    GLFWwindow *const glfwWindow = glfwCreateWindow(windowSize.x, windowSize.y, "castle_gl_replay", nullptr, nullptr);
+
+    if (!glfwWindow)
+    {
+        cc::log_error("Failed to create a GLFW window with an OpenGL %d.%d context!", ik_glVersionMajor, ik_glVersionMinor);
+        glfwTerminate();
+        cc::clean_mem_arena(memArena);
+        return EXIT_FAILURE;
+    }
+
+    glfwMakeContextCurrent(glfwWindow);
+    glfwSwapInterval(0);
+
+    ReplayAssetTexs assetTexs = {};
+    int exitCode = EXIT_FAILURE;
+
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
+    {
+        cc::log_error("Failed to load OpenGL function pointers!");
+    }
+    else if (load_replay_asset_texs(assetTexs, assetsFilePath, memArena) && init_replay(windowSize))
+    {
+        cc::log("Replaying \"%s\" (%dx%d) on %s for %d passes...", recordingFilePath, windowSize.x, windowSize.y, reinterpret_cast<const char *>(glGetString(GL_RENDERER)), passCnt);
+
+        const int defsOffs = reader.offs;
+
+        GLID timerQueryGLID;
+        glGenQueries(1, &timerQueryGLID);
+
+        FrameTimeStats cpuStatsTotal = {};
+        FrameTimeStats gpuStatsTotal = {};
+        bool replaySuccessful = true;
+
+        for (int i = 0; i < passCnt && replaySuccessful; ++i)
+        {
+            reader.offs = defsOffs;
+            reader.failed = false;
+
+            FrameTimeStats cpuStats = {};
+            FrameTimeStats gpuStats = {};
+            replaySuccessful = replay_pass(reader, assetTexs, timerQueryGLID, cpuStats, gpuStats);
+
+            cc::log("Pass %d, %d frames:", i + 1, cpuStats.cnt);
+            log_frame_time_stats("    CPU (to finish)", cpuStats);
+            log_frame_time_stats("    GPU", gpuStats);
+
+            merge_frame_time_stats(cpuStatsTotal, cpuStats);
+            merge_frame_time_stats(gpuStatsTotal, gpuStats);
+        }
+
+        if (replaySuccessful)
+        {
+            cc::log("All passes, %d frames:", cpuStatsTotal.cnt);
+            log_frame_time_stats("    CPU (to finish)", cpuStatsTotal);
+            log_frame_time_stats("    GPU", gpuStatsTotal);
+
+            exitCode = EXIT_SUCCESS;
+        }
+
+        glDeleteQueries(1, &timerQueryGLID);
+        clean_replay();
+    }
+
+    clean_replay_asset_texs(assetTexs);
+    glfwDestroyWindow(glfwWindow);
+    glfwTerminate();
+    cc::clean_mem_arena(memArena);
+
+    return exitCode;
+}
@@ -0,0 +1,1236 @@
+#include "cgr_shared.h"
+
+#include <string.h>
+#include <stdint.h>
+
+static constexpr int ik_progLimit = 32;
+static constexpr int ik_uniformNameBufSize = 64;
+static constexpr int ik_uniformValBufSize = 4096;
+static constexpr int ik_multiDrawLimit = 4096;
+static constexpr int ik_shaderInfoLogBufSize = 512;
+
+struct ReplayProg
+{
+    GLID glID;
+    GLint uniformLocs[cc::gk_glRecordingUniformLocLimit]; // Indexed by recorded location, with -1 for those not in the program.
+};
+
+// Replay objects, indexed by the names they had when recorded. Zero means there is no object under that name.
+static GLID i_bufGLIDs[cc::gk_glRecordingNameLimit];
+static GLID i_texGLIDs[cc::gk_glRecordingNameLimit];
+static GLID i_vertArrayGLIDs[cc::gk_glRecordingNameLimit];
+static GLID i_framebufGLIDs[cc::gk_glRecordingNameLimit]; // The first is the stand-in for the default framebuffer, which lives across passes.
+static GLID i_renderbufGLIDs[cc::gk_glRecordingNameLimit];
+
+static int i_progIndices[cc::gk_glRecordingNameLimit]; // -1 if there is no program under that name.
+static ReplayProg i_progs[ik_progLimit];
+static int i_progCnt;
+static int i_curProgIndex; // -1 if no program is in use.
+
+static GLID i_defaultFramebufColorTexGLID;
+static GLID i_defaultFramebufDepthRenderbufGLID;
+
+// Recorded data is not aligned, so uniform values are copied here before being passed on.
+alignas(16) static cc::Byte i_uniformValBuf[ik_uniformValBufSize];
+
+// The arguments of a multi-draw, read out of the recording.
+static GLsizei i_multiDrawCnts[ik_multiDrawLimit];
+static const void *i_multiDrawIndices[ik_multiDrawLimit];
+static GLint i_multiDrawBaseVerts[ik_multiDrawLimit];
+
+//
+// Reading
+//
+static const cc::Byte *read_data(GLRecordingReader &reader, const int size)
+{
+    if (size < 0 || reader.offs + size > reader.size)
+    {
+        reader.failed = true;
+        reader.offs = reader.size;
+        return nullptr;
+    }
+
+    const cc::Byte *const data = reader.data + reader.offs;
+    reader.offs += size;
+    return data;
+}
+
+static int read_int(GLRecordingReader &reader)
+{
+    int val = 0;
+    const cc::Byte *const data = read_data(reader, sizeof(val));
+
+    if (data)
+    {
+        memcpy(&val, data, sizeof(val));
+    }
+
+    return val;
+}
+
+static float read_float(GLRecordingReader &reader)
+{
+    float val = 0.0f;
+    const cc::Byte *const data = read_data(reader, sizeof(val));
+
+    if (data)
+    {
+        memcpy(&val, data, sizeof(val));
+    }
+
+    return val;
+}
+
+// Returns null if the values do not fit in the buffer.
+static const cc::Byte *read_uniform_vals(GLRecordingReader &reader, const int size)
+{
+    const cc::Byte *const vals = read_data(reader, size);
+
+    if (!vals || size > ik_uniformValBufSize)
+    {
+        return nullptr;
+    }
+
+    memcpy(i_uniformValBuf, vals, size);
+    return i_uniformValBuf;
+}
+
+static inline const void *offs_to_ptr(const int offs)
+{
+    return reinterpret_cast<const void *>(static_cast<intptr_t>(offs));
+}
+
+//
+// Name Mapping
+//
+static inline bool is_name_valid(const int name)
+{
+    return name >= 0 && name < cc::gk_glRecordingNameLimit;
+}
+
+static inline GLID map_name(const GLID *const glIDs, const int name)
+{
+    return is_name_valid(name) ? glIDs[name] : 0;
+}
+
+static inline GLint map_uniform_loc(const int loc)
+{
+    if (i_curProgIndex == -1 || loc < 0 || loc >= cc::gk_glRecordingUniformLocLimit)
+    {
+        return -1;
+    }
+
+    return i_progs[i_curProgIndex].uniformLocs[loc];
+}
+
+static void gen_names(GLRecordingReader &reader, GLID *const glIDs, void (APIENTRYP genFunc)(GLsizei, GLuint *))
+{
+    const int cnt = read_int(reader);
+
+    for (int i = 0; i < cnt && !reader.failed; ++i)
+    {
+        const int name = read_int(reader);
+
+        if (is_name_valid(name) && name > 0)
+        {
+            genFunc(1, &glIDs[name]);
+        }
+    }
+}
+
+static void delete_names(GLRecordingReader &reader, GLID *const glIDs, void (APIENTRYP deleteFunc)(GLsizei, const GLuint *))
+{
+    const int cnt = read_int(reader);
+
+    for (int i = 0; i < cnt && !reader.failed; ++i)
+    {
+        const int name = read_int(reader);
+
+        if (is_name_valid(name) && name > 0 && glIDs[name])
+        {
+            deleteFunc(1, &glIDs[name]);
+            glIDs[name] = 0;
+        }
+    }
+}
+
+static void delete_all(GLID *const glIDs, const int begin, void (APIENTRYP deleteFunc)(GLsizei, const GLuint *))
+{
+    for (int i = begin; i < cc::gk_glRecordingNameLimit; ++i)
+    {
+        if (glIDs[i])
+        {
+            deleteFunc(1, &glIDs[i]);
+            glIDs[i] = 0;
+        }
+    }
+}
+
+//
+// Definitions
+//
+static GLID create_shader(const GLenum type, const char *const src, const int srcLen)
+{
+    const GLID glID = glCreateShader(type);
+    glShaderSource(glID, 1, &src, &srcLen);
+    glCompileShader(glID);
+
+    GLint compileSuccess;
+    glGetShaderiv(glID, GL_COMPILE_STATUS, &compileSuccess);
+
+    if (!compileSuccess)
+    {
+        char infoLog[ik_shaderInfoLogBufSize];
+        glGetShaderInfoLog(glID, sizeof(infoLog), nullptr, infoLog);
+        cc::log_error("Failed to compile a recorded shader: %s", infoLog);
+    }
+
+    return glID;
+}
+
+static bool def_prog(GLRecordingReader &reader)
+{
+    const int name = read_int(reader);
+    const bool compute = read_int(reader);
+
+    const int vertOrCompSrcLen = read_int(reader);
+    const char *const vertOrCompSrc = reinterpret_cast<const char *>(read_data(reader, vertOrCompSrcLen));
+
+    const int fragSrcLen = read_int(reader);
+    const char *const fragSrc = reinterpret_cast<const char *>(read_data(reader, fragSrcLen));
+
+    if (reader.failed)
+    {
+        return false;
+    }
+
+    if (i_progCnt == ik_progLimit || !is_name_valid(name))
+    {
+        cc::log_error("Recorded program %d could not be created, as there are too many programs or its name is out of range!", name);
+        return false;
+    }
+
+    ReplayProg &prog = i_progs[i_progCnt];
+    prog.glID = glCreateProgram();
+
+    const GLID vertOrCompShaderGLID = create_shader(compute ? GL_COMPUTE_SHADER : GL_VERTEX_SHADER, vertOrCompSrc, vertOrCompSrcLen);
+    glAttachShader(prog.glID, vertOrCompShaderGLID);
+
+    GLID fragShaderGLID = 0;
+
+    if (!compute)
+    {
+        fragShaderGLID = create_shader(GL_FRAGMENT_SHADER, fragSrc, fragSrcLen);
+        glAttachShader(prog.glID, fragShaderGLID);
+    }
+
+    glLinkProgram(prog.glID);
+
+    glDeleteShader(vertOrCompShaderGLID);
+    glDeleteShader(fragShaderGLID);
+
+    GLint linkSuccess;
+    glGetProgramiv(prog.glID, GL_LINK_STATUS, &linkSuccess);
+
+    if (!linkSuccess)
+    {
+        char infoLog[ik_shaderInfoLogBufSize];
+        glGetProgramInfoLog(prog.glID, sizeof(infoLog), nullptr, infoLog);
+        cc::log_error("Failed to link recorded program %d: %s", name, infoLog);
+
+        glDeleteProgram(prog.glID);
+        return false;
+    }
+
+    // Map the recorded uniform locations to those of the replay program by name.
+    for (int i = 0; i < cc::gk_glRecordingUniformLocLimit; ++i)
+    {
+        prog.uniformLocs[i] = -1;
+    }
+
+    const int uniformCnt = read_int(reader);
+
+    for (int i = 0; i < uniformCnt && !reader.failed; ++i)
+    {
+        const int loc = read_int(reader);
+        const int nameLen = read_int(reader);
+        const cc::Byte *const uniformName = read_data(reader, nameLen);
+
+        if (!uniformName || loc < 0 || loc >= cc::gk_glRecordingUniformLocLimit || nameLen >= ik_uniformNameBufSize)
+        {
+            continue;
+        }
+
+        char nameBuf[ik_uniformNameBufSize];
+        memcpy(nameBuf, uniformName, nameLen);
+        nameBuf[nameLen] = '\0';
+
+        prog.uniformLocs[loc] = glGetUniformLocation(prog.glID, nameBuf);
+    }
+
+    i_progIndices[name] = i_progCnt;
+    ++i_progCnt;
+
+    return !reader.failed;
+}
+
+static void def_tex_params(const GLint minFilter, const GLint magFilter, const GLint wrapS, const GLint wrapT)
+{
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
+}
+
+// Returns false if the recording cannot be replayed, or true if it can even if the definition was skipped.
+static bool exec_def(GLRecordingReader &reader, const cc::GLRecordingOpcode op, const ReplayAssetTexs &assetTexs)
+{
+    switch (op)
+    {
+        case cc::GL_REC_DEF_BUF:
+            {
+                const int name = read_int(reader);
+                const int size = read_int(reader);
+                const GLenum usage = read_int(reader);
+                const cc::Byte *const data = read_data(reader, size);
+
+                if (reader.failed || !is_name_valid(name))
+                {
+                    return false;
+                }
+
+                glGenBuffers(1, &i_bufGLIDs[name]);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, i_bufGLIDs[name]);
+                glBufferData(GL_COPY_WRITE_BUFFER, size, data, usage);
+            }
+
+            return true;
+
+        case cc::GL_REC_DEF_ASSET_TEX:
+            {
+                const int name = read_int(reader);
+                const int coreTexIndex = read_int(reader);
+                const GLint minFilter = read_int(reader);
+                const GLint magFilter = read_int(reader);
+                const GLint wrapS = read_int(reader);
+                const GLint wrapT = read_int(reader);
+
+                if (reader.failed || !is_name_valid(name) || coreTexIndex < 0 || coreTexIndex >= cc::CORE_TEX_CNT)
+                {
+                    return false;
+                }
+
+                const cc::Vec2DInt size = assetTexs.sizes[coreTexIndex];
+                const bool indexed = assetTexs.paletteColorCnts[coreTexIndex] > 0; // The palette itself is in a buffer of the recording.
+
+                fseek(assetTexs.fs, assetTexs.fileOffsets[coreTexIndex], SEEK_SET);
+                fread(assetTexs.pxBuf, 1, (indexed ? 1 : cc::gk_texChannelCnt) * size.x * size.y, assetTexs.fs);
+
+                glGenTextures(1, &i_texGLIDs[name]);
+                glBindTexture(GL_TEXTURE_2D, i_texGLIDs[name]);
+                def_tex_params(minFilter, magFilter, wrapS, wrapT);
+
+                if (indexed)
+                {
+                    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, size.x, size.y, 0, GL_RED, GL_UNSIGNED_BYTE, assetTexs.pxBuf);
+                }
+                else
+                {
+                    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, assetTexs.pxBuf);
+                }
+            }
+
+            return true;
+
+        case cc::GL_REC_DEF_TEX:
+            {
+                const int name = read_int(reader);
+                const GLint internalFormat = read_int(reader);
+                const GLsizei width = read_int(reader);
+                const GLsizei height = read_int(reader);
+                const GLint minFilter = read_int(reader);
+                const GLint magFilter = read_int(reader);
+                const GLint wrapS = read_int(reader);
+                const GLint wrapT = read_int(reader);
+                const GLenum pxFormat = read_int(reader);
+                const GLenum pxType = read_int(reader);
+                const int pxDataSize = read_int(reader);
+                const cc::Byte *const px = read_data(reader, pxDataSize);
+
+                if (reader.failed || !is_name_valid(name))
+                {
+                    return false;
+                }
+
+                glGenTextures(1, &i_texGLIDs[name]);
+                glBindTexture(GL_TEXTURE_2D, i_texGLIDs[name]);
+                def_tex_params(minFilter, magFilter, wrapS, wrapT);
+
+                if (width > 0 && height > 0)
+                {
+                    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, pxFormat ? pxFormat : GL_RGBA, pxType, pxDataSize > 0 ? px : nullptr);
+                }
+            }
+
+            return true;
+
+        case cc::GL_REC_DEF_RENDERBUF:
+            {
+                const int name = read_int(reader);
+                const GLenum internalFormat = read_int(reader);
+                const GLsizei width = read_int(reader);
+                const GLsizei height = read_int(reader);
+
+                if (reader.failed || !is_name_valid(name))
+                {
+                    return false;
+                }
+
+                glGenRenderbuffers(1, &i_renderbufGLIDs[name]);
+                glBindRenderbuffer(GL_RENDERBUFFER, i_renderbufGLIDs[name]);
+
+                if (width > 0 && height > 0)
+                {
+                    glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, width, height);
+                }
+            }
+
+            return true;
+
+        case cc::GL_REC_DEF_FRAMEBUF:
+            {
+                const int name = read_int(reader);
+                const int attachmentCnt = read_int(reader);
+
+                if (reader.failed || !is_name_valid(name) || !name)
+                {
+                    return false;
+                }
+
+                glGenFramebuffers(1, &i_framebufGLIDs[name]);
+                glBindFramebuffer(GL_FRAMEBUFFER, i_framebufGLIDs[name]);
+
+                for (int i = 0; i < attachmentCnt && !reader.failed; ++i)
+                {
+                    const GLenum attachment = read_int(reader);
+                    const bool renderbuf = read_int(reader);
+                    const int attachmentName = read_int(reader);
+
+                    if (renderbuf)
+                    {
+                        glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, map_name(i_renderbufGLIDs, attachmentName));
+                    }
+                    else
+                    {
+                        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, map_name(i_texGLIDs, attachmentName), 0);
+                    }
+                }
+            }
+
+            return !reader.failed;
+
+        case cc::GL_REC_DEF_VERT_ARRAY:
+            {
+                const int name = read_int(reader);
+                const int elemBufName = read_int(reader);
+                const int attribCnt = read_int(reader);
+
+                if (reader.failed || !is_name_valid(name))
+                {
+                    return false;
+                }
+
+                glGenVertexArrays(1, &i_vertArrayGLIDs[name]);
+                glBindVertexArray(i_vertArrayGLIDs[name]);
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, map_name(i_bufGLIDs, elemBufName));
+
+                for (int i = 0; i < attribCnt && !reader.failed; ++i)
+                {
+                    const GLuint index = read_int(reader);
+                    const bool enabled = read_int(reader);
+                    const GLint size = read_int(reader);
+                    const GLenum type = read_int(reader);
+                    const GLboolean normalized = read_int(reader);
+                    const bool integer = read_int(reader);
+                    const GLsizei stride = read_int(reader);
+                    const int offs = read_int(reader);
+                    const int bufName = read_int(reader);
+
+                    glBindBuffer(GL_ARRAY_BUFFER, map_name(i_bufGLIDs, bufName));
+
+                    if (integer)
+                    {
+                        glVertexAttribIPointer(index, size, type, stride, offs_to_ptr(offs));
+                    }
+                    else
+                    {
+                        glVertexAttribPointer(index, size, type, normalized, stride, offs_to_ptr(offs));
+                    }
+
+                    if (enabled)
+                    {
+                        glEnableVertexAttribArray(index);
+                    }
+                }
+            }
+
+            return !reader.failed;
+
+        case cc::GL_REC_DEF_PROG:
+            return def_prog(reader);
+
+        case cc::GL_REC_DEF_STATE:
+            {
+                GLint viewport[4];
+
+                for (int i = 0; i < 4; ++i)
+                {
+                    viewport[i] = read_int(reader);
+                }
+
+                GLfloat clearColor[4];
+
+                for (int i = 0; i < 4; ++i)
+                {
+                    clearColor[i] = read_float(reader);
+                }
+
+                const bool blend = read_int(reader);
+                const GLenum blendSrc = read_int(reader);
+                const GLenum blendDst = read_int(reader);
+                const bool depthTest = read_int(reader);
+                const GLenum depthFunc = read_int(reader);
+                const GLboolean depthMask = read_int(reader);
+                const GLint unpackAlignment = read_int(reader);
+                const int progName = read_int(reader);
+                const int vertArrayName = read_int(reader);
+                const int drawFramebufName = read_int(reader);
+                const int readFramebufName = read_int(reader);
+                const int renderbufName = read_int(reader);
+                const int arrayBufName = read_int(reader);
+                const int drawIndirectBufName = read_int(reader);
+                const GLenum activeTexUnit = read_int(reader);
+
+                glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+                glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+
+                if (blend)
+                {
+                    glEnable(GL_BLEND);
+                }
+                else
+                {
+                    glDisable(GL_BLEND);
+                }
+
+                glBlendFunc(blendSrc, blendDst);
+
+                if (depthTest)
+                {
+                    glEnable(GL_DEPTH_TEST);
+                }
+                else
+                {
+                    glDisable(GL_DEPTH_TEST);
+                }
+
+                glDepthFunc(depthFunc);
+                glDepthMask(depthMask);
+                glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+
+                i_curProgIndex = is_name_valid(progName) ? i_progIndices[progName] : -1;
+                glUseProgram(i_curProgIndex != -1 ? i_progs[i_curProgIndex].glID : 0);
+
+                glBindVertexArray(map_name(i_vertArrayGLIDs, vertArrayName));
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, map_name(i_framebufGLIDs, drawFramebufName));
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, map_name(i_framebufGLIDs, readFramebufName));
+                glBindRenderbuffer(GL_RENDERBUFFER, map_name(i_renderbufGLIDs, renderbufName));
+                glBindBuffer(GL_ARRAY_BUFFER, map_name(i_bufGLIDs, arrayBufName));
+                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, map_name(i_bufGLIDs, drawIndirectBufName));
+
+                for (int i = 0; i < cc::gk_glRecordingTexUnitLimit; ++i)
+                {
+                    const int texName = read_int(reader);
+
+                    glActiveTexture(GL_TEXTURE0 + i);
+                    glBindTexture(GL_TEXTURE_2D, map_name(i_texGLIDs, texName));
+                }
+
+                glActiveTexture(activeTexUnit);
+
+                for (int i = 0; i < cc::gk_glRecordingBufBindingPointLimit; ++i)
+                {
+                    glBindBufferBase(GL_UNIFORM_BUFFER, i, map_name(i_bufGLIDs, read_int(reader)));
+                }
+
+                for (int i = 0; i < cc::gk_glRecordingBufBindingPointLimit; ++i)
+                {
+                    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, map_name(i_bufGLIDs, read_int(reader)));
+                }
+            }
+
+            return !reader.failed;
+
+        default:
+            return false;
+    }
+}
+
+//
+// Frame Commands
+//
+static bool exec_cmd(GLRecordingReader &reader, const cc::GLRecordingOpcode op)
+{
+    switch (op)
+    {
+        case cc::GL_REC_GEN_BUFS: gen_names(reader, i_bufGLIDs, glGenBuffers); break;
+        case cc::GL_REC_DELETE_BUFS: delete_names(reader, i_bufGLIDs, glDeleteBuffers); break;
+        case cc::GL_REC_GEN_TEXS: gen_names(reader, i_texGLIDs, glGenTextures); break;
+        case cc::GL_REC_DELETE_TEXS: delete_names(reader, i_texGLIDs, glDeleteTextures); break;
+        case cc::GL_REC_GEN_VERT_ARRAYS: gen_names(reader, i_vertArrayGLIDs, glGenVertexArrays); break;
+        case cc::GL_REC_DELETE_VERT_ARRAYS: delete_names(reader, i_vertArrayGLIDs, glDeleteVertexArrays); break;
+        case cc::GL_REC_GEN_FRAMEBUFS: gen_names(reader, i_framebufGLIDs, glGenFramebuffers); break;
+        case cc::GL_REC_DELETE_FRAMEBUFS: delete_names(reader, i_framebufGLIDs, glDeleteFramebuffers); break;
+        case cc::GL_REC_GEN_RENDERBUFS: gen_names(reader, i_renderbufGLIDs, glGenRenderbuffers); break;
+        case cc::GL_REC_DELETE_RENDERBUFS: delete_names(reader, i_renderbufGLIDs, glDeleteRenderbuffers); break;
+
+        case cc::GL_REC_BIND_BUF:
+            {
+                const GLenum target = read_int(reader);
+                glBindBuffer(target, map_name(i_bufGLIDs, read_int(reader)));
+            }
+
+            break;
+
+        case cc::GL_REC_BIND_BUF_BASE:
+            {
+                const GLenum target = read_int(reader);
+                const GLuint index = read_int(reader);
+                glBindBufferBase(target, index, map_name(i_bufGLIDs, read_int(reader)));
+            }
+
+            break;
+
+        case cc::GL_REC_BIND_VERT_ARRAY:
+            glBindVertexArray(map_name(i_vertArrayGLIDs, read_int(reader)));
+            break;
+
+        case cc::GL_REC_BIND_TEX:
+            {
+                const GLenum target = read_int(reader);
+                glBindTexture(target, map_name(i_texGLIDs, read_int(reader)));
+            }
+
+            break;
+
+        case cc::GL_REC_ACTIVE_TEX:
+            glActiveTexture(read_int(reader));
+            break;
+
+        case cc::GL_REC_BIND_FRAMEBUF:
+            {
+                const GLenum target = read_int(reader);
+                glBindFramebuffer(target, map_name(i_framebufGLIDs, read_int(reader)));
+            }
+
+            break;
+
+        case cc::GL_REC_BIND_RENDERBUF:
+            {
+                const GLenum target = read_int(reader);
+                glBindRenderbuffer(target, map_name(i_renderbufGLIDs, read_int(reader)));
+            }
+
+            break;
+
+        case cc::GL_REC_USE_PROG:
+            {
+                const int name = read_int(reader);
+                i_curProgIndex = name > 0 && is_name_valid(name) ? i_progIndices[name] : -1;
+                glUseProgram(i_curProgIndex != -1 ? i_progs[i_curProgIndex].glID : 0);
+            }
+
+            break;
+
+        case cc::GL_REC_ENABLE: glEnable(read_int(reader)); break;
+        case cc::GL_REC_DISABLE: glDisable(read_int(reader)); break;
+        case cc::GL_REC_DEPTH_FUNC: glDepthFunc(read_int(reader)); break;
+        case cc::GL_REC_DEPTH_MASK: glDepthMask(read_int(reader)); break;
+
+        case cc::GL_REC_BLEND_FUNC:
+            {
+                const GLenum srcFactor = read_int(reader);
+                const GLenum dstFactor = read_int(reader);
+                glBlendFunc(srcFactor, dstFactor);
+            }
+
+            break;
+
+        case cc::GL_REC_BLEND_FUNC_SEPARATE:
+            {
+                const GLenum srcColorFactor = read_int(reader);
+                const GLenum dstColorFactor = read_int(reader);
+                const GLenum srcAlphaFactor = read_int(reader);
+                const GLenum dstAlphaFactor = read_int(reader);
+                glBlendFuncSeparate(srcColorFactor, dstColorFactor, srcAlphaFactor, dstAlphaFactor);
+            }
+
+            break;
+
+        case cc::GL_REC_VIEWPORT:
+            {
+                const GLint x = read_int(reader);
+                const GLint y = read_int(reader);
+                const GLsizei width = read_int(reader);
+                const GLsizei height = read_int(reader);
+                glViewport(x, y, width, height);
+            }
+
+            break;
+
+        case cc::GL_REC_CLEAR_COLOR:
+            {
+                const GLfloat r = read_float(reader);
+                const GLfloat g = read_float(reader);
+                const GLfloat b = read_float(reader);
+                const GLfloat a = read_float(reader);
+                glClearColor(r, g, b, a);
+            }
+
+            break;
+
+        case cc::GL_REC_CLEAR: glClear(read_int(reader)); break;
+
+        case cc::GL_REC_PIXEL_STORE:
+            {
+                const GLenum param = read_int(reader);
+                glPixelStorei(param, read_int(reader));
+            }
+
+            break;
+
+        case cc::GL_REC_MEM_BARRIER: glMemoryBarrier(read_int(reader)); break;
+
+        case cc::GL_REC_BUF_DATA:
+            {
+                const GLenum target = read_int(reader);
+                const int size = read_int(reader);
+                const GLenum usage = read_int(reader);
+                const bool hasData = read_int(reader);
+                const cc::Byte *const data = hasData ? read_data(reader, size) : nullptr;
+
+                if (!reader.failed)
+                {
+                    glBufferData(target, size, data, usage);
+                }
+            }
+
+            break;
+
+        case cc::GL_REC_BUF_SUB_DATA:
+            {
+                const GLenum target = read_int(reader);
+                const int offs = read_int(reader);
+                const int size = read_int(reader);
+                const cc::Byte *const data = read_data(reader, size);
+
+                if (!reader.failed)
+                {
+                    glBufferSubData(target, offs, size, data);
+                }
+            }
+
+            break;
+
+        case cc::GL_REC_COPY_BUF_SUB_DATA:
+            {
+                const GLenum readTarget = read_int(reader);
+                const GLenum writeTarget = read_int(reader);
+                const int readOffs = read_int(reader);
+                const int writeOffs = read_int(reader);
+                const int size = read_int(reader);
+                glCopyBufferSubData(readTarget, writeTarget, readOffs, writeOffs, size);
+            }
+
+            break;
+
+        case cc::GL_REC_TEX_IMAGE_2D:
+            {
+                const GLenum target = read_int(reader);
+                const GLint level = read_int(reader);
+                const GLint internalFormat = read_int(reader);
+                const GLsizei width = read_int(reader);
+                const GLsizei height = read_int(reader);
+                const GLenum format = read_int(reader);
+                const GLenum type = read_int(reader);
+                const int pxDataSize = read_int(reader);
+                const cc::Byte *const px = pxDataSize > 0 ? read_data(reader, pxDataSize) : nullptr;
+
+                if (!reader.failed)
+                {
+                    glTexImage2D(target, level, internalFormat, width, height, 0, format, type, px);
+                }
+            }
+
+            break;
+
+        case cc::GL_REC_TEX_SUB_IMAGE_2D:
+            {
+                const GLenum target = read_int(reader);
+                const GLint level = read_int(reader);
+                const GLint x = read_int(reader);
+                const GLint y = read_int(reader);
+                const GLsizei width = read_int(reader);
+                const GLsizei height = read_int(reader);
+                const GLenum format = read_int(reader);
+                const GLenum type = read_int(reader);
+                const int pxDataSize = read_int(reader);
+                const cc::Byte *const px = read_data(reader, pxDataSize);
+
+                if (!reader.failed && px)
+                {
+                    glTexSubImage2D(target, level, x, y, width, height, format, type, px);
+                }
+            }
+
+            break;
+
+        case cc::GL_REC_TEX_PARAM:
+            {
+                const GLenum target = read_int(reader);
+                const GLenum param = read_int(reader);
+                glTexParameteri(target, param, read_int(reader));
+            }
+
+            break;
+
+        case cc::GL_REC_RENDERBUF_STORAGE:
+            {
+                const GLenum target = read_int(reader);
+                const GLenum internalFormat = read_int(reader);
+                const GLsizei width = read_int(reader);
+                const GLsizei height = read_int(reader);
+                glRenderbufferStorage(target, internalFormat, width, height);
+            }
+
+            break;
+
+        case cc::GL_REC_FRAMEBUF_TEX_2D:
+            {
+                const GLenum target = read_int(reader);
+                const GLenum attachment = read_int(reader);
+                const GLenum texTarget = read_int(reader);
+                const GLID texGLID = map_name(i_texGLIDs, read_int(reader));
+                glFramebufferTexture2D(target, attachment, texTarget, texGLID, read_int(reader));
+            }
+
+            break;
+
+        case cc::GL_REC_FRAMEBUF_RENDERBUF:
+            {
+                const GLenum target = read_int(reader);
+                const GLenum attachment = read_int(reader);
+                const GLenum renderbufTarget = read_int(reader);
+                glFramebufferRenderbuffer(target, attachment, renderbufTarget, map_name(i_renderbufGLIDs, read_int(reader)));
+            }
+
+            break;
+
+        case cc::GL_REC_VERT_ATTRIB_POINTER:
+            {
+                const GLuint index = read_int(reader);
+                const GLint size = read_int(reader);
+                const GLenum type = read_int(reader);
+                const GLboolean normalized = read_int(reader);
+                const GLsizei stride = read_int(reader);
+                glVertexAttribPointer(index, size, type, normalized, stride, offs_to_ptr(read_int(reader)));
+            }
+
+            break;
+
+        case cc::GL_REC_VERT_ATTRIB_I_POINTER:
+            {
+                const GLuint index = read_int(reader);
+                const GLint size = read_int(reader);
+                const GLenum type = read_int(reader);
+                const GLsizei stride = read_int(reader);
+                glVertexAttribIPointer(index, size, type, stride, offs_to_ptr(read_int(reader)));
+            }
+
+            break;
+
+        case cc::GL_REC_ENABLE_VERT_ATTRIB_ARRAY: glEnableVertexAttribArray(read_int(reader)); break;
+
+        case cc::GL_REC_UNIFORM_1I:
+            {
+                const GLint loc = map_uniform_loc(read_int(reader));
+                glUniform1i(loc, read_int(reader));
+            }
+
+            break;
+
+        case cc::GL_REC_UNIFORM_1F:
+            {
+                const GLint loc = map_uniform_loc(read_int(reader));
+                glUniform1f(loc, read_float(reader));
+            }
+
+            break;
+
+        case cc::GL_REC_UNIFORM_1IV:
+            {
+                const GLint loc = map_uniform_loc(read_int(reader));
+                const GLsizei cnt = read_int(reader);
+                const cc::Byte *const vals = read_uniform_vals(reader, sizeof(GLint) * cnt);
+
+                if (vals)
+                {
+                    glUniform1iv(loc, cnt, reinterpret_cast<const GLint *>(vals));
+                }
+            }
+
+            break;
+
+        case cc::GL_REC_UNIFORM_2FV:
+            {
+                const GLint loc = map_uniform_loc(read_int(reader));
+                const GLsizei cnt = read_int(reader);
+                const cc::Byte *const vals = read_uniform_vals(reader, sizeof(GLfloat) * 2 * cnt);
+
+                if (vals)
+                {
+                    glUniform2fv(loc, cnt, reinterpret_cast<const GLfloat *>(vals));
+                }
+            }
+
+            break;
+
+        case cc::GL_REC_UNIFORM_4FV:
+            {
+                const GLint loc = map_uniform_loc(read_int(reader));
+                const GLsizei cnt = read_int(reader);
+                const cc::Byte *const vals = read_uniform_vals(reader, sizeof(GLfloat) * 4 * cnt);
+
+                if (vals)
+                {
+                    glUniform4fv(loc, cnt, reinterpret_cast<const GLfloat *>(vals));
+                }
+            }
+
+            break;
+
+        case cc::GL_REC_UNIFORM_MATRIX_4FV:
+            {
+                const GLint loc = map_uniform_loc(read_int(reader));
+                const GLsizei cnt = read_int(reader);
+                const GLboolean transpose = read_int(reader);
+                const cc::Byte *const vals = read_uniform_vals(reader, sizeof(GLfloat) * 16 * cnt);
+
+                if (vals)
+                {
+                    glUniformMatrix4fv(loc, cnt, transpose, reinterpret_cast<const GLfloat *>(vals));
+                }
+            }
+
+            break;
+
+        case cc::GL_REC_DRAW_ARRAYS:
+            {
+                const GLenum mode = read_int(reader);
+                const GLint first = read_int(reader);
+                glDrawArrays(mode, first, read_int(reader));
+            }
+
+            break;
+
+        case cc::GL_REC_DRAW_ELEMS_BASE_VERT:
+            {
+                const GLenum mode = read_int(reader);
+                const GLsizei cnt = read_int(reader);
+                const GLenum type = read_int(reader);
+                const int offs = read_int(reader);
+                glDrawElementsBaseVertex(mode, cnt, type, offs_to_ptr(offs), read_int(reader));
+            }
+
+            break;
+
+        case cc::GL_REC_MULTI_DRAW_ELEMS_BASE_VERT:
+            {
+                const GLenum mode = read_int(reader);
+                const GLenum type = read_int(reader);
+                const GLsizei drawCnt = read_int(reader);
+
+                if (drawCnt < 0 || drawCnt > ik_multiDrawLimit)
+                {
+                    return false;
+                }
+
+                for (int i = 0; i < drawCnt; ++i)
+                {
+                    i_multiDrawCnts[i] = read_int(reader);
+                    i_multiDrawIndices[i] = offs_to_ptr(read_int(reader));
+                    i_multiDrawBaseVerts[i] = read_int(reader);
+                }
+
+                if (!reader.failed)
+                {
+                    glMultiDrawElementsBaseVertex(mode, i_multiDrawCnts, type, i_multiDrawIndices, drawCnt, i_multiDrawBaseVerts);
+                }
+            }
+
+            break;
+
+        case cc::GL_REC_MULTI_DRAW_ELEMS_INDIRECT:
+            {
+                const GLenum mode = read_int(reader);
+                const GLenum type = read_int(reader);
+                const int offs = read_int(reader);
+                const GLsizei drawCnt = read_int(reader);
+                glMultiDrawElementsIndirect(mode, type, offs_to_ptr(offs), drawCnt, read_int(reader));
+            }
+
+            break;
+
+        case cc::GL_REC_DISPATCH_COMPUTE:
+            {
+                const GLuint groupCntX = read_int(reader);
+                const GLuint groupCntY = read_int(reader);
+                glDispatchCompute(groupCntX, groupCntY, read_int(reader));
+            }
+
+            break;
+
+        case cc::GL_REC_BLIT_FRAMEBUF:
+            {
+                GLint coords[8];
+
+                for (int i = 0; i < 8; ++i)
+                {
+                    coords[i] = read_int(reader);
+                }
+
+                const GLbitfield mask = read_int(reader);
+                glBlitFramebuffer(coords[0], coords[1], coords[2], coords[3], coords[4], coords[5], coords[6], coords[7], mask, read_int(reader));
+            }
+
+            break;
+
+        default:
+            return false;
+    }
+
+    return !reader.failed;
+}
+
+bool load_replay_asset_texs(ReplayAssetTexs &texs, const char *const assetsFilePath, cc::MemArena &memArena)
+{
+    assert(!texs.fs);
+
+    texs.fs = fopen(assetsFilePath, "rb");
+
+    if (!texs.fs)
+    {
+        cc::log_error("Failed to open assets file with path \"%s\"!", assetsFilePath);
+        return false;
+    }
+
+    // Note where the pixel data of each core texture lies, skipping over it.
+    const int texCnt = cc::read_from_fs<int>(texs.fs);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        cc::read_from_fs<int>(texs.fs); // Font, sound and music counts.
+    }
+
+    if (texCnt != cc::CORE_TEX_CNT)
+    {
+        cc::log_error("The assets file has %d textures rather than the %d expected!", texCnt, cc::CORE_TEX_CNT);
+        return false;
+    }
+
+    for (int i = 0; i < cc::CORE_TEX_CNT; ++i)
+    {
+        texs.sizes[i] = cc::read_from_fs<cc::Vec2DInt>(texs.fs);
+
+        if (texs.sizes[i].x < 0 || texs.sizes[i].y < 0 || texs.sizes[i].x > cc::gk_texSizeLimit.x || texs.sizes[i].y > cc::gk_texSizeLimit.y)
+        {
+            cc::log_error("The size of texture %d in the assets file is invalid!", i);
+            return false;
+        }
+
+        texs.paletteColorCnts[i] = cc::read_from_fs<int>(texs.fs);
+
+        if (texs.paletteColorCnts[i] < 0 || texs.paletteColorCnts[i] > cc::gk_texPaletteColorLimit)
+        {
+            cc::log_error("The palette colour count of texture %d in the assets file is invalid!", i);
+            return false;
+        }
+
+        // Indexed textures have their palette ahead of their pixel data.
+        if (texs.paletteColorCnts[i] > 0)
+        {
+            fseek(texs.fs, sizeof(unsigned int) * texs.paletteColorCnts[i], SEEK_CUR);
+        }
+
+        texs.fileOffsets[i] = ftell(texs.fs);
+        fseek(texs.fs, (texs.paletteColorCnts[i] > 0 ? 1 : cc::gk_texChannelCnt) * texs.sizes[i].x * texs.sizes[i].y, SEEK_CUR);
+    }
+
+    texs.pxBuf = cc::push_to_mem_arena<cc::Byte>(memArena, cc::gk_texChannelCnt * cc::gk_texSizeLimit.x * cc::gk_texSizeLimit.y);
+
+    return texs.pxBuf != nullptr;
+}
+
+void clean_replay_asset_texs(ReplayAssetTexs &texs)
+{
+    if (texs.fs)
+    {
+        fclose(texs.fs);
+    }
+
+    texs = {};
+}
+
+bool read_gl_recording_header(GLRecordingReader &reader, cc::Vec2DInt &defaultFramebufSize)
+{
+    const int magic = read_int(reader);
+    const int version = read_int(reader);
+    defaultFramebufSize.x = read_int(reader);
+    defaultFramebufSize.y = read_int(reader);
+
+    return !reader.failed && magic == cc::gk_glRecordingMagic && version == cc::gk_glRecordingVersion && defaultFramebufSize.x > 0 && defaultFramebufSize.y > 0;
+}
+
+bool init_replay(const cc::Vec2DInt defaultFramebufSize)
+{
+    for (int i = 0; i < cc::gk_glRecordingNameLimit; ++i)
+    {
+        i_progIndices[i] = -1;
+    }
+
+    i_curProgIndex = -1;
+
+    // Create the framebuffer standing in for the default one, which the replay window does not show.
+    glGenTextures(1, &i_defaultFramebufColorTexGLID);
+    glBindTexture(GL_TEXTURE_2D, i_defaultFramebufColorTexGLID);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, defaultFramebufSize.x, defaultFramebufSize.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    glGenRenderbuffers(1, &i_defaultFramebufDepthRenderbufGLID);
+    glBindRenderbuffer(GL_RENDERBUFFER, i_defaultFramebufDepthRenderbufGLID);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, defaultFramebufSize.x, defaultFramebufSize.y);
+
+    glGenFramebuffers(1, &i_framebufGLIDs[0]);
+    glBindFramebuffer(GL_FRAMEBUFFER, i_framebufGLIDs[0]);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, i_defaultFramebufColorTexGLID, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, i_defaultFramebufDepthRenderbufGLID);
+
+    const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (!complete)
+    {
+        cc::log_error("Failed to create the stand-in for the default framebuffer!");
+        return false;
+    }
+
+    return true;
+}
+
+void clean_replay()
+{
+    end_replay_pass();
+
+    glDeleteFramebuffers(1, &i_framebufGLIDs[0]);
+    i_framebufGLIDs[0] = 0;
+
+    glDeleteRenderbuffers(1, &i_defaultFramebufDepthRenderbufGLID);
+    i_defaultFramebufDepthRenderbufGLID = 0;
+
+    glDeleteTextures(1, &i_defaultFramebufColorTexGLID);
+    i_defaultFramebufColorTexGLID = 0;
+}
+
+bool begin_replay_pass(GLRecordingReader &reader, const ReplayAssetTexs &assetTexs)
+{
+    // Definitions run up to and including the state, which comes last.
+    while (true)
+    {
+        const cc::Byte *const opByte = read_data(reader, 1);
+        const auto op = opByte ? static_cast<cc::GLRecordingOpcode>(*opByte) : cc::GL_REC_END;
+
+        if (!opByte || !exec_def(reader, op, assetTexs))
+        {
+            cc::log_error("The definitions of the recording are invalid!");
+            return false;
+        }
+
+        if (op == cc::GL_REC_DEF_STATE)
+        {
+            return true;
+        }
+    }
+}
+
+ReplayStatus replay_frame(GLRecordingReader &reader)
+{
+    while (true)
+    {
+        const cc::Byte *const opByte = read_data(reader, 1);
+
+        if (!opByte)
+        {
+            cc::log_error("The recording ends unexpectedly!");
+            return REPLAY_FAILED;
+        }
+
+        const auto op = static_cast<cc::GLRecordingOpcode>(*opByte);
+
+        if (op == cc::GL_REC_FRAME_END)
+        {
+            return REPLAY_FRAME_ENDED;
+        }
+
+        if (op == cc::GL_REC_END)
+        {
+            return REPLAY_ENDED;
+        }
+
+        if (!exec_cmd(reader, op))
+        {
+            cc::log_error("Failed to execute a recorded command with opcode %d at offset %d!", op, reader.offs);
+            return REPLAY_FAILED;
+        }
+    }
+}
+
+void end_replay_pass()
+{
+    glUseProgram(0);
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    for (int i = 0; i < i_progCnt; ++i)
+    {
+        glDeleteProgram(i_progs[i].glID);
+    }
+
+    i_progCnt = 0;
+    i_curProgIndex = -1;
+
+    for (int i = 0; i < cc::gk_glRecordingNameLimit; ++i)
+    {
+        i_progIndices[i] = -1;
+    }
+
+    delete_all(i_vertArrayGLIDs, 1, glDeleteVertexArrays);
+    delete_all(i_framebufGLIDs, 1, glDeleteFramebuffers);
+    delete_all(i_renderbufGLIDs, 1, glDeleteRenderbuffers);
+    delete_all(i_texGLIDs, 1, glDeleteTextures);
+    delete_all(i_bufGLIDs, 1, glDeleteBuffers);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdio.h>
+#include <glad/glad.h>
+#include <castle_common/cc_debugging.h>
+#include <castle_common/cc_math.h>
+#include <castle_common/cc_assets.h>
+#include <castle_common/cc_gl_recording.h>
+#include <castle_common/cc_mem.h>
+#include <castle_common/cc_io.h>
+
+using GLID = GLuint;
+
+// The core textures of an assets file, which are read in whenever a recording references them.
+struct ReplayAssetTexs
+{
+    FILE *fs;
+    long fileOffsets[cc::CORE_TEX_CNT]; // Of the pixel data.
+    cc::Vec2DInt sizes[cc::CORE_TEX_CNT];
+    int paletteColorCnts[cc::CORE_TEX_CNT]; // Zero for textures of RGBA pixel data rather than palette indexes.
+    cc::Byte *pxBuf; // Working space for the pixel data of any one texture.
+};
+
+struct GLRecordingReader
+{
+    const cc::Byte *data;
+    int size;
+    int offs;
+    bool failed; // Set if a read went beyond the end of the data.
+};
+
+enum ReplayStatus
+{
+    REPLAY_FRAME_ENDED,
+    REPLAY_ENDED,
+    REPLAY_FAILED
+};
+
+bool load_replay_asset_texs(ReplayAssetTexs &texs, const char *const assetsFilePath, cc::MemArena &memArena);
+void clean_replay_asset_texs(ReplayAssetTexs &texs);
+
+bool read_gl_recording_header(GLRecordingReader &reader, cc::Vec2DInt &defaultFramebufSize); // Returns false if the data is not a recording of the supported version.
+bool init_replay(const cc::Vec2DInt defaultFramebufSize); // Sets up the framebuffer which stands in for the default framebuffer of the recording.
+void clean_replay();
+bool begin_replay_pass(GLRecordingReader &reader, const ReplayAssetTexs &assetTexs); // Creates every object defined at the start of the recording and applies the recorded state. The reader must be positioned just after the header.
+ReplayStatus replay_frame(GLRecordingReader &reader); // Executes commands up to and including the end of the next frame.
+void end_replay_pass(); // Deletes every object created during the pass.